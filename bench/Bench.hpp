@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace moco::bench {
+    /**
+     * @brief Registry of the benchmarks linked into `moco_bench`
+     * @details Benchmarks register themselves through `MOCO_BENCHMARK`
+     * during static initialization, and report any number of
+     * measurements through `Measure`.
+     *
+     */
+    class BenchmarkRegistry {
+        public:
+            using BenchmarkFunction_t = std::function<void()>;
+
+            struct Benchmark {
+                std::string_view Name;
+                BenchmarkFunction_t Function;
+            };
+
+            static inline auto Register(std::string_view name, BenchmarkFunction_t function) -> bool {
+                GetBenchmarks().push_back({name, std::move(function)});
+                return true;
+            }
+
+            static inline auto GetBenchmarks() -> std::vector<Benchmark>& {
+                static std::vector<Benchmark> benchmarks;
+                return benchmarks;
+            }
+    };
+
+    // Keeps the compiler from optimizing away a value a benchmark computes
+    template <typename T>
+    inline auto DoNotOptimize(const T &value) -> void {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /**
+     * @brief Times a function and prints the cost of one call
+     * @details The function is called in batches, doubling the batch
+     * until one takes `s_minBatchTime`, which keeps the clock's overhead
+     * out of the result. The fastest of `s_repetitions` such batches is
+     * reported, the least disturbed by the rest of the system.
+     *
+     * @param `label`: Name of the measurement.
+     * @param `bytes`: Bytes processed per call, to also print the
+     * throughput, or 0.
+     * @param `function`: The code to measure.
+     *
+     * @return `double`: Nanoseconds per call.
+     *
+     */
+    template <typename Function>
+    inline auto Measure(std::string_view label, size_t bytes, Function &&function) -> double {
+        using Clock = std::chrono::steady_clock;
+        static constexpr std::chrono::milliseconds s_minBatchTime{50};
+        static constexpr size_t s_repetitions = 5;
+
+        auto runBatch = [&function](size_t iterations) -> std::chrono::nanoseconds {
+            Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < iterations; i++) {
+                function();
+            }
+            return Clock::now() - start;
+        };
+
+        size_t iterations{1};
+        while (runBatch(iterations) < s_minBatchTime) {
+            iterations *= 2;
+        }
+
+        std::chrono::nanoseconds best = std::chrono::nanoseconds::max();
+        for (size_t i = 0; i < s_repetitions; i++) {
+            best = std::min(best, runBatch(iterations));
+        }
+
+        double nanoseconds = static_cast<double>(best.count()) / static_cast<double>(iterations);
+
+        std::ios_base::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << std::left << std::setw(48) << label
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << nanoseconds << " ns";
+        if (bytes != 0) {
+            // Bytes per nanosecond are gigabytes per second
+            std::cout << std::setprecision(2) << std::setw(10) << static_cast<double>(bytes) / nanoseconds << " GB/s";
+        }
+        std::cout << std::endl;
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+
+        return nanoseconds;
+    }
+}  // namespace moco::bench
+
+#define MOCO_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define MOCO_BENCHMARK_CONCAT(a, b) MOCO_BENCHMARK_CONCAT_IMPL(a, b)
+
+// Defines and registers a benchmark, `MOCO_BENCHMARK(Suite.Name) { ... }`
+#define MOCO_BENCHMARK(name) \
+    static auto MOCO_BENCHMARK_CONCAT(BenchmarkFunction_, __LINE__)() -> void; \
+    static const bool MOCO_BENCHMARK_CONCAT(s_benchmarkRegistered_, __LINE__) = ::moco::bench::BenchmarkRegistry::Register(#name, MOCO_BENCHMARK_CONCAT(BenchmarkFunction_, __LINE__)); \
+    static auto MOCO_BENCHMARK_CONCAT(BenchmarkFunction_, __LINE__)() -> void
@@ -0,0 +1,182 @@
+#include "Bench.hpp"
+
+#include "Events.hpp"
+
+#include <algorithm>
+#include <any>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace moco::bench;
+using namespace moco::compositor;
+
+namespace {
+    enum class BenchEvents {
+        Motion,
+        Other0,
+        Other1,
+        Other2,
+        Other3,
+        Other4,
+        Other5,
+        Other6
+    };
+
+    // Same size as `LibInput::PointerMotion_EventData`
+    struct Motion_EventData {
+        uint64_t TimeUsec{0};
+        double Dx{0};
+        double Dy{0};
+        double DxUnaccelerated{0};
+        double DyUnaccelerated{0};
+    };
+
+    /**
+     * @brief The event bus `Events` replaced, as a baseline
+     * @details Subscribers of every value of an enum share one list
+     * behind a `std::type_index` lookup, and each payload is passed as
+     * a `std::any`, copied once per subscriber and per handler.
+     *
+     */
+    class AnyEvents {
+        public:
+            using CallbackHandler_t = std::function<void(std::any)>;
+
+            template <typename EventType>
+            class Subscriber {
+                public:
+                    Subscriber(EventType event, CallbackHandler_t handler) :
+                        m_event(event)
+                    {
+                        m_handlers.push_back(std::move(handler));
+                    }
+
+                    auto GetSubscribedEvent() const -> EventType {
+                        return m_event;
+                    }
+
+                    auto operator()(std::any callbackData) -> size_t {
+                        size_t numCalled{0};
+                        std::for_each(std::begin(m_handlers), std::end(m_handlers), [callbackData, &numCalled](CallbackHandler_t callback) -> void {
+                            callback(callbackData);
+                            numCalled++;
+                        });
+
+                        return numCalled;
+                    }
+
+                private:
+                    std::vector<CallbackHandler_t> m_handlers;
+                    EventType m_event;
+            };
+
+            template <typename EventType>
+            auto Subscribe(EventType event, CallbackHandler_t handler) -> std::shared_ptr<Subscriber<EventType>> {
+                auto subscriber = std::make_shared<Subscriber<EventType>>(event, std::move(handler));
+                m_subscribers[typeid(EventType)].push_back(std::make_any<Subscriber<EventType>*>(subscriber.get()));
+                return subscriber;
+            }
+
+            template <typename EventType>
+            auto Publish(EventType event, std::any eventData = {}) -> size_t {
+                size_t numCalled{0};
+
+                if (m_subscribers.contains(typeid(EventType))) {
+                    for (const std::any &subscriber : m_subscribers.at(typeid(EventType))) {
+                        Subscriber<EventType> *eventSubscriber = std::any_cast<Subscriber<EventType>*>(subscriber);
+                        if (eventSubscriber && eventSubscriber->GetSubscribedEvent() == event) {
+                            numCalled += (*eventSubscriber)(eventData);
+                        }
+                    }
+                }
+
+                return numCalled;
+            }
+
+        private:
+            std::unordered_map<std::type_index, std::vector<std::any>> m_subscribers;
+    };
+}
+
+namespace moco::compositor {
+    // Every value carries the same payload
+    template <BenchEvents Event>
+    struct EventPayload<Event> {
+        using Type = Motion_EventData;
+    };
+}  // namespace moco::compositor
+
+namespace {
+    // Subscribes to every other value of the enum, which the old bus had
+    // to skip over on every publish
+    template <size_t... Index>
+    auto SubscribeOthers(std::index_sequence<Index...>) -> std::vector<std::shared_ptr<void>> {
+        return {Events::Subscribe<static_cast<BenchEvents>(Index + 1)>([](const Motion_EventData&) -> void {})...};
+    }
+}
+
+// Cost of publishing a pointer motion sized payload to its subscribers,
+// with the other values of the same enum subscribed as well
+MOCO_BENCHMARK(Events.Publish) {
+    for (size_t subscribers : {1, 4}) {
+        uint64_t sink{0};
+        std::vector<std::shared_ptr<void>> typedSubscribers = SubscribeOthers(std::make_index_sequence<7>());
+        std::vector<std::shared_ptr<void>> anySubscribers;
+
+        AnyEvents anyEvents;
+        for (size_t other = 1; other <= 7; other++) {
+            anySubscribers.push_back(anyEvents.Subscribe(static_cast<BenchEvents>(other), [](std::any) -> void {}));
+        }
+
+        for (size_t i = 0; i < subscribers; i++) {
+            typedSubscribers.push_back(Events::Subscribe<BenchEvents::Motion>([&sink](const Motion_EventData &eventData) -> void {
+                sink += eventData.TimeUsec;
+            }));
+            anySubscribers.push_back(anyEvents.Subscribe(BenchEvents::Motion, [&sink](std::any eventData) -> void {
+                sink += std::any_cast<Motion_EventData>(eventData).TimeUsec;
+            }));
+        }
+
+        Motion_EventData eventData{.TimeUsec = 1, .Dx = 0.5, .Dy = -0.5};
+        std::string suffix = ", " + std::to_string(subscribers) + (subscribers == 1 ? " subscriber" : " subscribers");
+
+        double typed = Measure("Events::Publish" + suffix, 0, [&]() -> void {
+            Events::Publish<BenchEvents::Motion>(eventData);
+        });
+        double any = Measure("std::any bus" + suffix, 0, [&]() -> void {
+            anyEvents.Publish(BenchEvents::Motion, eventData);
+        });
+
+        std::cout << "  " << any / typed << "x faster" << std::endl;
+        DoNotOptimize(sink);
+    }
+}
+
+// Cost of handing an event through the queue, as `Enqueue` and as
+// `Post` from the same thread, until its handler ran
+MOCO_BENCHMARK(Events.Queue) {
+    uint64_t sink{0};
+    EventSubscriber_t<BenchEvents::Motion> subscriber = Events::Subscribe<BenchEvents::Motion>([&sink](const Motion_EventData &eventData) -> void {
+        sink += eventData.TimeUsec;
+    });
+
+    Motion_EventData eventData{.TimeUsec = 1};
+    Measure("Enqueue + Dispatch", 0, [&]() -> void {
+        Events::Enqueue<BenchEvents::Motion>(eventData);
+        Events::Dispatch();
+    });
+
+    Measure("Post + DispatchPosted", 0, [&]() -> void {
+        Events::Post<BenchEvents::Motion>(eventData);
+        Events::DispatchPosted();
+    });
+
+    DoNotOptimize(sink);
+}
@@ -0,0 +1,59 @@
+#include "Bench.hpp"
+
+#include "FormatRegistry.hpp"
+
+#include <wayland-server-protocol.hpp>
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace moco::bench;
+using namespace moco::wayland::implementation::PixelFormats;
+using namespace wayland::server;
+
+namespace {
+    constexpr std::array<std::string_view, FormatRegistry::s_formatCount> s_formatNames = {
+        "argb8888", "xrgb8888", "abgr8888", "xbgr8888", "rgb565",
+        "argb2101010", "xrgb2101010", "abgr2101010", "xbgr2101010"
+    };
+
+    // A 1080 pixel wide block of rows, as a phone sized surface uploads
+    constexpr size_t s_width = 1080;
+    constexpr size_t s_height = 256;
+}
+
+// Conversion throughput of every format and instruction set, in
+// gigabytes of client buffer read per second
+MOCO_BENCHMARK(FormatRegistry.ConvertRows) {
+    std::cout << "Selected kernels: " << FormatRegistry::GetKernelSet() << std::endl;
+
+    std::mt19937 random(1);
+    std::vector<uint8_t> source(s_width * s_height * 4);
+    for (uint8_t &byte : source) {
+        byte = static_cast<uint8_t>(random());
+    }
+    std::vector<uint32_t> destination(s_width * s_height);
+
+    for (std::string_view kernelSet : FormatRegistry::s_kernelSets) {
+        std::array<RowConverter_t, FormatRegistry::s_formatCount> converters = FormatRegistry::GetRowConverters(kernelSet);
+        if (converters[0] == nullptr) {
+            std::cout << "Skipping " << kernelSet << ", not supported here" << std::endl;
+            continue;
+        }
+
+        for (size_t format = 0; format < FormatRegistry::s_formatCount; format++) {
+            size_t bytesPerPixel = FormatRegistry::Get(FormatRegistry::GetSupportedFormats()[format])->BytesPerPixel;
+            size_t stride = s_width * bytesPerPixel;
+
+            Measure(std::string(kernelSet) + " " + std::string(s_formatNames[format]), stride * s_height, [&]() -> void {
+                for (size_t y = 0; y < s_height; y++) {
+                    converters[format](source.data() + y * stride, destination.data() + y * s_width, s_width);
+                }
+                DoNotOptimize(destination.data());
+            });
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include "Bench.hpp"
+
+#include "Gestures.hpp"
+#include "Touch.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace moco::bench;
+using namespace moco::backend;
+
+namespace {
+    constexpr uint64_t s_frameUsec = 16'667;
+
+    // One touch sequence of `fingers` fingers moving apart, down to up
+    auto CreateSequence(int32_t fingers, size_t motionFrames) -> std::vector<TouchState::Frame> {
+        std::vector<TouchState::Frame> frames;
+        TouchState touchState;
+        uint64_t timeUsec{0};
+
+        auto position = [fingers](int32_t slot, size_t frame) -> std::pair<double, double> {
+            double angle = 2.0 * 3.14159265 * slot / fingers;
+            double radius = 0.1 + 0.005 * static_cast<double>(frame);
+            return {0.5 + radius * std::cos(angle), 0.5 + radius * std::sin(angle)};
+        };
+
+        for (int32_t slot = 0; slot < fingers; slot++) {
+            auto [x, y] = position(slot, 0);
+            touchState.Down(slot, timeUsec, x, y);
+        }
+        frames.push_back(touchState.TakeFrame(timeUsec));
+
+        for (size_t frame = 1; frame <= motionFrames; frame++) {
+            timeUsec += s_frameUsec;
+            for (int32_t slot = 0; slot < fingers; slot++) {
+                auto [x, y] = position(slot, frame);
+                touchState.Motion(slot, timeUsec, x, y);
+            }
+            frames.push_back(touchState.TakeFrame(timeUsec));
+        }
+
+        timeUsec += s_frameUsec;
+        for (int32_t slot = 0; slot < fingers; slot++) {
+            touchState.Up(slot, timeUsec);
+        }
+        frames.push_back(touchState.TakeFrame(timeUsec));
+
+        return frames;
+    }
+}
+
+// Recognizer cost per touch frame, for a pinch and for every slot in use
+MOCO_BENCHMARK(Gestures.ProcessFrame) {
+    for (int32_t fingers : {1, 2, static_cast<int32_t>(TouchState::s_maxSlots)}) {
+        std::vector<TouchState::Frame> frames = CreateSequence(fingers, 30);
+
+        double sequence = Measure(std::to_string(fingers) + " fingers, " + std::to_string(frames.size()) + " frames", 0, [&]() -> void {
+            GestureRecognizer recognizer;
+            for (const TouchState::Frame &frame : frames) {
+                GestureRecognizer::Output output = recognizer.ProcessFrame(frame);
+                DoNotOptimize(output);
+            }
+        });
+
+        std::cout << "  " << sequence / static_cast<double>(frames.size()) << " ns per frame" << std::endl;
+    }
+}
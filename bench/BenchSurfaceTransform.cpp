@@ -0,0 +1,102 @@
+#include "Bench.hpp"
+
+#include "SurfaceTransform.hpp"
+
+#include <wayland-server-protocol.hpp>
+
+#include <pixman.h>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+using namespace moco::bench;
+using namespace moco::wayland::implementation;
+using namespace wayland::server;
+
+namespace {
+    constexpr int32_t s_surfaceWidth = 1080;
+    constexpr int32_t s_surfaceHeight = 2340;
+
+    // A commit's worth of scattered damage, a few rectangles of it
+    // reaching outside the surface
+    auto CreateDamage(size_t count) -> std::vector<pixman_box32_t> {
+        std::vector<pixman_box32_t> damage;
+        for (size_t i = 0; i < count; i++) {
+            int32_t x = static_cast<int32_t>((i * 131) % s_surfaceWidth) - 16;
+            int32_t y = static_cast<int32_t>((i * 373) % s_surfaceHeight) - 16;
+            damage.push_back({.x1 = x, .y1 = y, .x2 = x + 96, .y2 = y + 48});
+        }
+        return damage;
+    }
+
+    // What `Surface::SurfaceState::ConvertSurfaceDamage` does once per commit
+    auto ConvertDamage(const SurfaceTransform &transform, const std::vector<pixman_box32_t> &damage, std::vector<pixman_box32_t> &converted, pixman_region32_t &tracker) -> void {
+        converted.clear();
+        for (const pixman_box32_t &area : damage) {
+            pixman_box32_t box = {
+                .x1 = std::max(area.x1, 0),
+                .y1 = std::max(area.y1, 0),
+                .x2 = std::min(area.x2, s_surfaceWidth),
+                .y2 = std::min(area.y2, s_surfaceHeight)
+            };
+
+            if (box.x1 < box.x2 && box.y1 < box.y2) {
+                converted.push_back(transform.Apply(box));
+            }
+        }
+
+        pixman_region32_t region;
+        pixman_region32_init_rects(&region, converted.data(), static_cast<int>(converted.size()));
+        pixman_region32_union(&tracker, &tracker, &region);
+        pixman_region32_fini(&region);
+    }
+
+    constexpr std::array<std::string_view, 8> s_transformNames = {
+        "normal", "90", "180", "270", "flipped", "flipped_90", "flipped_180", "flipped_270"
+    };
+}
+
+// Cost of mapping one commit's damage to buffer coordinates and merging
+// it into the damage tracker, per transform and damage size
+MOCO_BENCHMARK(SurfaceTransform.CommitDamage) {
+    for (size_t rectangles : {1, 16, 128}) {
+        std::vector<pixman_box32_t> damage = CreateDamage(rectangles);
+        std::vector<pixman_box32_t> converted;
+        converted.reserve(rectangles);
+
+        for (size_t transform = 0; transform < s_transformNames.size(); transform++) {
+            SurfaceTransform surfaceTransform(static_cast<output_transform>(transform), 2, s_surfaceWidth, s_surfaceHeight);
+
+            pixman_region32_t tracker;
+            pixman_region32_init(&tracker);
+
+            std::string label = std::string(s_transformNames[transform]) + " x" + std::to_string(rectangles) + " rects";
+            Measure(label, 0, [&]() -> void {
+                // Every commit starts from cleared damage
+                pixman_region32_clear(&tracker);
+                ConvertDamage(surfaceTransform, damage, converted, tracker);
+                DoNotOptimize(tracker);
+            });
+
+            pixman_region32_fini(&tracker);
+        }
+    }
+}
+
+// Mapping alone, without pixman, per rectangle
+MOCO_BENCHMARK(SurfaceTransform.Apply) {
+    std::vector<pixman_box32_t> damage = CreateDamage(1024);
+
+    for (size_t transform = 0; transform < s_transformNames.size(); transform++) {
+        SurfaceTransform surfaceTransform(static_cast<output_transform>(transform), 2, s_surfaceWidth, s_surfaceHeight);
+
+        Measure(std::string(s_transformNames[transform]) + " x1024 boxes", 0, [&]() -> void {
+            for (const pixman_box32_t &box : damage) {
+                pixman_box32_t mapped = surfaceTransform.Apply(box);
+                DoNotOptimize(mapped);
+            }
+        });
+    }
+}
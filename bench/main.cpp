@@ -0,0 +1,31 @@
+#include "Bench.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+using namespace moco::bench;
+
+// Runs every benchmark whose name starts with the first argument,
+// every benchmark without one
+auto main(int argc, char **argv) -> int {
+    std::string_view filter = argc > 1 ? argv[1] : "";
+
+    size_t run{0};
+    for (const BenchmarkRegistry::Benchmark &benchmark : BenchmarkRegistry::GetBenchmarks()) {
+        if (!benchmark.Name.starts_with(filter)) {
+            continue;
+        }
+
+        std::cout << "== " << benchmark.Name << std::endl;
+        benchmark.Function();
+        run++;
+    }
+
+    if (run == 0) {
+        std::cerr << "No benchmark matches " << filter << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
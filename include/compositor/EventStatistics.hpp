@@ -0,0 +1,329 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moco::compositor {
+    /**
+     * @brief Log-linear latency histogram.
+     * @details Values are bucketed by their power of two, and every
+     * power of two is split into `s_subBuckets` linear buckets, keeping
+     * the relative error below 25% with a fixed amount of memory and
+     * constant time recording.
+     *
+     */
+    class LatencyHistogram {
+        public:
+            static constexpr size_t s_subBucketBits = 2;
+            static constexpr size_t s_subBuckets = 1 << s_subBucketBits;
+            // Buckets values below 2^(s_magnitudes + s_subBucketBits) = 2^42ns
+            // (~73 minutes), larger ones share the last bucket
+            static constexpr size_t s_magnitudes = 40;
+
+            inline auto Record(std::chrono::nanoseconds latency) -> void {
+                uint64_t value = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+                m_buckets[GetBucketIndex(value)]++;
+                m_count++;
+                m_sum += value;
+                m_max = std::max(m_max, value);
+            }
+
+            inline auto GetCount() const -> uint64_t {
+                return m_count;
+            }
+
+            inline auto GetMax() const -> std::chrono::nanoseconds {
+                return std::chrono::nanoseconds(m_max);
+            }
+
+            inline auto GetMean() const -> std::chrono::nanoseconds {
+                return std::chrono::nanoseconds(m_count == 0 ? 0 : m_sum / m_count);
+            }
+
+            /**
+             * @brief Returns the upper bound of the bucket holding a percentile.
+             *
+             * @param `percentile`: A value in [0, 100].
+             *
+             * @return `std::chrono::nanoseconds`: Latency of the percentile,
+             * never larger than the recorded maximum.
+             *
+             */
+            inline auto GetPercentile(double percentile) const -> std::chrono::nanoseconds {
+                if (m_count == 0) {
+                    return std::chrono::nanoseconds(0);
+                }
+
+                uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(m_count)));
+                rank = std::clamp<uint64_t>(rank, 1, m_count);
+
+                uint64_t seen{0};
+                for (size_t i = 0; i < m_buckets.size(); i++) {
+                    seen += m_buckets[i];
+                    if (seen >= rank) {
+                        return std::chrono::nanoseconds(std::min(GetBucketUpperBound(i), m_max));
+                    }
+                }
+
+                return GetMax();
+            }
+
+            inline auto Reset() -> void {
+                m_buckets.fill(0);
+                m_count = 0;
+                m_sum = 0;
+                m_max = 0;
+            }
+
+        private:
+            // Values below s_subBuckets get a bucket each, everything else
+            // is indexed by its most significant bit and the bits right after it.
+            static inline constexpr auto GetBucketIndex(uint64_t value) -> size_t {
+                if (value < s_subBuckets) {
+                    return value;
+                }
+
+                size_t magnitude = std::bit_width(value) - 1;
+                if (magnitude >= s_magnitudes + s_subBucketBits) {
+                    return s_bucketCount - 1;
+                }
+
+                size_t subBucket = (value >> (magnitude - s_subBucketBits)) & (s_subBuckets - 1);
+                return (magnitude - s_subBucketBits + 1) * s_subBuckets + subBucket;
+            }
+
+            static inline constexpr auto GetBucketUpperBound(size_t index) -> uint64_t {
+                if (index < s_subBuckets) {
+                    return index;
+                }
+
+                size_t magnitude = index / s_subBuckets + s_subBucketBits - 1;
+                uint64_t subBucket = index % s_subBuckets;
+                uint64_t width = uint64_t{1} << (magnitude - s_subBucketBits);
+                return ((s_subBuckets | subBucket) + 1) * width - 1;
+            }
+
+            static constexpr size_t s_bucketCount = (s_magnitudes + 1) * s_subBuckets;
+
+            std::array<uint64_t, s_bucketCount> m_buckets{};
+            uint64_t m_count{0};
+            uint64_t m_sum{0};
+            uint64_t m_max{0};
+    };
+
+    /**
+     * @brief Publish and handler statistics of a single event value.
+     * @details Recording is off by default and costs a single branch per
+     * publish and per subscriber while off. Once enabled through
+     * `SetEnabled`, every publish and every handler call of every event
+     * value gets counted and timed. Statistics are only ever touched
+     * from the display thread.
+     *
+     */
+    class EventStatistics {
+        public:
+            /**
+             * @brief Details about a handler exceeding the slow handler threshold.
+             *
+             */
+            struct SlowHandler {
+                std::string_view EventName;
+                std::string_view SubscriberLabel;
+                size_t HandlerIndex{0};
+                std::chrono::nanoseconds Latency{0};
+            };
+
+            using SlowHandlerCallback_t = std::function<void(const SlowHandler&)>;
+
+            /**
+             * @brief Returns the statistics of an event value.
+             * @details The statistics are registered for `Export` on
+             * first access.
+             *
+             */
+            template <auto Event>
+            static inline auto Get() -> EventStatistics& {
+                static EventStatistics &statistics = Register(GetEventName<Event>());
+                return statistics;
+            }
+
+            static inline auto IsEnabled() -> bool {
+                return s_enabled;
+            }
+
+            static inline auto SetEnabled(bool enabled) -> void {
+                s_enabled = enabled;
+            }
+
+            /**
+             * @brief Sets a budget handlers are expected to stay within.
+             * @details Handler calls taking longer are counted as slow
+             * and reported to the slow handler callback, which by default
+             * logs them to `std::cerr`.
+             *
+             * @param `threshold`: Budget per handler call, or `std::nullopt`
+             * to disable slow handler detection.
+             *
+             */
+            static inline auto SetSlowHandlerThreshold(std::optional<std::chrono::nanoseconds> threshold) -> void {
+                s_slowHandlerThreshold = threshold;
+            }
+
+            static inline auto SetSlowHandlerCallback(SlowHandlerCallback_t callback) -> void {
+                s_slowHandlerCallback = std::move(callback);
+            }
+
+            /**
+             * @brief Writes the statistics of every event value as text.
+             * @details One line per event value with its publish and handler
+             * counts and handler latency percentiles, in the order the
+             * event values were first recorded.
+             *
+             */
+            static inline auto Export(std::ostream &stream) -> void {
+                for (const EventStatistics *statistics : GetRegistry()) {
+                    statistics->Write(stream);
+                }
+            }
+
+            static inline auto ResetAll() -> void {
+                for (EventStatistics *statistics : GetRegistry()) {
+                    statistics->Reset();
+                }
+            }
+
+            inline auto RecordPublish(std::chrono::nanoseconds latency) -> void {
+                m_publishLatency.Record(latency);
+            }
+
+            inline auto RecordHandler(std::chrono::nanoseconds latency, std::string_view subscriberLabel, size_t handlerIndex) -> void {
+                m_handlerLatency.Record(latency);
+
+                if (s_slowHandlerThreshold.has_value() && latency > s_slowHandlerThreshold.value()) {
+                    m_slowHandlerCount++;
+
+                    SlowHandler slowHandler{
+                        .EventName = m_eventName,
+                        .SubscriberLabel = subscriberLabel,
+                        .HandlerIndex = handlerIndex,
+                        .Latency = latency
+                    };
+
+                    if (s_slowHandlerCallback) {
+                        s_slowHandlerCallback(slowHandler);
+                    } else {
+                        std::cerr << __PRETTY_FUNCTION__ << ": "
+                                  << "Slow handler #" << slowHandler.HandlerIndex
+                                  << " of " << (slowHandler.SubscriberLabel.empty() ? "<unlabeled>" : slowHandler.SubscriberLabel)
+                                  << " for " << slowHandler.EventName
+                                  << " took " << std::chrono::duration_cast<std::chrono::microseconds>(slowHandler.Latency).count() << "us"
+                                  << std::endl;
+                    }
+                }
+            }
+
+            inline auto GetEventName() const -> std::string_view {
+                return m_eventName;
+            }
+
+            inline auto GetPublishCount() const -> uint64_t {
+                return m_publishLatency.GetCount();
+            }
+
+            inline auto GetSlowHandlerCount() const -> uint64_t {
+                return m_slowHandlerCount;
+            }
+
+            inline auto GetPublishLatency() const -> const LatencyHistogram& {
+                return m_publishLatency;
+            }
+
+            inline auto GetHandlerLatency() const -> const LatencyHistogram& {
+                return m_handlerLatency;
+            }
+
+            inline auto Reset() -> void {
+                m_publishLatency.Reset();
+                m_handlerLatency.Reset();
+                m_slowHandlerCount = 0;
+            }
+
+            inline auto Write(std::ostream &stream) const -> void {
+                auto microseconds = [](std::chrono::nanoseconds latency) -> double {
+                    return std::chrono::duration<double, std::micro>(latency).count();
+                };
+
+                std::ios_base::fmtflags flags = stream.flags();
+                stream << m_eventName
+                       << " publishes=" << GetPublishCount()
+                       << " handlers=" << m_handlerLatency.GetCount()
+                       << " slow=" << m_slowHandlerCount
+                       << std::fixed << std::setprecision(2)
+                       << " handler_us{mean=" << microseconds(m_handlerLatency.GetMean())
+                       << " p50=" << microseconds(m_handlerLatency.GetPercentile(50))
+                       << " p90=" << microseconds(m_handlerLatency.GetPercentile(90))
+                       << " p99=" << microseconds(m_handlerLatency.GetPercentile(99))
+                       << " max=" << microseconds(m_handlerLatency.GetMax())
+                       << "} publish_us{p99=" << microseconds(m_publishLatency.GetPercentile(99))
+                       << " max=" << microseconds(m_publishLatency.GetMax())
+                       << "}" << std::endl;
+                stream.flags(flags);
+            }
+
+            /**
+             * @brief Returns the qualified name of an event value.
+             * @details Extracted from the compiler's pretty function
+             * name, so it needs no RTTI, e.g.
+             * `moco::backend::LibInput::Events::KeyboardKey`.
+             *
+             */
+            template <auto Event>
+            static inline auto GetEventName() -> std::string_view {
+                std::string_view name = __PRETTY_FUNCTION__;
+                size_t begin = name.find("Event = ");
+                if (begin == std::string_view::npos) {
+                    return name;
+                }
+
+                name.remove_prefix(begin + std::string_view("Event = ").size());
+                return name.substr(0, name.find_first_of(";]"));
+            }
+
+        private:
+            explicit EventStatistics(std::string_view eventName) :
+                m_eventName(eventName) {}
+
+            static inline auto Register(std::string_view eventName) -> EventStatistics& {
+                // Never freed, statistics live as long as their event values
+                EventStatistics *statistics = new EventStatistics(eventName);
+                GetRegistry().push_back(statistics);
+                return *statistics;
+            }
+
+            static inline auto GetRegistry() -> std::vector<EventStatistics*>& {
+                static std::vector<EventStatistics*> registry;
+                return registry;
+            }
+
+            std::string_view m_eventName;
+            LatencyHistogram m_publishLatency;
+            LatencyHistogram m_handlerLatency;
+            uint64_t m_slowHandlerCount{0};
+
+            inline static bool s_enabled{false};
+            inline static std::optional<std::chrono::nanoseconds> s_slowHandlerThreshold{};
+            inline static SlowHandlerCallback_t s_slowHandlerCallback{};
+    };
+}  // namespace moco::compositor
@@ -1,56 +1,119 @@
 #pragma once
 
 #include <vector>
-#include <string>
-#include <any>
 #include <functional>
 #include <algorithm>
 #include <memory>
 #include <iostream>
-#include <typeindex>
-#include <unordered_map>
 #include <optional>
+#include <type_traits>
+#include <concepts>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <system_error>
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "EventStatistics.hpp"
 
 namespace moco::compositor {
-    template <typename EventType>
+    /**
+     * @brief Binds a payload type to a specific event value.
+     * @details Every event value that gets published must specialize
+     * this template with a `Type` alias naming the data passed to the
+     * subscribers of that event, e.g.
+     *
+     *     template <>
+     *     struct EventPayload<Keyboard::Events::Key> {
+     *         using Type = Keyboard::Key_EventData;
+     *     };
+     *
+     * Publishing or subscribing to an event value without a payload
+     * binding is a compile time error.
+     *
+     * A specialization may additionally declare
+     *
+     *     static auto Coalesce(Type &queued, const Type &incoming) -> bool;
+     *
+     * to allow consecutive queued publishes of that event value to be
+     * merged into a single one (see `Events::Enqueue`). Returning `false`
+     * keeps both events, e.g. touch motion of two different slots.
+     *
+     */
+    template <auto Event>
+    struct EventPayload;
+
+    template <auto Event>
+    concept PublishableEvent = std::is_enum_v<decltype(Event)> && requires {
+        typename EventPayload<Event>::Type;
+    };
+
+    template <auto Event>
+    concept CoalescableEvent = PublishableEvent<Event> && requires (typename EventPayload<Event>::Type &queued, const typename EventPayload<Event>::Type &incoming) {
+        {EventPayload<Event>::Coalesce(queued, incoming)} -> std::same_as<bool>;
+    };
+
+    template <auto Event>
+    using EventPayload_t = typename EventPayload<Event>::Type;
+
+    template <auto Event>
     class EventSubscriber;
 
-    template <typename EventType>
-    using EventSubscriber_t = std::shared_ptr<EventSubscriber<EventType>>;
+    template <auto Event>
+    using EventSubscriber_t = std::shared_ptr<EventSubscriber<Event>>;
 
     /**
      * @brief Moco Event System
      * @details Provides a factory for event subscriptions
      * and a way to publish events with specific data.
      *
+     * Every event value has its own subscriber list, resolved at compile
+     * time, so publishing never looks anything up, never type-erases the
+     * payload and never allocates.
+     *
+     * Everything except `Post` must only be used from the display thread.
+     * Other threads hand events over with `Post`, which the display thread
+     * picks up through the wakeup fd and `DispatchPosted`.
+     *
      */
     class Events {
         struct Private {explicit Private() = default;};
-        template <class EventType>
+        template <auto Event>
         friend class EventSubscriber;
         public:
-            using CallbackHandler_t = std::function<void(std::any)>;
+            template <auto Event>
+            using CallbackHandler_t = std::function<void(const EventPayload_t<Event>&)>;
+            using DispatchScheduler_t = std::function<void()>;
 
             /**
              * @brief Subscribes to a specific event.
-             * @details Subscribes to an event `event`, and allows
+             * @details Subscribes to an event `Event`, and allows
              * a callback to be added to the subscription during
              * subscribe time.
              *
-             * @param `event`: A specific event to subscribe to and recieve signals to.
+             * @tparam `Event`: A specific event to subscribe to and recieve signals to.
              * @param `callback`: [Optional] A function to call when the event is published.
-             * The callback must be of `CallbackHandler_t`.
+             * The callback must be of `CallbackHandler_t<Event>`.
              *
-             * @return `EventSubscriber_t<EventType>`: An object representing a subscription
+             * @return `EventSubscriber_t<Event>`: An object representing a subscription
              * to a specific event.
              *
              */
-            template <typename EventType>
-            static inline auto Subscribe(EventType event, std::optional<CallbackHandler_t> callback = std::nullopt) -> EventSubscriber_t<EventType> {
-                std::shared_ptr<EventSubscriber<EventType>> subscriber = std::make_shared<EventSubscriber<EventType>>(Private(), event);
-                s_subscribers[typeid(EventType)].push_back(std::make_any<EventSubscriber<EventType>*>(subscriber.get()));
+            template <auto Event> requires PublishableEvent<Event>
+            static inline auto Subscribe(std::optional<CallbackHandler_t<Event>> callback = std::nullopt) -> EventSubscriber_t<Event> {
+                std::shared_ptr<EventSubscriber<Event>> subscriber = std::make_shared<EventSubscriber<Event>>(Private());
+                s_subscribers<Event>.Subscribers.push_back(subscriber.get());
                 if (callback.has_value()) {
-                    subscriber->AddHandler(callback.value());
+                    subscriber->AddHandler(std::move(callback.value()));
                 }
 
                 return subscriber;
@@ -58,70 +121,455 @@ namespace moco::compositor {
 
             /**
              * @brief Publish to a specific event.
-             * @details Publishes an event along with any
+             * @details Publishes an event along with its
              * event data to any potential subscribers.
              *
-             * @param `event`: A specific event to publish to.
-             * @param `eventData`: [Optional] Type-erased data to
-             * pass to the event subscribers callbacks.
+             * @tparam `Event`: A specific event to publish to.
+             * @param `eventData`: Data to pass to the event subscribers
+             * callbacks, of the type bound through `EventPayload<Event>`.
              *
              * @return `size_t`: Amount of callbacks called due to the publication
-             * of `event`.
+             * of `Event`.
              *
              */
-            template <typename EventType>
-            static inline auto Publish(EventType event, std::any eventData = {}) -> size_t {
+            template <auto Event> requires PublishableEvent<Event>
+            static inline auto Publish(const EventPayload_t<Event> &eventData) -> size_t {
+                SubscriberList<Event> &list = s_subscribers<Event>;
                 size_t numCalled{0};
 
-                // If it does not contain the type, then there are def no subscribers.
-                if (s_subscribers.contains(typeid(EventType))) {
-                    for (const std::any &subscriber : s_subscribers.at(typeid(EventType))) {
-                        EventSubscriber<EventType>* eventSubscriber = std::any_cast<EventSubscriber<EventType>*>(subscriber);
-                        
-                        // Should be valid, I hope?
-                        if (eventSubscriber) {
-                            if (eventSubscriber->GetSubscribedEvent() == event) {
-                                numCalled += (*eventSubscriber)(eventData);
-                            }
-                        } else {
-                            std::cerr << __PRETTY_FUNCTION__ << ": "
-                                      << "Invalid pointer found. "
-                                      << "This shouldn't happen and is a bug." << std::endl;
-                        }
+                const bool recordStatistics = EventStatistics::IsEnabled();
+                const std::chrono::steady_clock::time_point publishStart = recordStatistics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+                // Subscribers added by a callback are only called on the
+                // next publish, ones removed are nulled out and erased once
+                // the outermost publish returns.
+                const size_t subscriberCount = list.Subscribers.size();
+                list.PublishDepth++;
+                for (size_t i = 0; i < subscriberCount; i++) {
+                    if (EventSubscriber<Event> *eventSubscriber = list.Subscribers[i]) {
+                        numCalled += (*eventSubscriber)(eventData);
+                    }
+                }
+
+                if (--list.PublishDepth == 0 && list.HasErased) {
+                    std::erase(list.Subscribers, nullptr);
+                    list.HasErased = false;
+                }
+
+                if (recordStatistics) {
+                    EventStatistics::Get<Event>().RecordPublish(std::chrono::steady_clock::now() - publishStart);
+                }
+
+                return numCalled;
+            }
+
+            /**
+             * @brief Queues a publish of a specific event.
+             * @details The event is published on the next call to
+             * `Dispatch`, in the order it was queued in. If the last
+             * queued event is the same event value and that value declares
+             * `EventPayload<Event>::Coalesce`, the two are merged instead.
+             *
+             * The dispatch scheduler is invoked when the queue goes from
+             * empty to non-empty, so at most one dispatch is scheduled
+             * per drain.
+             *
+             * @tparam `Event`: A specific event to publish to.
+             * @param `eventData`: Data to pass to the event subscribers
+             * callbacks once dispatched.
+             *
+             */
+            template <auto Event> requires PublishableEvent<Event>
+            static inline auto Enqueue(EventPayload_t<Event> eventData) -> void {
+                if constexpr (CoalescableEvent<Event>) {
+                    if (!s_queue.empty() && s_queue.back().template Coalesce<Event>(eventData)) {
+                        return;
                     }
                 }
 
+                PushQueuedEvent(QueuedEvent::Create<Event>(std::move(eventData)));
+            }
+
+            /**
+             * @brief Hands a publish of a specific event over to the display thread.
+             * @details Safe to call from any thread. The event is placed in a
+             * lock-free, bounded multi-producer ring and the display thread is
+             * woken through the fd from `GetWakeupFd`. The payload must not
+             * reference anything owned by the display thread.
+             *
+             * @tparam `Event`: A specific event to publish to.
+             * @param `eventData`: Data to pass to the event subscribers
+             * callbacks once dispatched.
+             *
+             * @return `bool`: False if the ring is full and the event got dropped.
+             *
+             */
+            template <auto Event> requires PublishableEvent<Event>
+            static inline auto Post(EventPayload_t<Event> eventData) -> bool {
+                return GetPostQueue().Push(QueuedEvent::Create<Event>(std::move(eventData)));
+            }
+
+            /**
+             * @brief Returns the fd signalling posted events.
+             * @details Becomes readable whenever `Post` was called since the
+             * last `DispatchPosted`. Meant to be added to the display event
+             * loop.
+             *
+             * @return `int`: An eventfd.
+             *
+             */
+            static inline auto GetWakeupFd() -> int {
+                return GetPostQueue().GetWakeupFd();
+            }
+
+            /**
+             * @brief Publishes every event posted from other threads.
+             * @details Posted events go through the same queue as `Enqueue`,
+             * so they are coalesced and published in order along with any
+             * other queued event.
+             *
+             * @return `size_t`: Amount of callbacks called.
+             *
+             */
+            static inline auto DispatchPosted() -> size_t {
+                PostQueue &postQueue = GetPostQueue();
+                postQueue.ClearWakeup();
+
+                std::optional<QueuedEvent> queuedEvent;
+                while ((queuedEvent = postQueue.Pop()).has_value()) {
+                    PushQueuedEvent(std::move(queuedEvent.value()));
+                }
+
+                return Dispatch();
+            }
+
+            /**
+             * @brief Publishes every queued event.
+             * @details Meant to be called once per event loop iteration
+             * or once per output frame. Events queued by the handlers
+             * themselves are left for the next dispatch.
+             *
+             * @return `size_t`: Amount of callbacks called.
+             *
+             */
+            static inline auto Dispatch() -> size_t {
+                if (s_dispatching) {
+                    return 0;
+                }
+
+                size_t numCalled{0};
+
+                // Both queues keep their capacity, so steady state queueing
+                // doesn't allocate.
+                std::swap(s_queue, s_dispatchQueue);
+                s_dispatching = true;
+                for (QueuedEvent &queuedEvent : s_dispatchQueue) {
+                    numCalled += queuedEvent.Publish();
+                }
+                s_dispatching = false;
+                s_dispatchQueue.clear();
+
+                // Handlers may have queued more events while dispatching
+                if (!s_queue.empty() && s_dispatchScheduler) {
+                    s_dispatchScheduler();
+                }
+
                 return numCalled;
             }
 
+            /**
+             * @brief Sets how a queue dispatch gets scheduled.
+             * @details Usually adds an idle source to the display
+             * event loop which calls `Dispatch`.
+             *
+             * @param `scheduler`: A function that arranges for
+             * `Dispatch` to be called.
+             *
+             */
+            static inline auto SetDispatchScheduler(DispatchScheduler_t scheduler) -> void {
+                s_dispatchScheduler = std::move(scheduler);
+            }
+
         private:
-            template <typename EventType>
-            static inline auto Unsubscribe(EventSubscriber<EventType> *subscription) -> bool {
-                if (s_subscribers.contains(typeid(EventType))) {
-                    std::vector<std::any> &eventSubscribers = s_subscribers.at(typeid(EventType));
-                    size_t numErased = std::erase_if(eventSubscribers, [subscription](std::any subscriber) -> bool {
-                        // Guarenteed to be of type EventSubscriber<EventType> due to the contains call above.
-                        EventSubscriber<EventType> *eventSubscriber = std::any_cast<EventSubscriber<EventType>*>(subscriber);
+            /**
+             * @brief A type-erased, queued publish of an event.
+             * @details Payloads are stored inline, so queueing an event
+             * never allocates.
+             *
+             */
+            class QueuedEvent {
+                public:
+                    static constexpr size_t s_storageSize = 64;
+
+                    template <auto Event>
+                    static inline auto Create(EventPayload_t<Event> &&eventData) -> QueuedEvent {
+                        static_assert(sizeof(EventPayload_t<Event>) <= s_storageSize, "Event payload is too large to be queued.");
+                        static_assert(alignof(EventPayload_t<Event>) <= alignof(std::max_align_t), "Event payload is over-aligned.");
+
+                        QueuedEvent queuedEvent;
+                        new (queuedEvent.m_storage) EventPayload_t<Event>(std::move(eventData));
+                        queuedEvent.m_operations = &s_operations<Event>;
+
+                        return queuedEvent;
+                    }
 
-                        return eventSubscriber == subscription;
-                    });
+                    inline QueuedEvent(QueuedEvent &&other) noexcept :
+                        m_operations(other.m_operations)
+                    {
+                        if (m_operations) {
+                            m_operations->Move(m_storage, other.m_storage);
+                        }
+                    }
+
+                    inline auto operator=(QueuedEvent &&other) noexcept -> QueuedEvent& {
+                        if (this != &other) {
+                            Reset();
+                            m_operations = other.m_operations;
+                            if (m_operations) {
+                                m_operations->Move(m_storage, other.m_storage);
+                            }
+                        }
+
+                        return *this;
+                    }
+
+                    inline ~QueuedEvent() {
+                        Reset();
+                    }
+
+                    inline auto Publish() -> size_t {
+                        return m_operations ? m_operations->Publish(m_storage) : 0;
+                    }
+
+                    template <auto Event>
+                    inline auto Coalesce(const EventPayload_t<Event> &incoming) -> bool {
+                        if (m_operations != &s_operations<Event>) {
+                            return false;
+                        }
+
+                        return EventPayload<Event>::Coalesce(Payload<Event>(m_storage), incoming);
+                    }
+
+                    inline auto Coalesce(QueuedEvent &incoming) -> bool {
+                        if (!m_operations || m_operations != incoming.m_operations || !m_operations->Coalesce) {
+                            return false;
+                        }
+
+                        return m_operations->Coalesce(m_storage, incoming.m_storage);
+                    }
+
+                    QueuedEvent() = default;
+
+                private:
+                    struct Operations {
+                        size_t (*Publish)(std::byte *storage);
+                        bool (*Coalesce)(std::byte *queued, std::byte *incoming);
+                        void (*Move)(std::byte *destination, std::byte *source);
+                        void (*Destroy)(std::byte *storage);
+                    };
+
+                    template <auto Event>
+                    static inline auto Payload(std::byte *storage) -> EventPayload_t<Event>& {
+                        return *std::launder(reinterpret_cast<EventPayload_t<Event>*>(storage));
+                    }
+
+                    // One table per event value, its address doubles as the
+                    // identity of the queued event.
+                    template <auto Event>
+                    static constexpr Operations s_operations{
+                        .Publish = [](std::byte *storage) -> size_t {
+                            return Events::Publish<Event>(Payload<Event>(storage));
+                        },
+                        .Coalesce = [] {
+                            if constexpr (CoalescableEvent<Event>) {
+                                return [](std::byte *queued, std::byte *incoming) -> bool {
+                                    return EventPayload<Event>::Coalesce(Payload<Event>(queued), Payload<Event>(incoming));
+                                };
+                            } else {
+                                return static_cast<bool (*)(std::byte*, std::byte*)>(nullptr);
+                            }
+                        }(),
+                        .Move = [](std::byte *destination, std::byte *source) -> void {
+                            new (destination) EventPayload_t<Event>(std::move(Payload<Event>(source)));
+                        },
+                        .Destroy = [](std::byte *storage) -> void {
+                            std::destroy_at(&Payload<Event>(storage));
+                        }
+                    };
+
+                    inline auto Reset() -> void {
+                        if (m_operations) {
+                            m_operations->Destroy(m_storage);
+                            m_operations = nullptr;
+                        }
+                    }
+
+                    const Operations *m_operations{nullptr};
+                    alignas(std::max_align_t) std::byte m_storage[s_storageSize];
+            };
+
+            /**
+             * @brief Bounded multi-producer, single-consumer ring of queued events.
+             * @details Producers claim a cell with a single compare-and-swap on
+             * the enqueue position and publish it through the cell's sequence
+             * number, so neither side ever takes a lock. Only the display
+             * thread consumes.
+             *
+             */
+            class PostQueue {
+                public:
+                    static constexpr size_t s_capacity = 1024;
+                    static_assert((s_capacity & (s_capacity - 1)) == 0, "Capacity must be a power of two.");
+
+                    inline PostQueue() :
+                        m_wakeupFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+                    {
+                        if (m_wakeupFd == -1) {
+                            throw std::system_error(std::error_code(errno, std::system_category()));
+                        }
+
+                        for (size_t i = 0; i < s_capacity; i++) {
+                            m_cells[i].Sequence.store(i, std::memory_order_relaxed);
+                        }
+                    }
+
+                    inline ~PostQueue() {
+                        close(m_wakeupFd);
+                    }
+
+                    inline auto Push(QueuedEvent &&queuedEvent) -> bool {
+                        size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+                        Cell *cell;
+                        while (true) {
+                            cell = &m_cells[position & (s_capacity - 1)];
+                            size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+                            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                            if (difference == 0) {
+                                if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                                    break;
+                                }
+                            } else if (difference < 0) {
+                                // The consumer hasn't caught up, ring is full
+                                return false;
+                            } else {
+                                position = m_enqueuePosition.load(std::memory_order_relaxed);
+                            }
+                        }
 
-                    if (eventSubscribers.empty()) {
-                        // Remove if empty
-                        s_subscribers.erase(typeid(EventType));
+                        cell->Event = std::move(queuedEvent);
+                        cell->Sequence.store(position + 1, std::memory_order_release);
+
+                        // Only the first post since the last drain has to wake
+                        // up the display thread.
+                        if (!m_wakeupPending.exchange(true, std::memory_order_acq_rel)) {
+                            uint64_t count{1};
+                            [[maybe_unused]] ssize_t written = write(m_wakeupFd, &count, sizeof(count));
+                        }
+
+                        return true;
+                    }
+
+                    inline auto Pop() -> std::optional<QueuedEvent> {
+                        Cell &cell = m_cells[m_dequeuePosition & (s_capacity - 1)];
+                        if (cell.Sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1) {
+                            return std::nullopt;
+                        }
+
+                        std::optional<QueuedEvent> queuedEvent{std::move(cell.Event)};
+                        cell.Event = QueuedEvent();
+                        cell.Sequence.store(m_dequeuePosition + s_capacity, std::memory_order_release);
+                        m_dequeuePosition++;
+
+                        return queuedEvent;
+                    }
+
+                    // Must happen before popping, so a post racing with the
+                    // drain still results in a wakeup. A plain store could be
+                    // reordered after the loads in `Pop`, as a read-modify-write
+                    // it's ordered against the producer's exchange: either the
+                    // producer sees false and writes the eventfd, or this
+                    // reads its true and then sees its cell.
+                    inline auto ClearWakeup() -> void {
+                        m_wakeupPending.exchange(false, std::memory_order_acq_rel);
+
+                        uint64_t count;
+                        [[maybe_unused]] ssize_t bytesRead = read(m_wakeupFd, &count, sizeof(count));
                     }
 
-                    return numErased != 0;
+                    inline auto GetWakeupFd() const -> int {
+                        return m_wakeupFd;
+                    }
+
+                private:
+                    struct Cell {
+                        std::atomic<size_t> Sequence;
+                        QueuedEvent Event;
+                    };
+
+                    int m_wakeupFd;
+                    std::atomic<bool> m_wakeupPending{false};
+
+                    alignas(64) std::atomic<size_t> m_enqueuePosition{0};
+                    alignas(64) size_t m_dequeuePosition{0};
+                    std::array<Cell, s_capacity> m_cells;
+            };
+
+            static inline auto GetPostQueue() -> PostQueue& {
+                // Constructed on first use, the ring is of no use to
+                // compositors that never post.
+                static PostQueue postQueue;
+                return postQueue;
+            }
+
+            static inline auto PushQueuedEvent(QueuedEvent &&queuedEvent) -> void {
+                if (!s_queue.empty() && s_queue.back().Coalesce(queuedEvent)) {
+                    return;
+                }
+
+                s_queue.push_back(std::move(queuedEvent));
+
+                // A running dispatch reschedules on its own once it's done
+                if (s_queue.size() == 1 && !s_dispatching && s_dispatchScheduler) {
+                    s_dispatchScheduler();
+                }
+            }
+
+            template <auto Event>
+            struct SubscriberList {
+                std::vector<EventSubscriber<Event>*> Subscribers;
+                size_t PublishDepth{0};
+                bool HasErased{false};
+            };
+
+            template <auto Event>
+            static inline auto Unsubscribe(EventSubscriber<Event> *subscription) -> bool {
+                SubscriberList<Event> &list = s_subscribers<Event>;
+                auto subscriber = std::find(list.Subscribers.begin(), list.Subscribers.end(), subscription);
+                if (subscriber == list.Subscribers.end()) {
+                    return false;
                 }
 
-                return false;
+                // Don't shift the list under a running publish
+                if (list.PublishDepth != 0) {
+                    *subscriber = nullptr;
+                    list.HasErased = true;
+                } else {
+                    list.Subscribers.erase(subscriber);
+                }
+
+                return true;
             }
 
-            // std::any -> EventSubscriber<*> *
             // Safety ensured by the pointer only existing while the object
             // exists, the destruction of the object removes its pointer from
             // this container before it fully destructs.
-            inline static std::unordered_map<std::type_index, std::vector<std::any>> s_subscribers{};
+            template <auto Event>
+            inline static SubscriberList<Event> s_subscribers{};
+
+            inline static std::vector<QueuedEvent> s_queue{};
+            inline static std::vector<QueuedEvent> s_dispatchQueue{};
+            inline static bool s_dispatching{false};
+            inline static DispatchScheduler_t s_dispatchScheduler{};
     };
 
     /**
@@ -132,15 +580,14 @@ namespace moco::compositor {
      * unsubscribes from its event.
      *
      */
-    template <typename EventType>
+    template <auto Event>
     class EventSubscriber {
         friend class Events;
         public:
-            EventSubscriber(Events::Private, EventType event) :
-                m_subscribedEvent(event) {}
+            EventSubscriber(Events::Private) {}
 
             inline ~EventSubscriber() {
-                if (!Events::Unsubscribe<EventType>(this)) {
+                if (!Events::Unsubscribe<Event>(this)) {
                     std::cerr << __PRETTY_FUNCTION__ << ": "
                               << "Failed to unsubscribe from event."
                               << std::endl;
@@ -154,37 +601,61 @@ namespace moco::compositor {
              * event gets published.
              *
              * @param `callbackHandler`: A function to call which follows
-             * the type `Events::CallbackHandler_t`
+             * the type `Events::CallbackHandler_t<Event>`
+             *
+             */
+            inline auto AddHandler(Events::CallbackHandler_t<Event> callbackHandler) -> void {
+                m_handlers.push_back(std::move(callbackHandler));
+            }
+
+            /**
+             * @brief Names the subscription in event statistics.
+             * @details Used to tell apart subscribers of the same event
+             * when reporting slow handlers.
+             *
+             * @param `label`: A human readable name, e.g. the handling function.
              *
              */
-            inline auto AddHandler(Events::CallbackHandler_t callbackHandler) -> void {
-                m_handlers.push_back(callbackHandler);
+            inline auto SetLabel(std::string label) -> void {
+                m_label = std::move(label);
+            }
+
+            inline auto GetLabel() const -> std::string_view {
+                return m_label;
             }
 
             /**
              * @brief Returns the event this object is subscribed to.
              *
-             * @return `EventType`: Subscribed event.
+             * @return `decltype(Event)`: Subscribed event.
              *
              */
-            inline auto GetSubscribedEvent() const -> EventType {
-                return m_subscribedEvent;
+            inline constexpr auto GetSubscribedEvent() const -> decltype(Event) {
+                return Event;
             }
 
         private:
-            inline auto operator()(std::any callbackData) -> size_t {
-                size_t numCalled{0};
-                std::for_each(std::begin(m_handlers), std::end(m_handlers), [callbackData, &numCalled](Events::CallbackHandler_t callback) -> void {
-                    callback(callbackData);
-                    numCalled++;
-                });
+            inline auto operator()(const EventPayload_t<Event> &callbackData) -> size_t {
+                if (!EventStatistics::IsEnabled()) {
+                    for (const Events::CallbackHandler_t<Event> &callback : m_handlers) {
+                        callback(callbackData);
+                    }
 
-                return numCalled;
-            }
+                    return m_handlers.size();
+                }
 
-            std::vector<Events::CallbackHandler_t> m_handlers;
+                EventStatistics &statistics = EventStatistics::Get<Event>();
+                for (size_t i = 0; i < m_handlers.size(); i++) {
+                    std::chrono::steady_clock::time_point handlerStart = std::chrono::steady_clock::now();
+                    m_handlers[i](callbackData);
+                    statistics.RecordHandler(std::chrono::steady_clock::now() - handlerStart, m_label, i);
+                }
+
+                return m_handlers.size();
+            }
 
-            EventType m_subscribedEvent;
+            std::vector<Events::CallbackHandler_t<Event>> m_handlers;
+            std::string m_label;
     };
 
 }  // namespace moco::compositor
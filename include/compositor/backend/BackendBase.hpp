@@ -2,20 +2,24 @@
 
 #include <wayland-server-protocol.hpp>
 #include <memory>
+#include <cstdint>
+
+#include <time.h>
 
 namespace moco::backend {
     template <class Derived>
     class BackendBase {
         protected:
-            struct Private {explicit Private();};
+            struct Private {explicit Private() = default;};
 
         public:
-            BackendBase(Private);
+            BackendBase(Private) {}
+            virtual ~BackendBase() = default;
 
             template <typename ...Args>
             inline static auto Initialize(::wayland::server::display_t display, Args ...args) -> void {
                 if (!s_backendSingleton) {
-                    s_backendSingleton = std::make_shared(Derived(Private(), display, args...));
+                    s_backendSingleton = std::make_shared<Derived>(Private(), display, args...);
                 }
             }
 
@@ -26,6 +30,13 @@ namespace moco::backend {
         protected:
             virtual auto BackendLoop() -> void = 0;
 
+            // Same clock libinput timestamps events with
+            inline static auto GetMonotonicTimeUsec() -> uint64_t {
+                timespec time;
+                clock_gettime(CLOCK_MONOTONIC, &time);
+                return static_cast<uint64_t>(time.tv_sec) * 1'000'000 + time.tv_nsec / 1'000;
+            }
+
         private:
             inline static std::shared_ptr<Derived> s_backendSingleton;
     };
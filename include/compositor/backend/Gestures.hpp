@@ -0,0 +1,269 @@
+#pragma once
+
+#include "BackendBase.hpp"
+#include "Touch.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace moco::backend {
+    /**
+     * @brief Incremental touch gesture recognizer
+     * @details Recognizes edge swipes, pinches and holds one touch frame
+     * at a time. Every gesture is a small state machine stepping through
+     * `Idle`, `Possible`, `Active` and `Failed`, all state lives in fixed
+     * size members, so recognizing never allocates. Once a gesture turns
+     * active it claims the touch sequence and fails every other gesture
+     * still possible, until all fingers are lifted.
+     *
+     * Distances are in the normalized [0, 1] touch device space of
+     * `TouchState::Frame`. Independent of libinput, so it can be fed
+     * synthetic or recorded touch frames.
+     *
+     */
+    class GestureRecognizer {
+        public:
+            enum class Kind : uint8_t {
+                EdgeSwipe,
+                Pinch,
+                Hold
+            };
+
+            enum class Phase : uint8_t {
+                Begin,
+                Update,
+                End,
+                Cancel
+            };
+
+            enum class Edge : uint8_t {
+                Left,
+                Right,
+                Top,
+                Bottom
+            };
+
+            struct Config {
+                // Distance from an edge a swipe has to start within
+                double EdgeMargin{0.03};
+                // Inward distance an edge swipe has to travel to begin
+                double SwipeDistance{0.05};
+                // Relative change of finger distance a pinch has to reach to begin
+                double PinchThreshold{0.1};
+                // Rotation in radians a pinch has to reach to begin
+                double RotationThreshold{0.3};
+                uint64_t HoldTimeoutUsec{500'000};
+                // Distance fingers may move without failing a hold
+                double HoldSlop{0.01};
+            };
+
+            struct Gesture {
+                Kind GestureKind{Kind::EdgeSwipe};
+                Phase GesturePhase{Phase::Begin};
+                uint64_t TimeUsec{0};
+                uint32_t Fingers{0};
+
+                // Edge swipes only
+                Edge SwipeEdge{Edge::Left};
+                // Inward distance travelled per second
+                double Velocity{0};
+
+                // Finger centroid
+                double X{0};
+                double Y{0};
+                // Centroid movement since the gesture started
+                double Dx{0};
+                double Dy{0};
+
+                // Pinches only, relative to the start
+                double Scale{1};
+                double Rotation{0};
+            };
+
+            static constexpr size_t s_maxGesturesPerStep = 4;
+
+            /**
+             * @brief Gestures produced by a single step, in order.
+             *
+             */
+            struct Output {
+                std::array<Gesture, s_maxGesturesPerStep> Gestures{};
+                size_t Count{0};
+
+                inline auto Push(const Gesture &gesture) -> void {
+                    if (Count < Gestures.size()) {
+                        Gestures[Count++] = gesture;
+                    }
+                }
+            };
+
+            GestureRecognizer();
+            GestureRecognizer(Config config);
+
+            auto ProcessFrame(const TouchState::Frame &frame) -> Output;
+
+            /**
+             * @brief Advances time without a touch frame.
+             * @details A finger holding still produces no frames, the hold
+             * timeout is driven from here once `GetHoldDeadline` passed.
+             *
+             */
+            auto ProcessTimeout(uint64_t timeUsec) -> Output;
+
+            // The touch sequence got cancelled, every active gesture is cancelled with it
+            auto Cancel(uint64_t timeUsec) -> Output;
+
+            auto GetHoldDeadline() const -> std::optional<uint64_t>;
+
+            /**
+             * @brief Returns whether an active gesture owns the touch sequence.
+             * @details While claimed, the touch sequence is meant for the
+             * compositor only and shouldn't be delivered to clients.
+             *
+             */
+            auto IsClaimed() const -> bool;
+
+        private:
+            enum class State : uint8_t {
+                Idle,
+                Possible,
+                Active,
+                Failed
+            };
+
+            struct EdgeSwipeMachine {
+                State MachineState{State::Idle};
+                Edge SwipeEdge{Edge::Left};
+                size_t Slot{0};
+                double StartX{0};
+                double StartY{0};
+                double LastInward{0};
+                uint64_t LastTimeUsec{0};
+                double Velocity{0};
+            };
+
+            struct PinchMachine {
+                State MachineState{State::Idle};
+                uint32_t SlotMask{0};
+                double StartDistance{0};
+                double StartAngle{0};
+                double StartX{0};
+                double StartY{0};
+            };
+
+            struct HoldMachine {
+                State MachineState{State::Idle};
+                uint32_t Fingers{0};
+                double StartX{0};
+                double StartY{0};
+                uint64_t StartTimeUsec{0};
+            };
+
+            auto StepEdgeSwipe(const TouchState::Frame &frame, Output &output) -> void;
+            auto StepPinch(const TouchState::Frame &frame, Output &output) -> void;
+            auto StepHold(const TouchState::Frame &frame, Output &output) -> void;
+            auto BeginHold(uint64_t timeUsec, Output &output) -> void;
+
+            // Fails every other gesture still possible and cancels an active hold
+            auto Claim(Kind claimer, uint64_t timeUsec, Output &output) -> void;
+
+            static auto GetCentroid(const TouchState::Frame &frame, uint32_t mask, double &x, double &y) -> void;
+            static auto GetInwardDistance(Edge edge, double dx, double dy) -> double;
+            static auto GetSidewaysDistance(Edge edge, double dx, double dy) -> double;
+
+            Config m_config;
+
+            EdgeSwipeMachine m_edgeSwipe;
+            PinchMachine m_pinch;
+            HoldMachine m_hold;
+
+            uint32_t m_activeMask{0};
+    };
+
+    /**
+     * @brief Touch gesture backend
+     * @details Runs the frames of the `Touch` backend through a
+     * `GestureRecognizer` and publishes every recognized gesture as a
+     * typed event, synchronously within the touch frame's dispatch, so
+     * system gestures (app switcher, back) add no frame of latency.
+     * Gestures claiming the touch sequence `Touch::Claim` it, which
+     * cancels it for clients.
+     *
+     */
+    class Gestures : public BackendBase<Gestures> {
+        public:
+            enum class Events {
+                EdgeSwipe,
+                Pinch,
+                Hold
+            };
+
+            struct EdgeSwipe_EventData {
+                uint64_t TimeUsec{0};
+                GestureRecognizer::Phase Phase{GestureRecognizer::Phase::Begin};
+                GestureRecognizer::Edge Edge{GestureRecognizer::Edge::Left};
+                double Dx{0};
+                double Dy{0};
+                double Velocity{0};
+            };
+
+            struct Pinch_EventData {
+                uint64_t TimeUsec{0};
+                GestureRecognizer::Phase Phase{GestureRecognizer::Phase::Begin};
+                uint32_t Fingers{0};
+                double X{0};
+                double Y{0};
+                double Dx{0};
+                double Dy{0};
+                double Scale{1};
+                double Rotation{0};
+            };
+
+            struct Hold_EventData {
+                uint64_t TimeUsec{0};
+                GestureRecognizer::Phase Phase{GestureRecognizer::Phase::Begin};
+                uint32_t Fingers{0};
+                double X{0};
+                double Y{0};
+            };
+
+            Gestures(Private, ::wayland::server::display_t display, GestureRecognizer::Config config = {});
+            ~Gestures();
+
+            auto IsClaimed() const -> bool;
+
+        private:
+            // Runs when the hold timer fires
+            auto BackendLoop() -> void final;
+
+            auto EventFrame(const Touch::Frame_EventData &eventData) -> void;
+            auto Publish(const GestureRecognizer::Output &output) -> void;
+            auto UpdateTimer() -> void;
+
+            GestureRecognizer m_recognizer;
+
+            int m_timerFd;
+            std::optional<::wayland::server::event_source_t> m_timerSource;
+
+            compositor::EventSubscriber_t<Touch::Events::Frame> m_frameEvent;
+            compositor::EventSubscriber_t<Touch::Events::Cancel> m_cancelEvent;
+    };
+}  // namespace moco::backend
+
+namespace moco::compositor {
+    template <>
+    struct EventPayload<::moco::backend::Gestures::Events::EdgeSwipe> {
+        using Type = ::moco::backend::Gestures::EdgeSwipe_EventData;
+    };
+
+    template <>
+    struct EventPayload<::moco::backend::Gestures::Events::Pinch> {
+        using Type = ::moco::backend::Gestures::Pinch_EventData;
+    };
+
+    template <>
+    struct EventPayload<::moco::backend::Gestures::Events::Hold> {
+        using Type = ::moco::backend::Gestures::Hold_EventData;
+    };
+}  // namespace moco::compositor
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moco::backend {
+    /**
+     * @brief Binary input trace format
+     * @details A trace starts with a `FileHeader`, followed by records.
+     * Every record is a `RecordHeader` immediately followed by `Size`
+     * bytes of payload. Device records carry a `DeviceInfo` followed by
+     * the device name, event records carry the raw bytes of the event
+     * payload published on the event bus. Everything is stored in host
+     * byte order, traces are meant to be replayed on the architecture
+     * they were recorded on.
+     *
+     */
+    namespace InputTrace {
+        static constexpr std::array<char, 8> s_magic = {'M', 'O', 'C', 'O', 'I', 'N', 'P', 'T'};
+        static constexpr uint32_t s_version = 1;
+
+        enum class RecordKind : uint16_t {
+            Device = 0,
+            Event = 1
+        };
+
+        struct FileHeader {
+            std::array<char, 8> Magic{s_magic};
+            uint32_t Version{s_version};
+            uint32_t Reserved{0};
+        };
+
+        struct RecordHeader {
+            uint64_t TimeUsec{0};
+            RecordKind Kind{RecordKind::Event};
+            // Event enum value for event records
+            uint16_t Type{0};
+            uint16_t Device{0};
+            uint16_t Size{0};
+        };
+
+        struct DeviceInfo {
+            uint32_t Vendor{0};
+            uint32_t Product{0};
+            uint32_t Capabilities{0};
+            uint16_t NameLength{0};
+            uint16_t Reserved{0};
+        };
+
+        struct Record {
+            RecordHeader Header;
+            std::span<const std::byte> Payload;
+        };
+
+        /**
+         * @brief Appends records to a trace file.
+         * @details Buffered, the file is only complete once the writer
+         * is flushed or destroyed.
+         *
+         */
+        class Writer {
+            public:
+                Writer(const std::filesystem::path &path);
+
+                auto WriteDevice(uint16_t device, std::string_view name, uint32_t vendor, uint32_t product, uint32_t capabilities) -> void;
+                auto WriteEvent(uint64_t timeUsec, uint16_t device, uint16_t type, std::span<const std::byte> payload) -> void;
+                auto Flush() -> void;
+
+            private:
+                auto WriteRecord(const RecordHeader &header, std::span<const std::byte> payload) -> void;
+
+                std::ofstream m_stream;
+        };
+
+        /**
+         * @brief Reads a whole trace file into memory and iterates its records.
+         *
+         */
+        class Reader {
+            public:
+                Reader(const std::filesystem::path &path);
+
+                /**
+                 * @brief Returns the next record of the trace.
+                 *
+                 * @return `std::optional<Record>`: The record, or `std::nullopt`
+                 * at the end of the trace. The payload stays valid as long as
+                 * the reader does.
+                 *
+                 */
+                auto Next() -> std::optional<Record>;
+                auto Rewind() -> void;
+
+            private:
+                std::vector<std::byte> m_data;
+                size_t m_position{sizeof(FileHeader)};
+        };
+    }  // namespace InputTrace
+}  // namespace moco::backend
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <xkbcommon/xkbcommon.h>
+
+namespace moco::backend {
+    /**
+     * @brief Compositor key binding matcher
+     * @details Bindings are sequences of one or more chords, a chord being
+     * a modifier mask and a keysym. `Compile` turns all bindings into a
+     * trie whose edges live in a single flat open-addressing hash table,
+     * keyed by (trie node, modifiers, keysym), so matching a key press is
+     * one hash and a short linear probe regardless of how many bindings
+     * are loaded, and never allocates.
+     *
+     * Keys taking part in a match are consumed, their presses and the
+     * matching releases shouldn't be delivered to clients.
+     *
+     */
+    class KeyBindings {
+        public:
+            // Layout independent modifiers, as bindings are written
+            enum Modifier : uint32_t {
+                Shift = 1u << 0,
+                Ctrl = 1u << 1,
+                Alt = 1u << 2,
+                Logo = 1u << 3
+            };
+
+            struct Chord {
+                uint32_t Modifiers{0};
+                xkb_keysym_t Keysym{XKB_KEY_NoSymbol};
+            };
+
+            using Action_t = std::function<void()>;
+
+            static constexpr size_t s_maxSequenceLength = 4;
+
+            /**
+             * @brief Adds a binding.
+             * @details Takes effect on the next `Compile`.
+             *
+             * @param `sequence`: The chords to press in order.
+             * @param `action`: Called once the whole sequence was pressed.
+             *
+             * @return `bool`: False if the sequence is empty or longer
+             * than `s_maxSequenceLength`.
+             *
+             */
+            auto Add(std::span<const Chord> sequence, Action_t action) -> bool;
+
+            /**
+             * @brief Adds a binding written as text.
+             * @details Chords are separated by spaces, modifiers and the
+             * keysym name within a chord by `+`, e.g. `Logo+Shift+q` or
+             * `Ctrl+x Ctrl+c`. Keysym names are case insensitive.
+             *
+             * @return `bool`: False if the sequence can't be parsed.
+             *
+             */
+            auto Add(std::string_view sequence, Action_t action) -> bool;
+
+            auto Clear() -> void;
+
+            /**
+             * @brief Builds the lookup table from every added binding.
+             * @details A binding conflicting with an earlier one (the same
+             * sequence, or one being a prefix of the other) is skipped and
+             * logged. Resets any sequence in progress.
+             *
+             */
+            auto Compile() -> void;
+
+            /**
+             * @brief Matches a key press.
+             *
+             * @param `key`: evdev key code, to consume the matching release.
+             * @param `modifiers`: `Modifier` mask active before the press.
+             * @param `keysym`: Keysym of the key on the first shift level.
+             *
+             * @return `bool`: Whether the key was consumed, either finishing
+             * a binding (its action was called) or continuing a sequence.
+             *
+             */
+            auto Press(uint32_t key, uint32_t modifiers, xkb_keysym_t keysym) -> bool;
+
+            // Returns whether the key's press was consumed
+            auto Release(uint32_t key) -> bool;
+
+            // Abandons a sequence in progress
+            auto Reset() -> void;
+
+            auto IsPending() const -> bool;
+
+        private:
+            struct Binding {
+                std::array<Chord, s_maxSequenceLength> Sequence{};
+                size_t Length{0};
+                Action_t Action;
+            };
+
+            // A trie edge, either to another node or to an action
+            struct Entry {
+                uint64_t Key{s_emptyKey};
+                uint32_t Target{0};
+                bool IsAction{false};
+            };
+
+            static constexpr uint64_t s_emptyKey = ~uint64_t{0};
+            static constexpr uint32_t s_rootNode = 0;
+            // Nodes get 16 bits of the packed key
+            static constexpr uint32_t s_maxNode = 0xffff;
+            // Covers evdev's KEY_MAX
+            static constexpr size_t s_maxKeys = 0x300;
+
+            static auto PackKey(uint32_t node, uint32_t modifiers, xkb_keysym_t keysym) -> uint64_t;
+            static auto IsModifierKeysym(xkb_keysym_t keysym) -> bool;
+            static auto ParseChord(std::string_view text) -> std::optional<Chord>;
+
+            auto Find(uint64_t key) const -> const Entry*;
+            auto Insert(const Entry &entry) -> void;
+
+            std::vector<Binding> m_bindings;
+
+            std::vector<Entry> m_table;
+            int m_tableShift{64};
+            std::vector<Action_t> m_actions;
+
+            uint32_t m_node{s_rootNode};
+            std::bitset<s_maxKeys> m_consumedKeys;
+    };
+}  // namespace moco::backend
@@ -1,16 +1,70 @@
 #pragma once
 
 #include "BackendBase.hpp"
+#include "KeyBindings.hpp"
+#include "LibInput.hpp"
+#include "wayland/KeymapCache.hpp"
 
-#include <any>
-#include <libinput.h>
+#include <array>
+
+#include <xkbcommon/xkbcommon.h>
 
 namespace moco::backend {
+    /**
+     * @brief Keyboard backend
+     * @details Tracks the seat's xkb state from libinput key events and
+     * runs every key through the compositor's `KeyBindings` first. Keys
+     * consumed by a binding never reach clients, all others are published
+     * as `wl_keyboard` key events. Modifier events are only published when
+     * the serialized depressed/latched/locked/group state actually changed,
+     * so typing doesn't send a modifiers message per key.
+     *
+     */
     class Keyboard : public BackendBase<Keyboard> {
         public:
             Keyboard(Private, ::wayland::server::display_t display);
+            ~Keyboard();
+
+            /**
+             * @brief Returns the compositor key bindings.
+             * @details `KeyBindings::Compile` has to be called after
+             * changing them.
+             *
+             */
+            auto GetKeyBindings() -> KeyBindings&;
 
         private:
-            auto EventKeyboardKey(std::any eventData) -> void;
+            // Driven by LibInput events, there is nothing to poll
+            auto BackendLoop() -> void final;
+
+            auto EventKeyboardKey(const LibInput::KeyboardKey_EventData &keyboardEvent) -> void;
+
+            // Returns the active `KeyBindings::Modifier` mask
+            auto GetBindingModifiers() const -> uint32_t;
+            auto GetBaseKeysym(xkb_keycode_t keycode) const -> xkb_keysym_t;
+            auto UpdateModifiers() -> void;
+
+            struct ModifierState {
+                xkb_mod_mask_t Depressed{0};
+                xkb_mod_mask_t Latched{0};
+                xkb_mod_mask_t Locked{0};
+                xkb_layout_index_t Group{0};
+
+                auto operator==(const ModifierState &other) const -> bool = default;
+            };
+
+            ::wayland::server::display_t m_display;
+
+            wayland::implementation::KeymapCache::Keymap_t m_keymap;
+            xkb_state *m_xkbState;
+            // Last state published to clients
+            ModifierState m_modifierState;
+
+            // xkb masks of `KeyBindings::Modifier` bits, in bit order
+            std::array<xkb_mod_mask_t, 4> m_bindingModifierMasks{};
+
+            KeyBindings m_keyBindings;
+
+            compositor::EventSubscriber_t<LibInput::Events::KeyboardKey> m_keyboardKeyEvent;
     };
 }  // namespace moco::backend
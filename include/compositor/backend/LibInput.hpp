@@ -1,14 +1,118 @@
 #pragma once
 
 #include "BackendBase.hpp"
+#include "Events.hpp"
+#include "InputTrace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <thread>
+#include <unordered_map>
 
 #include <libinput.h>
 
 namespace moco::backend {
+    /**
+     * @brief libinput input backend
+     * @details Reads libinput on a dedicated input thread, woken up by
+     * the libinput fd, so input latency doesn't depend on how busy the
+     * display thread is. Every event is stamped with its kernel timestamp
+     * and posted to the display thread through `compositor::Events::Post`.
+     *
+     * If `MOCO_INPUT_RECORD` names a file, every posted event is also
+     * recorded to it as an `InputTrace`, which `Replay` can play back.
+     *
+     */
     class LibInput : public BackendBase<LibInput> {
         public:
+            // Values are stored in input traces, only ever append
             enum class Events {
-                KeyboardKey
+                KeyboardKey,
+                PointerMotion,
+                TouchMotion,
+                TouchDown,
+                TouchUp,
+                TouchCancel,
+                TouchFrame,
+                PointerMotionAbsolute,
+                PointerButton,
+                PointerScroll
+            };
+
+            struct KeyboardKey_EventData {
+                uint64_t TimeUsec{0};
+                uint32_t Key{0};
+                libinput_key_state KeyState{LIBINPUT_KEY_STATE_RELEASED};
+            };
+
+            struct PointerMotion_EventData {
+                uint64_t TimeUsec{0};
+                double Dx{0};
+                double Dy{0};
+                double DxUnaccelerated{0};
+                double DyUnaccelerated{0};
+            };
+
+            struct PointerMotionAbsolute_EventData {
+                uint64_t TimeUsec{0};
+                // Normalized to [0, 1] over the pointer device
+                double X{0};
+                double Y{0};
+            };
+
+            struct PointerButton_EventData {
+                uint64_t TimeUsec{0};
+                uint32_t Button{0};
+                libinput_button_state ButtonState{LIBINPUT_BUTTON_STATE_RELEASED};
+            };
+
+            /**
+             * @brief Scroll on one or both axes.
+             * @details An axis with `Has*` set and a value of 0 marks the
+             * end of a finger or continuous scroll sequence on that axis.
+             * `*V120` values are only set for wheels, in 1/120ths of a
+             * wheel detent.
+             *
+             */
+            struct PointerScroll_EventData {
+                uint64_t TimeUsec{0};
+                libinput_pointer_axis_source Source{LIBINPUT_POINTER_AXIS_SOURCE_WHEEL};
+                bool HasVertical{false};
+                bool HasHorizontal{false};
+                double Vertical{0};
+                double Horizontal{0};
+                double VerticalV120{0};
+                double HorizontalV120{0};
+            };
+
+            struct TouchDown_EventData {
+                uint64_t TimeUsec{0};
+                int32_t Slot{0};
+                // Normalized to [0, 1] over the touch device
+                double X{0};
+                double Y{0};
+            };
+
+            struct TouchMotion_EventData {
+                uint64_t TimeUsec{0};
+                int32_t Slot{0};
+                // Normalized to [0, 1] over the touch device
+                double X{0};
+                double Y{0};
+            };
+
+            struct TouchUp_EventData {
+                uint64_t TimeUsec{0};
+                int32_t Slot{0};
+            };
+
+            struct TouchCancel_EventData {
+                uint64_t TimeUsec{0};
+            };
+
+            struct TouchFrame_EventData {
+                uint64_t TimeUsec{0};
             };
 
             LibInput(Private, ::wayland::server::display_t display);
@@ -19,10 +123,153 @@ namespace moco::backend {
             static auto OpenRestricted(const char *path, int flags, void *userData) -> int;
             static auto CloseRestricted(int fd, void *userData) -> void;
 
+            auto InputThread(std::stop_token stopToken) -> void;
             auto BackendLoop() -> void final;
-            auto HandleKeyboardEvent(libinput_event_keyboard *event) -> void;
+            // Handles every pending libinput event, `stopToken` is the input thread's
+            auto BackendLoop(const std::stop_token &stopToken) -> void;
+            auto HandleDeviceAdded(libinput_device *device) -> void;
+            auto HandleDeviceRemoved(libinput_device *device) -> void;
+            auto HandleKeyboardEvent(libinput_event_keyboard *event, const std::stop_token &stopToken) -> void;
+            auto HandlePointerMotionEvent(libinput_event_pointer *event, const std::stop_token &stopToken) -> void;
+            auto HandlePointerMotionAbsoluteEvent(libinput_event_pointer *event, const std::stop_token &stopToken) -> void;
+            auto HandlePointerButtonEvent(libinput_event_pointer *event, const std::stop_token &stopToken) -> void;
+            auto HandlePointerScrollEvent(libinput_event_type type, libinput_event_pointer *event, const std::stop_token &stopToken) -> void;
+            auto HandleTouchEvent(libinput_event_type type, libinput_event_touch *event, const std::stop_token &stopToken) -> void;
+
+            /**
+             * @brief Posts an event to the display thread.
+             * @details With the ring full, events superseded by the next
+             * one of their kind are dropped, every other event waits
+             * until the display thread made room, or `stopToken` asks
+             * the input thread to stop.
+             *
+             */
+            template <Events Event>
+            auto PostEvent(libinput_event *event, compositor::EventPayload_t<Event> eventData, const std::stop_token &stopToken) -> void;
+
+            // Whether losing the event only loses precision, not state
+            static constexpr auto IsDroppable(Events event) -> bool {
+                return event == Events::PointerMotion ||
+                       event == Events::PointerMotionAbsolute ||
+                       event == Events::TouchMotion;
+            }
+
+            static constexpr std::chrono::microseconds s_minPostBackoff{50};
+            static constexpr std::chrono::microseconds s_maxPostBackoff{2'000};
 
             libinput *m_libinputHandle;
             udev *m_udevHandle;
+
+            // Only touched by the input thread
+            std::optional<InputTrace::Writer> m_traceWriter;
+            std::unordered_map<libinput_device*, uint16_t> m_traceDevices;
+            uint16_t m_nextTraceDevice{0};
+
+            int m_epollFd;
+            // Written to on destruction to wake the input thread up
+            int m_stopFd;
+            std::atomic<uint64_t> m_droppedEvents{0};
+
+            // Declared last, so it's joined before anything it uses is destroyed
+            std::jthread m_inputThread;
     };
 }  // namespace moco::backend
+
+namespace moco::compositor {
+    template <>
+    struct EventPayload<::moco::backend::LibInput::Events::KeyboardKey> {
+        using Type = ::moco::backend::LibInput::KeyboardKey_EventData;
+    };
+
+    // Relative motion between two dispatches is summed up
+    template <>
+    struct EventPayload<::moco::backend::LibInput::Events::PointerMotion> {
+        using Type = ::moco::backend::LibInput::PointerMotion_EventData;
+
+        static inline auto Coalesce(Type &queued, const Type &incoming) -> bool {
+            queued.TimeUsec = incoming.TimeUsec;
+            queued.Dx += incoming.Dx;
+            queued.Dy += incoming.Dy;
+            queued.DxUnaccelerated += incoming.DxUnaccelerated;
+            queued.DyUnaccelerated += incoming.DyUnaccelerated;
+            return true;
+        }
+    };
+
+    // Only the latest absolute position is of interest
+    template <>
+    struct EventPayload<::moco::backend::LibInput::Events::PointerMotionAbsolute> {
+        using Type = ::moco::backend::LibInput::PointerMotionAbsolute_EventData;
+
+        static inline auto Coalesce(Type &queued, const Type &incoming) -> bool {
+            queued = incoming;
+            return true;
+        }
+    };
+
+    template <>
+    struct EventPayload<::moco::backend::LibInput::Events::PointerButton> {
+        using Type = ::moco::backend::LibInput::PointerButton_EventData;
+    };
+
+    // Scroll of the same source is summed up, axis stops are kept apart
+    template <>
+    struct EventPayload<::moco::backend::LibInput::Events::PointerScroll> {
+        using Type = ::moco::backend::LibInput::PointerScroll_EventData;
+
+        static inline auto IsStop(const Type &eventData) -> bool {
+            return (eventData.HasVertical && eventData.Vertical == 0) ||
+                   (eventData.HasHorizontal && eventData.Horizontal == 0);
+        }
+
+        static inline auto Coalesce(Type &queued, const Type &incoming) -> bool {
+            if (queued.Source != incoming.Source || IsStop(queued) || IsStop(incoming)) {
+                return false;
+            }
+
+            queued.TimeUsec = incoming.TimeUsec;
+            queued.HasVertical |= incoming.HasVertical;
+            queued.HasHorizontal |= incoming.HasHorizontal;
+            queued.Vertical += incoming.Vertical;
+            queued.Horizontal += incoming.Horizontal;
+            queued.VerticalV120 += incoming.VerticalV120;
+            queued.HorizontalV120 += incoming.HorizontalV120;
+            return true;
+        }
+    };
+
+    template <>
+    struct EventPayload<::moco::backend::LibInput::Events::TouchDown> {
+        using Type = ::moco::backend::LibInput::TouchDown_EventData;
+    };
+
+    // Only the latest absolute position of a slot is of interest
+    template <>
+    struct EventPayload<::moco::backend::LibInput::Events::TouchMotion> {
+        using Type = ::moco::backend::LibInput::TouchMotion_EventData;
+
+        static inline auto Coalesce(Type &queued, const Type &incoming) -> bool {
+            if (queued.Slot != incoming.Slot) {
+                return false;
+            }
+
+            queued = incoming;
+            return true;
+        }
+    };
+
+    template <>
+    struct EventPayload<::moco::backend::LibInput::Events::TouchUp> {
+        using Type = ::moco::backend::LibInput::TouchUp_EventData;
+    };
+
+    template <>
+    struct EventPayload<::moco::backend::LibInput::Events::TouchCancel> {
+        using Type = ::moco::backend::LibInput::TouchCancel_EventData;
+    };
+
+    template <>
+    struct EventPayload<::moco::backend::LibInput::Events::TouchFrame> {
+        using Type = ::moco::backend::LibInput::TouchFrame_EventData;
+    };
+}  // namespace moco::compositor
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "BackendBase.hpp"
+#include "LibInput.hpp"
+#include "wayland/Pointer.hpp"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace moco::backend {
+    /**
+     * @brief Pointer position and pending pointer changes
+     * @details The position is kept in fixed-point with `s_fractionBits`
+     * fractional bits, the same resolution `wl_fixed_t` has, so summing
+     * up thousands of sub-pixel motion events doesn't drift, and the
+     * rounding error of every event is carried over to the next one.
+     * The position is clamped to the output layout, if one is set.
+     *
+     * Changes accumulate until `TakeFrame`, which groups them into a
+     * single `Frame`. Independent of libinput, so it can be fed
+     * synthetic pointer sequences.
+     *
+     */
+    class PointerState {
+        public:
+            static constexpr int s_fractionBits = 8;
+            static constexpr int64_t s_fixedOne = int64_t{1} << s_fractionBits;
+
+            struct OutputRect {
+                int32_t X{0};
+                int32_t Y{0};
+                int32_t Width{0};
+                int32_t Height{0};
+            };
+
+            /**
+             * @brief Accumulated scroll of one axis.
+             * @details `Value120` is summed up as an integer, so no
+             * wheel detent fraction is lost however many events a
+             * frame merges.
+             *
+             */
+            struct Axis {
+                bool Active{false};
+                // Finger or continuous scrolling stopped on this axis
+                bool Stop{false};
+                double Value{0};
+                int32_t Value120{0};
+            };
+
+            /**
+             * @brief All pointer changes of one frame.
+             * @details Axes are indexed by `libinput_pointer_axis`.
+             *
+             */
+            struct Frame {
+                uint64_t TimeUsec{0};
+
+                bool HasMotion{false};
+                // Layout coordinates
+                double X{0};
+                double Y{0};
+                double DxUnaccelerated{0};
+                double DyUnaccelerated{0};
+
+                bool HasButton{false};
+                uint32_t Button{0};
+                libinput_button_state ButtonState{LIBINPUT_BUTTON_STATE_RELEASED};
+
+                bool HasScroll{false};
+                libinput_pointer_axis_source ScrollSource{LIBINPUT_POINTER_AXIS_SOURCE_WHEEL};
+                std::array<Axis, 2> Axes{};
+            };
+
+            auto SetOutputLayout(std::vector<OutputRect> layout) -> void;
+
+            auto Motion(uint64_t timeUsec, double dx, double dy, double dxUnaccelerated, double dyUnaccelerated) -> void;
+            auto MotionAbsolute(uint64_t timeUsec, double x, double y) -> void;
+            auto Button(uint64_t timeUsec, uint32_t button, libinput_button_state state) -> void;
+            auto Scroll(const LibInput::PointerScroll_EventData &eventData) -> void;
+
+            /**
+             * @brief Returns whether a scroll event can be merged into
+             * the pending scroll.
+             * @details Frames carry a single scroll source, nothing may
+             * follow an axis stop on the same axis within a frame, and a
+             * stop may not follow scroll on the same axis either.
+             *
+             */
+            auto CanTakeScroll(const LibInput::PointerScroll_EventData &eventData) const -> bool;
+
+            auto HasChanges() const -> bool;
+            auto TakeFrame() -> Frame;
+
+            auto GetX() const -> double;
+            auto GetY() const -> double;
+
+        private:
+            auto ClampToLayout() -> void;
+            static auto ToFixed(double value, double &remainder) -> int64_t;
+            static auto FromFixed(int64_t value) -> double;
+
+            std::vector<OutputRect> m_layout;
+
+            int64_t m_x{0};
+            int64_t m_y{0};
+            // Rounding error of the last motion, in fixed-point units
+            double m_remainderX{0};
+            double m_remainderY{0};
+
+            Frame m_pending;
+    };
+
+    /**
+     * @brief Pointer input backend
+     * @details Feeds libinput pointer events into a `PointerState` and
+     * publishes at most one `Events::Frame` per frame interval, however
+     * high the device's polling rate is. The first change after an idle
+     * period is published right away, later ones wait for the interval
+     * to pass. Buttons are never delayed, they publish the pending frame
+     * immediately.
+     *
+     * `Flush` publishes pending changes right away, for when output
+     * frames drive the pointer.
+     *
+     * Every frame is published twice: first as `Events::Frame` in layout
+     * coordinates for the compositor, then as `wl_pointer` input for the
+     * seat, in coordinates local to the pointer focus and with a serial
+     * for buttons.
+     *
+     */
+    class Pointer : public BackendBase<Pointer> {
+        public:
+            enum class Events {
+                Frame
+            };
+
+            using Frame_EventData = PointerState::Frame;
+
+            // Layout position of the pointer focus, where surface local coordinates start
+            using SurfaceOrigin_t = std::function<std::pair<int32_t, int32_t>()>;
+
+            Pointer(Private, ::wayland::server::display_t display);
+            ~Pointer();
+
+            auto SetOutputLayout(std::vector<PointerState::OutputRect> layout) -> void;
+
+            /**
+             * @brief Sets the minimum time between two published frames.
+             *
+             * @param `frameIntervalUsec`: Usually the output's refresh interval.
+             *
+             */
+            auto SetFrameInterval(uint64_t frameIntervalUsec) -> void;
+
+            /**
+             * @brief Sets how to find the pointer focus' position.
+             * @details Asked once per frame, after the compositor handled
+             * `Events::Frame` and possibly moved the focus. Without one,
+             * surfaces are at the layout's origin.
+             *
+             */
+            auto SetSurfaceOrigin(SurfaceOrigin_t surfaceOrigin) -> void;
+
+            auto Flush() -> void;
+
+            /**
+             * @brief Converts a frame into `wl_pointer` input.
+             *
+             * @param `frame`: The frame, in layout coordinates.
+             * @param `originX`, `originY`: Layout position of the pointer focus.
+             *
+             * @return `wayland::implementation::Pointer::Frame_EventData`: The
+             * frame in surface local coordinates, without a serial.
+             *
+             */
+            static auto ToClientFrame(const Frame_EventData &frame, int32_t originX, int32_t originY) -> wayland::implementation::Pointer::Frame_EventData;
+
+        private:
+            auto BackendLoop() -> void final;
+
+            auto EventMotion(const LibInput::PointerMotion_EventData &eventData) -> void;
+            auto EventMotionAbsolute(const LibInput::PointerMotionAbsolute_EventData &eventData) -> void;
+            auto EventButton(const LibInput::PointerButton_EventData &eventData) -> void;
+            auto EventScroll(const LibInput::PointerScroll_EventData &eventData) -> void;
+
+            // Publishes now if the interval has passed, arms the timer otherwise
+            auto ScheduleFlush() -> void;
+            auto ArmTimer(uint64_t deadlineUsec) -> void;
+
+            // Publishes the frame as `wl_pointer` input
+            auto PublishClientFrame(const Frame_EventData &frame) -> void;
+            static auto GetAxisSource(libinput_pointer_axis_source source) -> ::wayland::server::pointer_axis_source;
+
+            ::wayland::server::display_t m_display;
+            SurfaceOrigin_t m_surfaceOrigin;
+
+            PointerState m_pointerState;
+
+            uint64_t m_frameIntervalUsec{16'667};
+            uint64_t m_lastFlushUsec{0};
+            bool m_timerArmed{false};
+
+            int m_timerFd;
+            std::optional<::wayland::server::event_source_t> m_timerSource;
+
+            compositor::EventSubscriber_t<LibInput::Events::PointerMotion> m_motionEvent;
+            compositor::EventSubscriber_t<LibInput::Events::PointerMotionAbsolute> m_motionAbsoluteEvent;
+            compositor::EventSubscriber_t<LibInput::Events::PointerButton> m_buttonEvent;
+            compositor::EventSubscriber_t<LibInput::Events::PointerScroll> m_scrollEvent;
+    };
+}  // namespace moco::backend
+
+namespace moco::compositor {
+    template <>
+    struct EventPayload<::moco::backend::Pointer::Events::Frame> {
+        using Type = ::moco::backend::Pointer::Frame_EventData;
+    };
+}  // namespace moco::compositor
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "BackendBase.hpp"
+#include "InputTrace.hpp"
+#include "LibInput.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace moco::backend {
+    /**
+     * @brief Input trace replay backend
+     * @details Plays back an `InputTrace` recorded by `LibInput`, posting
+     * every event through `compositor::Events::Post` just like the live
+     * backend does. Needs neither udev nor access to `/dev/input`.
+     *
+     * Events are posted at their recorded pace divided by `speed`, a
+     * speed of 0 or less posts them as fast as the display thread drains
+     * them.
+     *
+     * Timestamps are rebased onto the monotonic clock the same way, so
+     * consumers comparing them with the current time, like the gesture
+     * hold timeout, see a consistent clock. Without a speed they keep
+     * their recorded spacing.
+     *
+     */
+    class Replay : public BackendBase<Replay> {
+        public:
+            Replay(Private, ::wayland::server::display_t display, std::filesystem::path tracePath, double speed = 1.0);
+            ~Replay();
+
+            auto IsFinished() const -> bool;
+
+        private:
+            auto BackendLoop() -> void final;
+            auto ArmTimer(uint64_t deadlineUsec) -> void;
+            auto ReplayRecord(const InputTrace::Record &record, uint64_t timeUsec) -> bool;
+
+            // Maps a trace timestamp onto the monotonic clock
+            auto GetReplayTimeUsec(uint64_t traceTimeUsec) const -> uint64_t;
+
+            template <LibInput::Events Event>
+            auto ReplayEvent(std::span<const std::byte> payload, uint64_t timeUsec) -> bool;
+
+            InputTrace::Reader m_reader;
+            std::optional<InputTrace::Record> m_nextRecord;
+            double m_speed;
+
+            uint64_t m_traceStartUsec{0};
+            uint64_t m_replayStartUsec{0};
+
+            int m_timerFd;
+            // Use optional to get around default construction of event_source_t
+            std::optional<::wayland::server::event_source_t> m_timerSource;
+    };
+}  // namespace moco::backend
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "BackendBase.hpp"
+#include "LibInput.hpp"
+#include "wayland/Touch.hpp"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace moco::backend {
+    /**
+     * @brief Multi-touch slot state
+     * @details Tracks every touch slot of a seat in a structure-of-arrays
+     * layout, so a frame touching all slots walks a handful of contiguous
+     * arrays and bitmasks. Changes accumulate until `TakeFrame`, which
+     * groups them into a single `Frame`. Independent of libinput, so it
+     * can be fed synthetic touch sequences.
+     *
+     */
+    class TouchState {
+        public:
+            static constexpr size_t s_maxSlots = 10;
+
+            /**
+             * @brief All touch changes of one frame.
+             * @details Bit `n` of a mask refers to slot `n`. Positions are
+             * normalized to [0, 1] over the touch device.
+             *
+             */
+            struct Frame {
+                uint64_t TimeUsec{0};
+                // Slots touching once the frame is applied
+                uint32_t ActiveMask{0};
+                uint32_t DownMask{0};
+                uint32_t MotionMask{0};
+                uint32_t UpMask{0};
+                std::array<double, s_maxSlots> X{};
+                std::array<double, s_maxSlots> Y{};
+            };
+
+            auto Down(int32_t slot, uint64_t timeUsec, double x, double y) -> void;
+            auto Motion(int32_t slot, uint64_t timeUsec, double x, double y) -> void;
+            auto Up(int32_t slot, uint64_t timeUsec) -> void;
+            auto Cancel() -> void;
+
+            auto HasChanges() const -> bool;
+
+            /**
+             * @brief Groups every change since the last frame.
+             *
+             * @param `timeUsec`: Timestamp of the frame.
+             * @param `deadlineUsec`: [Optional] Time the frame will be shown at.
+             * Positions of moving slots are resampled to it, interpolated if
+             * it lies between the last two samples, linearly predicted (at most
+             * `SetMaxPrediction` ahead) if it lies past them.
+             *
+             * @return `Frame`: The grouped changes.
+             *
+             */
+            auto TakeFrame(uint64_t timeUsec, std::optional<uint64_t> deadlineUsec = std::nullopt) -> Frame;
+
+            auto SetMaxPrediction(uint64_t maxPredictionUsec) -> void;
+
+        private:
+            static auto IsValidSlot(int32_t slot) -> bool;
+            auto Resample(size_t slot, uint64_t deadlineUsec, double &x, double &y) const -> void;
+
+            std::array<double, s_maxSlots> m_x{};
+            std::array<double, s_maxSlots> m_y{};
+            std::array<uint64_t, s_maxSlots> m_timeUsec{};
+
+            // Previous sample of every slot, for resampling
+            std::array<double, s_maxSlots> m_previousX{};
+            std::array<double, s_maxSlots> m_previousY{};
+            std::array<uint64_t, s_maxSlots> m_previousTimeUsec{};
+
+            uint32_t m_activeMask{0};
+            uint32_t m_downMask{0};
+            uint32_t m_motionMask{0};
+            uint32_t m_upMask{0};
+
+            uint64_t m_maxPredictionUsec{8'000};
+    };
+
+    /**
+     * @brief Client side of the touch slots
+     * @details Turns `TouchState::Frame`s into the `wl_touch` frames
+     * clients get. Positions are mapped onto the touch output and made
+     * local to the surface each point went down on. While the compositor
+     * claims the touch sequence clients get nothing. Independent of
+     * libinput and the display, so it can be fed synthetic touch frames.
+     *
+     */
+    class TouchClientState {
+        public:
+            // Layout area the touch device spans
+            struct OutputRect {
+                int32_t X{0};
+                int32_t Y{0};
+                int32_t Width{0};
+                int32_t Height{0};
+            };
+
+            // Layout position of the touch focus, where surface local coordinates start
+            using SurfaceOrigin_t = std::function<std::pair<int32_t, int32_t>()>;
+            using ClientFrame_t = wayland::implementation::Touch::Frame_EventData;
+
+            auto SetOutput(const OutputRect &output) -> void;
+            auto SetSurfaceOrigin(SurfaceOrigin_t surfaceOrigin) -> void;
+
+            /**
+             * @brief Converts a frame for clients.
+             *
+             * @return `std::optional<ClientFrame_t>`: The frame's points, in
+             * slot order, without a serial. `std::nullopt` if clients get
+             * nothing of the frame.
+             *
+             */
+            auto TakeFrame(const TouchState::Frame &frame) -> std::optional<ClientFrame_t>;
+
+            /**
+             * @brief Takes the touch sequence away from clients until
+             * every finger is lifted.
+             *
+             * @return `bool`: Whether clients hold touch points and have
+             * to get `wl_touch.cancel`.
+             *
+             */
+            auto Claim() -> bool;
+
+            // The touch sequence got cancelled, returns like `Claim`
+            auto Cancel() -> bool;
+
+            auto IsClaimed() const -> bool;
+
+        private:
+            OutputRect m_output;
+            SurfaceOrigin_t m_surfaceOrigin;
+            // Origin of the surface every slot went down on
+            std::array<std::pair<int32_t, int32_t>, TouchState::s_maxSlots> m_slotOrigins{};
+            // Slots clients got a down for and no up yet
+            uint32_t m_clientMask{0};
+            bool m_claimed{false};
+    };
+
+    /**
+     * @brief Touch input backend
+     * @details Feeds libinput touch events into a `TouchState` and
+     * publishes one `Events::Frame` per libinput touch frame. With
+     * resampling enabled, frames are instead published on `Flush`,
+     * once per output frame, with positions resampled to the output's
+     * frame deadline.
+     *
+     * Every frame is published twice: first as `Events::Frame` for the
+     * compositor, then as `wl_touch` input for the seat. Positions are
+     * mapped onto the touch output and made local to the surface the
+     * touch focus was on when each point went down. Once the compositor
+     * `Claim`s the touch sequence, clients get no more of it.
+     *
+     */
+    class Touch : public BackendBase<Touch> {
+        public:
+            enum class Events {
+                Frame,
+                Cancel
+            };
+
+            using Frame_EventData = TouchState::Frame;
+
+            struct Cancel_EventData {
+                uint64_t TimeUsec{0};
+            };
+
+            using OutputRect = TouchClientState::OutputRect;
+            using SurfaceOrigin_t = TouchClientState::SurfaceOrigin_t;
+
+            Touch(Private, ::wayland::server::display_t display);
+
+            auto SetResampling(bool resampling) -> void;
+
+            auto SetOutput(const OutputRect &output) -> void;
+
+            /**
+             * @brief Sets how to find the touch focus' position.
+             * @details Asked once per point going down, after the
+             * compositor handled `Events::Frame`. Without one, surfaces
+             * are at the layout's origin.
+             *
+             */
+            auto SetSurfaceOrigin(SurfaceOrigin_t surfaceOrigin) -> void;
+
+            /**
+             * @brief Takes the touch sequence away from clients.
+             * @details For system gestures. Clients holding touch points
+             * get `wl_touch.cancel`, and no touch input reaches them until
+             * every finger is lifted. Called from an `Events::Frame`
+             * handler, it already applies to that frame.
+             *
+             */
+            auto Claim() -> void;
+
+            /**
+             * @brief Publishes pending touch changes resampled to a deadline.
+             * @details Meant to be called once per output frame while
+             * resampling is enabled.
+             *
+             * @param `deadlineUsec`: `CLOCK_MONOTONIC` time the next frame is shown at.
+             *
+             */
+            auto Flush(uint64_t deadlineUsec) -> void;
+
+        private:
+            auto BackendLoop() -> void final;
+
+            auto EventTouchFrame(const LibInput::TouchFrame_EventData &eventData) -> void;
+            auto EventTouchCancel(const LibInput::TouchCancel_EventData &eventData) -> void;
+
+            auto PublishFrame(const Frame_EventData &frame) -> void;
+            // Publishes the frame as `wl_touch` input
+            auto PublishClientFrame(const Frame_EventData &frame) -> void;
+
+            ::wayland::server::display_t m_display;
+            TouchClientState m_clientState;
+
+            TouchState m_touchState;
+            bool m_resampling{false};
+            uint64_t m_lastFrameTimeUsec{0};
+
+            compositor::EventSubscriber_t<LibInput::Events::TouchDown> m_touchDownEvent;
+            compositor::EventSubscriber_t<LibInput::Events::TouchMotion> m_touchMotionEvent;
+            compositor::EventSubscriber_t<LibInput::Events::TouchUp> m_touchUpEvent;
+            compositor::EventSubscriber_t<LibInput::Events::TouchCancel> m_touchCancelEvent;
+            compositor::EventSubscriber_t<LibInput::Events::TouchFrame> m_touchFrameEvent;
+    };
+}  // namespace moco::backend
+
+namespace moco::compositor {
+    template <>
+    struct EventPayload<::moco::backend::Touch::Events::Frame> {
+        using Type = ::moco::backend::Touch::Frame_EventData;
+    };
+
+    template <>
+    struct EventPayload<::moco::backend::Touch::Events::Cancel> {
+        using Type = ::moco::backend::Touch::Cancel_EventData;
+    };
+}  // namespace moco::compositor
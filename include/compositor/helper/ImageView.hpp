@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <ranges>
+#include <span>
+#include <type_traits>
+
+namespace moco::helper {
+    /**
+     * @brief Non-owning 2D view over rows of pixels.
+     * @details Like a `std::mdspan` with a strided layout: the view is
+     * `width` by `height` elements, and consecutive rows start `stride`
+     * elements apart, `stride >= width`. Every row is contiguous, so
+     * loops should go row by row and hand each row to a kernel as a
+     * span, rather than index pixel by pixel.
+     * @tparam `T`: Element type, usually the pixel's storage type. Use
+     * a const type for read-only views.
+     *
+     */
+    template<typename T>
+    class ImageView {
+        public:
+            constexpr ImageView() = default;
+
+            /**
+             * @param `data`: First element of the first row.
+             * @param `width`: Elements per row.
+             * @param `height`: Number of rows.
+             * @param `stride`: Elements from the start of one row to the
+             * start of the next.
+             *
+             */
+            constexpr ImageView(T *data, size_t width, size_t height, size_t stride) :
+                m_data(data),
+                m_width(width),
+                m_height(height),
+                m_stride(stride)
+            {
+                assert(stride >= width);
+            }
+
+            // Allow passing a mutable view where a read-only one is expected
+            constexpr operator ImageView<const T>() const requires (!std::is_const_v<T>) {
+                return {m_data, m_width, m_height, m_stride};
+            }
+
+            constexpr auto GetData() const -> T* {
+                return m_data;
+            }
+
+            constexpr auto GetWidth() const -> size_t {
+                return m_width;
+            }
+
+            constexpr auto GetHeight() const -> size_t {
+                return m_height;
+            }
+
+            constexpr auto GetStride() const -> size_t {
+                return m_stride;
+            }
+
+            constexpr auto IsEmpty() const -> bool {
+                return m_width == 0 || m_height == 0;
+            }
+
+            constexpr auto operator()(size_t x, size_t y) const -> T& {
+                assert(x < m_width && y < m_height);
+                return m_data[y * m_stride + x];
+            }
+
+            constexpr auto Row(size_t y) const -> std::span<T> {
+                assert(y < m_height);
+                return {m_data + y * m_stride, m_width};
+            }
+
+            /**
+             * @brief Returns every row, top to bottom, as spans.
+             * @details `for (std::span<T> row : view.Rows())`
+             *
+             */
+            constexpr auto Rows() const {
+                return std::views::iota(size_t{0}, m_height)
+                     | std::views::transform([*this](size_t y) -> std::span<T> {return Row(y);});
+            }
+
+            /**
+             * @brief Returns the view of a rectangle within this one.
+             * @details The rectangle is clipped to the view, so a damage
+             * rectangle reaching outside of it can be passed as is. The
+             * result keeps this view's stride.
+             *
+             */
+            constexpr auto Slice(size_t x, size_t y, size_t width, size_t height) const -> ImageView {
+                x = std::min(x, m_width);
+                y = std::min(y, m_height);
+                width = std::min(width, m_width - x);
+                height = std::min(height, m_height - y);
+
+                if (width == 0 || height == 0) {
+                    return {};
+                }
+
+                return {m_data + y * m_stride + x, width, height, m_stride};
+            }
+
+        private:
+            T *m_data{nullptr};
+            size_t m_width{0};
+            size_t m_height{0};
+            size_t m_stride{0};
+    };
+}  // namespace moco::helper
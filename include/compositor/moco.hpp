@@ -3,6 +3,8 @@
 #include <wayland-server.hpp>
 #include <wayland-server-protocol.hpp>
 
+#include <optional>
+
 namespace moco::compositor {
     class Compositor {
         public:
@@ -12,6 +14,9 @@ namespace moco::compositor {
         private:
             wayland::server::display_t m_display;
 
+            // Use optional to get around default construction of event_source_t
+            std::optional<wayland::server::event_source_t> m_postedEventsSource;
+
             // Wayland globals
 
             std::string m_socket;
@@ -3,31 +3,182 @@
 #include "ObjectImplementationBase.hpp"
 
 #include "PixelFormat.hpp"
+#include "ImageView.hpp"
 
 #include <wayland-server-protocol.hpp>
+#include <chrono>
+#include <optional>
 #include <span>
 #include <format>
 
 namespace moco::wayland::implementation {
     class SharedMemoryPool;
     class Buffer : public ObjectImplementationBase<::wayland::server::buffer_t, Buffer> {
+            using ObjectImplementationBase::on_destroy;
+
         public:
+            /**
+             * @brief Where the buffer is in its attach/release cycle
+             * @details `Attached` on `wl_surface.attach`, `Committed` once
+             * the attach is committed, from then on the client may not
+             * touch it. `Copied` when its content is in the compositor's
+             * upload cache, `InUse` while a renderer reads it directly.
+             * `Released` once `wl_buffer.release` was sent, the client
+             * owns it again.
+             *
+             */
+            enum class State : uint8_t {
+                Created,
+                Attached,
+                Committed,
+                Copied,
+                InUse,
+                Released
+            };
+
+            /**
+             * @brief Color of a single-pixel buffer
+             * @details Premultiplied, every channel spans the whole
+             * `uint32_t` range.
+             *
+             */
+            struct SolidColor {
+                uint32_t Red;
+                uint32_t Green;
+                uint32_t Blue;
+                uint32_t Alpha;
+
+                auto operator==(const SolidColor&) const -> bool = default;
+            };
+
+            /**
+             * @brief How long clients' buffers are held by the compositor
+             * @details Measured from commit to release, over all buffers.
+             * A client can only double-buffer if its buffers come back
+             * within a frame.
+             *
+             */
+            struct HoldStatistics {
+                uint64_t Releases{0};
+                std::chrono::nanoseconds TotalHoldTime{0};
+                std::chrono::nanoseconds MaxHoldTime{0};
+                // Committed and not released yet
+                uint64_t Held{0};
+            };
+
             inline Buffer(::wayland::server::buffer_t buffer, auto format, Private) :
-                Buffer(buffer, PixelFormats::GetFormat(format)) {}
+                Buffer(buffer, PixelFormats::GetFormat(format))
+            {
+                if constexpr (std::is_same_v<decltype(format), ::wayland::server::shm_format>) {
+                    m_shmFormat = format;
+                } else if (m_format == PixelFormats::Format::XRGB8888) {
+                    m_shmFormat = ::wayland::server::shm_format::xrgb8888;
+                }
+            }
+
+            template <auto Format>
+            inline auto GetData() const -> std::span<PixelFormats::PixelFormatSize<Format>> {
+                using Pixel_t = PixelFormats::PixelFormatSize<Format>;
+
+                std::span<uint8_t> bufferData = GetBytes();
+                if (bufferData.size_bytes() % sizeof(Pixel_t) != 0) {
+                    throw std::runtime_error(std::format("Template type size {} must be able to be aligned with the size ({}) of the data.", sizeof(Pixel_t), bufferData.size_bytes()));
+                }
+
+                return {reinterpret_cast<Pixel_t*>(bufferData.data()), bufferData.size_bytes() / sizeof(Pixel_t)};
+            }
 
+            /**
+             * @brief Returns the buffer's pixels as a 2D view
+             * @details Unlike `GetData`, rows are `GetWidth` pixels long
+             * and padding between them is skipped. Same lifetime rules as
+             * `GetBytes`.
+             * @tparam `Format`: Format to interpret the pixels as.
+             *
+             */
             template <auto Format>
-            inline auto GetData() -> std::span<PixelFormats::PixelFormat<Format>> const {
-                if (m_bufferData.size_bytes() % sizeof(Format) != 0) {
-                    throw std::runtime_error(std::format("Template type size {} must be able to be aligned with the size ({}) of the data.", sizeof(PixelFormats::PixelFormatSize<Format>::Size), m_bufferData.size_bytes()));
+            inline auto GetImage() const -> helper::ImageView<PixelFormats::PixelFormatSize<Format>> {
+                using Pixel_t = PixelFormats::PixelFormatSize<Format>;
+
+                std::span<uint8_t> bufferData = GetBytes();
+                if (m_bufferStride % sizeof(Pixel_t) != 0 || reinterpret_cast<uintptr_t>(bufferData.data()) % alignof(Pixel_t) != 0) {
+                    throw std::runtime_error(std::format("Buffer rows (stride {}) aren't aligned to the pixel size {}.", m_bufferStride, sizeof(Pixel_t)));
+                }
+
+                if (bufferData.size_bytes() < m_bufferHeight * m_bufferStride) {
+                    return {};
                 }
 
-                return {reinterpret_cast<PixelFormats::PixelFormatSize<Format>*>(m_bufferData.data()), m_bufferData.size_bytes() / sizeof(Format)}; 
+                return {reinterpret_cast<Pixel_t*>(bufferData.data()), m_bufferWidth, m_bufferHeight, m_bufferStride / sizeof(Pixel_t)};
+            }
+
+            /**
+             * @brief Returns the buffer's bytes in its pool
+             * @details Resolved through the pool on every call, as the
+             * pool's mapping may move when it grows. Don't hold on to the
+             * returned span across a pool resize.
+             *
+             */
+            auto GetBytes() const -> std::span<uint8_t>;
+
+            /**
+             * @brief Brackets reads of the buffer's bytes
+             * @details See `SharedMemoryPool::BeginAccess`. If the client
+             * shrank the pool's file during the access, `EndAccess` posts
+             * `wl_shm.error.invalid_fd` on the buffer and returns false,
+             * the bytes read were zeroes.
+             *
+             */
+            auto BeginAccess() -> void;
+            auto EndAccess() -> bool;
+
+            inline auto GetState() const -> State {
+                return m_state;
             }
 
+            auto Attach() -> void;
+            auto Commit() -> void;
+
+            // Content was copied, the buffer isn't needed any more
+            auto MarkCopied() -> void;
+
+            /**
+             * @brief Brackets direct reads of the buffer by a renderer
+             * @details A release requested meanwhile is sent by the last
+             * `EndRender`.
+             *
+             */
+            auto BeginRender() -> void;
+            auto EndRender() -> void;
+
+            /**
+             * @brief Sends `wl_buffer.release`
+             * @details Only once per commit, and never while a renderer
+             * uses the buffer.
+             *
+             */
+            auto Release() -> void;
+
+            /**
+             * @brief Counts the surface states referencing the buffer
+             * @details Dropping the last reference releases the buffer,
+             * whether its content was copied or not.
+             *
+             */
+            auto AddStateReference() -> void;
+            auto RemoveStateReference() -> void;
+
+            static auto GetHoldStatistics() -> const HoldStatistics&;
+
             inline auto GetFormat() const -> PixelFormats::Format {
                 return m_format;
             }
 
+            // Format the client wrote the buffer in, see `PixelFormats::FormatRegistry`
+            inline auto GetShmFormat() const -> ::wayland::server::shm_format {
+                return m_shmFormat;
+            }
+
             inline auto GetHeight() const -> size_t {
                 return m_bufferHeight;
             }
@@ -40,14 +191,36 @@ namespace moco::wayland::implementation {
                 return m_bufferStride;
             }
 
-            inline auto AssignData(std::span<uint8_t> data, std::shared_ptr<SharedMemoryPool> parentPool) -> std::shared_ptr<Buffer> {
-                m_bufferData = data;
+            inline auto AssignData(size_t offset, size_t size, std::shared_ptr<SharedMemoryPool> parentPool) -> std::shared_ptr<Buffer> {
+                m_offset = offset;
+                m_size = size;
                 m_parentPool = parentPool;
 
                 // Allow call chaining
                 return shared_from_this();
             }
 
+            /**
+             * @brief Makes this a single-pixel buffer
+             * @details The buffer has no memory, it's 1x1 and every read
+             * of it is the color, see `wp_single_pixel_buffer_manager_v1`.
+             *
+             */
+            inline auto AssignSolidColor(const SolidColor &color) -> std::shared_ptr<Buffer> {
+                m_solidColor = color;
+                m_bufferHeight = 1;
+                m_bufferWidth = 1;
+                m_bufferStride = 0;
+
+                // Allow call chaining
+                return shared_from_this();
+            }
+
+            // Empty unless this is a single-pixel buffer
+            inline auto GetSolidColor() const -> std::optional<SolidColor> {
+                return m_solidColor;
+            }
+
             inline auto SetBufferFormat(size_t bufferHeight, size_t bufferWidth, size_t bufferStride) -> std::shared_ptr<Buffer> {
                 m_bufferHeight = bufferHeight;
                 m_bufferWidth = bufferWidth;
@@ -57,17 +230,34 @@ namespace moco::wayland::implementation {
                 return shared_from_this();
             }
         private:
-            inline Buffer(::wayland::server::buffer_t buffer, PixelFormats::Format format) :
-                ObjectImplementationBase(buffer),
-                m_format(format) {}
+            Buffer(::wayland::server::buffer_t buffer, PixelFormats::Format format);
+
+            auto HandleDestroy() -> void;
+            auto RecordHoldTime() -> void;
 
             std::shared_ptr<SharedMemoryPool> m_parentPool;
 
-            std::span<uint8_t> m_bufferData;
+            // Location within the pool, never an address
+            size_t m_offset{0};
+            size_t m_size{0};
             PixelFormats::Format m_format;
+            ::wayland::server::shm_format m_shmFormat{::wayland::server::shm_format::argb8888};
 
             size_t m_bufferHeight;
             size_t m_bufferWidth;
             size_t m_bufferStride;
+
+            std::optional<SolidColor> m_solidColor;
+
+            State m_state{State::Created};
+            // Committed and not released yet
+            bool m_held{false};
+            bool m_releasePending{false};
+            bool m_destroyed{false};
+            uint32_t m_renderUses{0};
+            uint32_t m_stateReferences{0};
+            std::chrono::steady_clock::time_point m_heldSince;
+
+            static HoldStatistics s_holdStatistics;
     };
 }  // namespace moco::wayland::implementation
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <pixman.h>
+
+namespace moco::wayland::implementation {
+    /**
+     * @brief Damage history of an output, for partial repaints
+     * @details Keeps the output-space damage of the last `s_capacity`
+     * frames. A render target that is reused holds a frame that is
+     * `age` frames old (`EGL_EXT_buffer_age`), so only what was damaged
+     * since then has to be drawn again, instead of the whole output.
+     *
+     * Damage for the frame being built is added with `AddDamage`, the
+     * repaint region for the target is queried with `GetRepaintRegion`,
+     * and `Rotate` moves the frame into the history once it's rendered.
+     *
+     */
+    class DamageRing {
+        public:
+            // Frames of history, enough for triple buffering with a spare
+            static constexpr size_t s_capacity = 4;
+
+            DamageRing(int width, int height);
+            ~DamageRing();
+
+            DamageRing(const DamageRing&) = delete;
+            auto operator=(const DamageRing&) -> DamageRing& = delete;
+
+            /**
+             * @brief Sets the output's size.
+             * @details Every buffer's content is stale after a resize, the
+             * history is dropped and the whole output is damaged.
+             *
+             */
+            auto Resize(int width, int height) -> void;
+
+            // Damage of the frame being built, clipped to the output
+            auto AddDamage(const pixman_region32_t &damage) -> void;
+            auto AddDamage(int x, int y, uint32_t width, uint32_t height) -> void;
+
+            // Marks the whole output as damaged
+            auto AddFullDamage() -> void;
+
+            /**
+             * @brief Returns what to repaint in a target of `bufferAge`.
+             * @details The damage of the frame being built, plus every
+             * frame since the target was last drawn. The whole output if
+             * the age is 0 (unknown content) or older than the history.
+             *
+             * @param `bufferAge`: Age of the target's content in frames,
+             * 1 if it holds the previous frame.
+             * @param `region`: Set to the region to repaint, must be
+             * initialized.
+             *
+             */
+            auto GetRepaintRegion(uint32_t bufferAge, pixman_region32_t &region) const -> void;
+
+            /**
+             * @brief Ends the frame being built.
+             * @details Its damage becomes the newest frame of the
+             * history, the oldest frame's region is reused for the next.
+             *
+             */
+            auto Rotate() -> void;
+
+        private:
+            std::array<pixman_region32_t, s_capacity> m_frames;
+            // Index of the newest frame in `m_frames`
+            size_t m_newest{0};
+            // Frames recorded since the last resize
+            size_t m_frameCount{0};
+
+            pixman_region32_t m_pending;
+
+            int m_width;
+            int m_height;
+    };
+}  // namespace moco::wayland::implementation
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <wayland-server-protocol.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace moco::wayland::implementation::PixelFormats {
+    /**
+     * @brief Converts one row of pixels to the canonical format
+     * @details The canonical format is premultiplied `a8r8g8b8`, what
+     * pixman and the renderer work with. `wl_shm` content is already
+     * premultiplied, so converting only reorders and widens channels.
+     *
+     * @param `source`: First pixel of the row, in the buffer's format.
+     * @param `destination`: First pixel of the canonical row.
+     * @param `width`: Number of pixels.
+     *
+     */
+    using RowConverter_t = void (*)(const uint8_t *source, uint32_t *destination, size_t width);
+
+    struct FormatInfo {
+        ::wayland::server::shm_format ShmFormat;
+        uint32_t BytesPerPixel{4};
+        bool HasAlpha{false};
+        RowConverter_t ConvertRow{nullptr};
+    };
+
+    /**
+     * @brief Every `wl_shm` format the compositor accepts
+     * @details Row converters are picked once, on first use, for the
+     * best instruction set the CPU supports: AVX2, SSE2 or plain C++.
+     *
+     */
+    class FormatRegistry {
+        public:
+            static constexpr size_t s_formatCount = 9;
+
+            // Null if the format isn't supported
+            static auto Get(::wayland::server::shm_format format) -> const FormatInfo*;
+
+            // Formats to advertise to clients
+            static auto GetSupportedFormats() -> std::span<const ::wayland::server::shm_format>;
+
+            // Instruction set of the selected converters, `avx2`, `sse2` or `scalar`
+            static auto GetKernelSet() -> std::string_view;
+
+            // Every instruction set there are converters for, best first
+            static constexpr std::array<std::string_view, 3> s_kernelSets = {"avx2", "sse2", "scalar"};
+
+            /**
+             * @brief Returns the row converters of one instruction set
+             * @details Lets tests and benchmarks compare every kernel set,
+             * not only the selected one.
+             *
+             * @return `std::array<RowConverter_t, s_formatCount>`: Converters
+             * in the order of `GetSupportedFormats`, all null if this build
+             * or CPU lacks the instruction set.
+             *
+             */
+            static auto GetRowConverters(std::string_view kernelSet) -> std::array<RowConverter_t, s_formatCount>;
+
+        private:
+            struct Registry {
+                std::array<FormatInfo, s_formatCount> Formats;
+                std::array<::wayland::server::shm_format, s_formatCount> ShmFormats;
+                std::string_view KernelSet;
+            };
+
+            static auto GetRegistry() -> const Registry&;
+            static auto CreateRegistry() -> Registry;
+    };
+}  // namespace moco::wayland::implementation::PixelFormats
@@ -1,13 +1,14 @@
 #pragma once
 
 #include "ObjectImplementationBase.hpp"
+#include "KeymapCache.hpp"
 #include "Surface.hpp"
 #include "Events.hpp"
 
 #include <wayland-server-protocol.hpp>
 #include <xkbcommon/xkbcommon.h>
 
-#include <span>
+#include <vector>
 
 namespace moco::wayland::implementation {
     class Keyboard : public ObjectImplementationBase<::wayland::server::keyboard_t, Keyboard> {
@@ -15,15 +16,21 @@ namespace moco::wayland::implementation {
         public:
             Keyboard(::wayland::server::keyboard_t keyboard, Private);
 
+            /**
+             * @brief Keyboard events.
+             * @details `Keymap` and `RepeatInfo` are broadcast to every
+             * keyboard resource. `Key` and `Modifier` are seat input, the
+             * seat routes them to the keyboard focus' client only.
+             *
+             */
             enum class Events {
                 Keymap,
-                Enter,
-                Leave,
                 Key,
                 Modifier,
                 RepeatInfo
             };
-            using EventSubscriber_t = compositor::EventSubscriber_t<Events>;
+            template <Events Event>
+            using EventSubscriber_t = compositor::EventSubscriber_t<Event>;
 
             struct Keymap_EventData {
                 ::wayland::server::keyboard_keymap_format Format;
@@ -31,17 +38,6 @@ namespace moco::wayland::implementation {
                 size_t Size{0};
             };
 
-            struct Enter_EventData {
-                uint32_t Serial{0};
-                std::shared_ptr<::moco::wayland::implementation::Surface> Surface{nullptr};
-                std::vector<uint32_t> Keys{};
-            };
-
-            struct Leave_EventData {
-                uint32_t Serial{0};
-                std::shared_ptr<::moco::wayland::implementation::Surface> Surface{nullptr};
-            };
-
             struct Key_EventData {
                 uint32_t Serial{0};
                 uint32_t Time{0};
@@ -62,26 +58,53 @@ namespace moco::wayland::implementation {
                 int32_t Delay{0};
             };
 
+            auto SendEnter(uint32_t serial, const Surface &surface, const std::vector<uint32_t> &keys) -> void;
+            auto SendLeave(uint32_t serial, const Surface &surface) -> void;
+            auto SendKey(const Key_EventData &data) -> void;
+            auto SendModifiers(const Modifier_EventData &data) -> void;
+
         private:
             Keyboard(::wayland::server::keyboard_t keyboard);
 
             auto HandleRelease() -> void;
 
-            std::span<uint8_t> m_data;
+            // Sends a private read only fd of the keymap, with its own offset
+            auto SendKeymap(::wayland::server::keyboard_keymap_format format, int fd, size_t size) -> void;
 
-            int m_xkbKeymapFd;
-            xkb_context *m_xkbContext;
-            xkb_keymap *m_xkbKeymap;
+            KeymapCache::Keymap_t m_keymap;
 
-            xkb_rule_names m_xkbRuleNames;
             // Use optional to get around default construction of event_source_t
             std::optional<::wayland::server::event_source_t> m_keyboardEventSource;
 
-            EventSubscriber_t m_keymapEvent;
-            EventSubscriber_t m_enterEvent;
-            EventSubscriber_t m_leaveEvent;
-            EventSubscriber_t m_keyEvent;
-            EventSubscriber_t m_modifierEvent;
-            EventSubscriber_t m_repeatInfoEvent;
+            EventSubscriber_t<Events::Keymap> m_keymapEvent;
+            EventSubscriber_t<Events::RepeatInfo> m_repeatInfoEvent;
     };
 }  // namespace moco::wayland::implementation
+
+namespace moco::compositor {
+    template <>
+    struct EventPayload<::moco::wayland::implementation::Keyboard::Events::Keymap> {
+        using Type = ::moco::wayland::implementation::Keyboard::Keymap_EventData;
+    };
+
+    template <>
+    struct EventPayload<::moco::wayland::implementation::Keyboard::Events::Key> {
+        using Type = ::moco::wayland::implementation::Keyboard::Key_EventData;
+    };
+
+    // Only the latest modifier state has to reach clients
+    template <>
+    struct EventPayload<::moco::wayland::implementation::Keyboard::Events::Modifier> {
+        using Type = ::moco::wayland::implementation::Keyboard::Modifier_EventData;
+
+        static inline auto Coalesce(Type &queued, const Type &incoming) -> bool {
+            queued = incoming;
+            return true;
+        }
+    };
+
+    template <>
+    struct EventPayload<::moco::wayland::implementation::Keyboard::Events::RepeatInfo> {
+        using Type = ::moco::wayland::implementation::Keyboard::RepeatInfo_EventData;
+    };
+}  // namespace moco::compositor
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <xkbcommon/xkbcommon.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace moco::wayland::implementation {
+    /**
+     * @brief Process-wide cache of compiled keymaps
+     * @details Keymaps are keyed by their `xkb_rule_names` and compiled
+     * once. Every keymap is serialized into a single memfd, sealed against
+     * writing, shrinking and growing, so no client can modify what others
+     * read. Each `wl_keyboard` resource reopens it read only through
+     * `OpenReadOnly`, which shares the memory but gives every client its
+     * own file offset.
+     *
+     * The cache is an immutable map swapped atomically, lookups never
+     * lock. `Invalidate` drops every entry at once, keymaps already handed
+     * out stay valid for as long as they're referenced.
+     *
+     * Compiled keymaps are also persisted as text under
+     * `$XDG_CACHE_HOME/moco/keymaps`, keyed by the rule names and the
+     * libxkbcommon version. A later start mmaps the file and parses the
+     * complete keymap from it, skipping rules resolution and the search
+     * for every included xkb file, which dominates compile time.
+     *
+     */
+    class KeymapCache {
+        public:
+            class Keymap {
+                public:
+                    Keymap(xkb_keymap *keymap, int fd, size_t size);
+                    ~Keymap();
+
+                    Keymap(const Keymap&) = delete;
+                    auto operator=(const Keymap&) -> Keymap& = delete;
+
+                    auto GetKeymap() const -> xkb_keymap*;
+
+                    // Read only, sealed memfd holding the serialized keymap
+                    auto GetFd() const -> int;
+
+                    // See `KeymapCache::OpenReadOnly`
+                    auto OpenReadOnly() const -> int;
+
+                    // Including the terminating null byte
+                    auto GetSize() const -> size_t;
+
+                private:
+                    xkb_keymap *m_keymap;
+                    int m_fd;
+                    size_t m_size;
+            };
+
+            using Keymap_t = std::shared_ptr<const Keymap>;
+
+            /**
+             * @brief Returns the keymap for the rule names, compiling it
+             * on the first use.
+             *
+             * @return `Keymap_t`: Null if the keymap failed to compile.
+             *
+             */
+            static auto Get(const xkb_rule_names &ruleNames) -> Keymap_t;
+
+            // Keymap of the `XKB_DEFAULT_*` environment variables
+            static auto GetDefault() -> Keymap_t;
+
+            /**
+             * @brief Drops every cached keymap.
+             * @details For when the keymap configuration changed, the next
+             * `Get` compiles again.
+             *
+             */
+            static auto Invalidate() -> void;
+
+            /**
+             * @brief Opens a new read only description of a file.
+             * @details Goes through `/proc/self/fd`, so unlike `dup` the
+             * returned fd has its own offset, starting at 0, and one
+             * client reading or seeking can't move it for the others.
+             *
+             * @return `int`: The new fd, owned by the caller, or -1.
+             *
+             */
+            static auto OpenReadOnly(int fd) -> int;
+
+        private:
+            using Entries_t = std::unordered_map<std::string, Keymap_t>;
+
+            static constexpr std::array<char, 8> s_fileMagic = {'M', 'O', 'C', 'O', 'X', 'K', 'B', 'C'};
+            static constexpr uint32_t s_fileVersion = 1;
+
+            /**
+             * @brief Header of a cache file.
+             * @details Followed by the key and the keymap text, including
+             * its terminating null byte.
+             *
+             */
+            struct FileHeader {
+                std::array<char, 8> Magic{s_fileMagic};
+                uint32_t Version{s_fileVersion};
+                uint32_t KeyLength{0};
+                uint64_t KeymapSize{0};
+                // libxkbcommon the keymap was serialized by, null padded
+                std::array<char, 32> XkbcommonVersion{};
+            };
+
+            static auto Compile(const std::string &key, const xkb_rule_names &ruleNames) -> Keymap_t;
+            static auto CreateKeymap(xkb_keymap *keymap, std::string_view text) -> Keymap_t;
+            static auto GetKey(const xkb_rule_names &ruleNames) -> std::string;
+
+            // Empty if there's no cache directory
+            static auto GetFilePath(const std::string &key) -> std::filesystem::path;
+            static auto ReadFile(const std::filesystem::path &path, const std::string &key, xkb_context *context) -> Keymap_t;
+            static auto WriteFile(const std::filesystem::path &path, const std::string &key, std::string_view text) -> void;
+            static auto WriteAll(int fd, std::string_view data) -> bool;
+            static auto GetXkbcommonVersion() -> std::array<char, 32>;
+
+            inline static std::atomic<std::shared_ptr<const Entries_t>> s_entries{std::make_shared<const Entries_t>()};
+    };
+}  // namespace moco::wayland::implementation
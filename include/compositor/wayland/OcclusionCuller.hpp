@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Surface.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <pixman.h>
+
+namespace moco::wayland::implementation {
+    /**
+     * @brief Drops damage hidden behind opaque surfaces
+     * @details Run once per frame before compositing. The stack is walked
+     * top-down, collecting every surface's opaque area in output
+     * coordinates. Each surface only keeps the damage inside its own
+     * bounds that no surface above it covers, and only that damage is
+     * uploaded from its buffer, so covered content is never read or
+     * blended. Hidden damage stays pending in the surface's upload cache
+     * until it's exposed. Once the opaque area covers all of the damage,
+     * every surface below is skipped without looking at it, e.g. whatever
+     * is under a fullscreen opaque application.
+     *
+     */
+    class OcclusionCuller {
+        public:
+            struct Entry {
+                std::shared_ptr<Surface> EntrySurface;
+                // Position of the surface in output coordinates
+                int X;
+                int Y;
+            };
+
+            OcclusionCuller();
+            ~OcclusionCuller();
+
+            OcclusionCuller(const OcclusionCuller&) = delete;
+            auto operator=(const OcclusionCuller&) -> OcclusionCuller& = delete;
+
+            /**
+             * @brief Computes the damage left to draw for every surface,
+             * and uploads it.
+             *
+             * @param `stack`: Surfaces to composite, top-most first.
+             * @param `damage`: Damage of the output, in output coordinates.
+             *
+             */
+            auto Cull(std::span<const Entry> stack, const pixman_region32_t &damage) -> void;
+
+            /**
+             * @brief Returns what to draw of the surface at `index` in the
+             * last culled stack, in output coordinates.
+             * @details Empty if the surface is completely hidden or wasn't
+             * damaged.
+             *
+             */
+            auto GetVisibleDamage(size_t index) const -> const pixman_region32_t&;
+
+            // Surfaces of the last culled stack with nothing to draw
+            auto GetCulledCount() const -> size_t;
+
+        private:
+            auto ResizeVisibleDamage(size_t size) -> void;
+
+            std::vector<pixman_region32_t> m_visibleDamage;
+            // Scratch, opaque area of the surface being walked
+            pixman_region32_t m_opaque;
+            size_t m_culledCount{0};
+    };
+}  // namespace moco::wayland::implementation
@@ -70,9 +70,7 @@ namespace moco::wayland::implementation::PixelFormats {
                 case ::wayland::server::shm_format::xrgb8888:
                     return Format::XRGB8888;
                 default:
-                    std::cerr << __PRETTY_FUNCTION__
-                              << ": Unsupported compositor pixel format."
-                              << std::endl;
+                    // Accepted by `FormatRegistry` and converted on upload, no typed view
                     return Format::NOT_SUPPORTED;
             }
         } else if constexpr (std::is_same_v<T, Format>) {
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ObjectImplementationBase.hpp"
+#include "Surface.hpp"
+#include "Events.hpp"
+
+#include <wayland-server-protocol.hpp>
+
+#include <array>
+#include <memory>
+
+namespace moco::wayland::implementation {
+    class Pointer : public ObjectImplementationBase<::wayland::server::pointer_t, Pointer> {
+            using ObjectImplementationBase::on_release;
+        public:
+            Pointer(::wayland::server::pointer_t pointer, Private);
+
+            // Seat input, routed to the pointer focus' client only
+            enum class Events {
+                Frame
+            };
+
+            template <Events Event>
+            using EventSubscriber_t = compositor::EventSubscriber_t<Event>;
+
+            struct Axis {
+                bool Active{false};
+                bool Stop{false};
+                double Value{0};
+                int32_t Value120{0};
+            };
+
+            /**
+             * @brief Every pointer change of one frame.
+             * @details Delivered as at most one motion, one button and the
+             * scroll of each axis, followed by a single `wl_pointer.frame`.
+             * Axes are indexed by `::wayland::server::pointer_axis`.
+             *
+             */
+            struct Frame_EventData {
+                uint32_t Serial{0};
+                uint32_t Time{0};
+
+                bool HasMotion{false};
+                // Surface local coordinates
+                double X{0};
+                double Y{0};
+
+                bool HasButton{false};
+                uint32_t Button{0};
+                ::wayland::server::pointer_button_state ButtonState{};
+
+                bool HasAxis{false};
+                ::wayland::server::pointer_axis_source AxisSource{};
+                std::array<Axis, 2> Axes{};
+            };
+
+            // Surface local coordinates
+            auto SendEnter(uint32_t serial, const Surface &surface, double x, double y) -> void;
+            auto SendLeave(uint32_t serial, const Surface &surface) -> void;
+            auto SendFrame(const Frame_EventData &data) -> void;
+
+        private:
+            Pointer(::wayland::server::pointer_t pointer);
+
+            // Versions the events were introduced in
+            static constexpr uint32_t s_frameSinceVersion = 5;
+            static constexpr uint32_t s_axisValue120SinceVersion = 8;
+
+            auto HandleRelease() -> void;
+    };
+}  // namespace moco::wayland::implementation
+
+namespace moco::compositor {
+    template <>
+    struct EventPayload<::moco::wayland::implementation::Pointer::Events::Frame> {
+        using Type = ::moco::wayland::implementation::Pointer::Frame_EventData;
+    };
+}  // namespace moco::compositor
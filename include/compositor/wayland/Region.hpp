@@ -15,6 +15,8 @@ namespace moco::wayland::implementation {
                 Region(::wayland::server::region_t region, Private);
                 ~Region();
 
+                auto GetRegion() const -> const pixman_region32_t&;
+
             private:
                 Region(::wayland::server::region_t region);
 
@@ -1,10 +1,19 @@
 #pragma once
 
 #include "ObjectImplementationBase.hpp"
+#include "Keyboard.hpp"
+#include "Pointer.hpp"
+#include "Touch.hpp"
 
 #include "wayland-server-protocol.hpp"
 
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 namespace moco::wayland::implementation {
+    class GlobalSeat;
+
     class Seat : public ObjectImplementationBase<::wayland::server::seat_t, Seat> {
             using ObjectImplementationBase::on_destroy;
             using ObjectImplementationBase::on_get_keyboard;
@@ -13,24 +22,135 @@ namespace moco::wayland::implementation {
             using ObjectImplementationBase::on_release;
 
         public:
-            Seat(::wayland::server::seat_t, Private);
+            Seat(::wayland::server::seat_t, GlobalSeat &globalSeat, Private);
 
         private:
-            Seat(::wayland::server::seat_t seat);
+            Seat(::wayland::server::seat_t seat, GlobalSeat &globalSeat);
 
             auto HandleGetPointer(::wayland::server::pointer_t pointer) -> void;
             auto HandleGetKeyboard(::wayland::server::keyboard_t keyboard) -> void;
             auto HandleGetTouch(::wayland::server::touch_t touch) -> void;
             auto HandleRelease() -> void;
+
+            GlobalSeat &m_globalSeat;
     };
 
+    /**
+     * @brief Seat global and its input routing
+     * @details Keeps a routing table from each client to the keyboard,
+     * pointer and touch resources it created through this seat. Seat
+     * input published on the event bus (`Keyboard::Events::Key`,
+     * `Pointer::Events::Frame`, ...) is only handled here, and sent
+     * straight to the resources of the client owning the focused surface.
+     * Delivering an event costs a single lookup however many clients are
+     * connected, and unfocused clients never see other clients' input.
+     *
+     * Every touch point is bound to the surface the touch focus was on
+     * when it went down, and its motion and up go to that surface's
+     * client until it's lifted, wherever the focus moved in between.
+     *
+     * Resources created while their client holds a focus get enter right
+     * away, the focus doesn't have to move for them to be usable.
+     *
+     */
     class GlobalSeat : public ::wayland::server::global_seat_t {
             using ::wayland::server::global_seat_t::on_bind;
         public:
             GlobalSeat(::wayland::server::display_t display);
 
+            /**
+             * @brief Moves the keyboard focus.
+             * @details Sends leave to the old focus and enter, with the
+             * keys currently held and the modifier state, to the new one.
+             *
+             * @param `surface`: The new focus, null to clear it.
+             *
+             */
+            auto SetKeyboardFocus(const std::shared_ptr<Surface> &surface) -> void;
+
+            /**
+             * @brief Moves the pointer focus.
+             *
+             * @param `surface`: The new focus, null to clear it.
+             * @param `x`, `y`: Surface local pointer position.
+             *
+             */
+            auto SetPointerFocus(const std::shared_ptr<Surface> &surface, double x, double y) -> void;
+
+            // Touch has no enter or leave, the focus receives the next down
+            // events, points already down stay with their surface
+            auto SetTouchFocus(const std::shared_ptr<Surface> &surface) -> void;
+
+            auto GetKeyboardFocus() const -> std::shared_ptr<Surface>;
+            auto GetPointerFocus() const -> std::shared_ptr<Surface>;
+            auto GetTouchFocus() const -> std::shared_ptr<Surface>;
+
+            auto AddKeyboard(const std::shared_ptr<Keyboard> &keyboard) -> void;
+            auto AddPointer(const std::shared_ptr<Pointer> &pointer) -> void;
+            auto AddTouch(const std::shared_ptr<Touch> &touch) -> void;
+
         private:
-            static auto OnBind(::wayland::server::client_t client, ::wayland::server::seat_t seat) -> void;
+            struct ClientResources {
+                std::vector<std::weak_ptr<Keyboard>> Keyboards;
+                std::vector<std::weak_ptr<Pointer>> Pointers;
+                std::vector<std::weak_ptr<Touch>> Touches;
+            };
+
+            struct Focus {
+                std::weak_ptr<Surface> FocusSurface;
+                // Routing table key of the surface's client
+                wl_client *Client{nullptr};
+            };
+
+            auto HandleBind(::wayland::server::client_t client, ::wayland::server::seat_t seat) -> void;
+
+            auto EventKey(const Keyboard::Key_EventData &data) -> void;
+            auto EventModifier(const Keyboard::Modifier_EventData &data) -> void;
+            auto EventPointerFrame(const Pointer::Frame_EventData &data) -> void;
+            auto EventTouchFrame(const Touch::Frame_EventData &data) -> void;
+            auto EventTouchCancel(const Touch::Cancel_EventData &data) -> void;
+
+            // Returns the focused client's resources, null if there are none
+            auto GetResources(const Focus &focus) -> ClientResources*;
+
+            // Whether a resource belongs to the client holding `focus`
+            template <typename Resource>
+            static auto HasFocus(const Focus &focus, const Resource &resource) -> bool;
+
+            /**
+             * @brief Calls `function` with every live resource in `resources`.
+             * @details Resources destroyed by their client are dropped on
+             * the way.
+             *
+             */
+            template <typename Resource, typename Function>
+            static auto ForEach(std::vector<std::weak_ptr<Resource>> &resources, Function &&function) -> void;
+
+            static auto MakeFocus(const std::shared_ptr<Surface> &surface) -> Focus;
+
+            ::wayland::server::display_t m_display;
+
+            std::unordered_map<wl_client*, ClientResources> m_clients;
+
+            Focus m_keyboardFocus;
+            Focus m_pointerFocus;
+            Focus m_touchFocus;
+
+            // Surface local pointer position, sent along with pointer enter events
+            double m_pointerX{0};
+            double m_pointerY{0};
+
+            // Touch points by id, with the focus they went down on
+            std::unordered_map<int32_t, Focus> m_touchPoints;
+
+            // Sent along with keyboard enter events
+            std::vector<uint32_t> m_pressedKeys;
+            Keyboard::Modifier_EventData m_modifiers;
 
+            compositor::EventSubscriber_t<Keyboard::Events::Key> m_keyEvent;
+            compositor::EventSubscriber_t<Keyboard::Events::Modifier> m_modifierEvent;
+            compositor::EventSubscriber_t<Pointer::Events::Frame> m_pointerFrameEvent;
+            compositor::EventSubscriber_t<Touch::Events::Frame> m_touchFrameEvent;
+            compositor::EventSubscriber_t<Touch::Events::Cancel> m_touchCancelEvent;
     };
 }  // namespace moco::wayland::implementation
@@ -4,13 +4,13 @@
 
 #include "ObjectImplementationBase.hpp"
 
+#include <span>
+
 namespace moco::wayland::implementation {
     class SharedMemory : public ObjectImplementationBase<::wayland::server::shm_t, SharedMemory> {
             using ObjectImplementationBase::on_create_pool;
             using ObjectImplementationBase::on_destroy;
 
-            static constexpr std::array<::wayland::server::shm_format, 2> s_supportedFormats = {::wayland::server::shm_format::argb8888, ::wayland::server::shm_format::xrgb8888};
-
         public:
             SharedMemory(::wayland::server::shm_t shm, Private);
 
@@ -20,7 +20,8 @@ namespace moco::wayland::implementation {
                 InvalidFd = 2
             };
 
-            static auto GetSupportedFormats() -> decltype(s_supportedFormats);
+            // See `PixelFormats::FormatRegistry`
+            static auto GetSupportedFormats() -> std::span<const ::wayland::server::shm_format>;
 
         private:
 
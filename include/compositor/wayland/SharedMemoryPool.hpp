@@ -5,6 +5,10 @@
 
 #include <wayland-server-protocol.hpp>
 #include <span>
+#include <mutex>
+#include <optional>
+
+#include <csignal>
 
 namespace moco::wayland::implementation {
     class SharedMemoryPool : public ObjectImplementationBase<::wayland::server::shm_pool_t, SharedMemoryPool> {
@@ -27,6 +31,50 @@ namespace moco::wayland::implementation {
              *
              */ 
             auto Assign(std::span<uint8_t> data) -> void;
+
+            /**
+             * @brief Returns the pool's current mapping
+             * @details The mapping may move when the pool grows, buffers
+             * only keep their offset and resolve it through here.
+             *
+             */
+            auto GetData() const -> std::span<uint8_t>;
+
+            /**
+             * @brief Starts reading or writing the pool's memory
+             * @details The client may shrink the file behind the pool at
+             * any time, touching the missing part would raise SIGBUS.
+             * Between `BeginAccess` and `EndAccess` a SIGBUS handler
+             * replaces the pool's mapping with anonymous zero pages
+             * instead, so the access can read the mapping directly
+             * without defensive copies. Accesses may nest.
+             *
+             */
+            auto BeginAccess() -> void;
+
+            /**
+             * @brief Ends an access started by `BeginAccess`
+             *
+             * @return `bool`: False if the pool's memory faulted at any
+             * point, its contents are zeroes from then on.
+             *
+             */
+            auto EndAccess() -> bool;
+
+            /**
+             * @brief Checks a `wl_shm_pool.create_buffer` request against
+             * the pool
+             * @details All of the arithmetic is overflow checked, the
+             * arguments come straight from the client.
+             *
+             * @param `bytesPerPixel`: Of the buffer's format.
+             * @param `poolSize`: Size of the pool's mapping.
+             *
+             * @return `std::optional<size_t>`: Bytes the buffer spans from
+             * `offset`, `std::nullopt` if it's malformed or doesn't fit.
+             *
+             */
+            static auto GetBufferSize(int32_t offset, int32_t width, int32_t height, int32_t stride, size_t bytesPerPixel, size_t poolSize) -> std::optional<size_t>;
         private:
 
             SharedMemoryPool(::wayland::server::shm_pool_t shm_pool);
@@ -35,6 +83,18 @@ namespace moco::wayland::implementation {
             auto HandleDestroy() -> void;
             auto HandleResize(size_t size) -> void;
 
+            static auto InstallSigbusHandler() -> void;
+            static auto HandleSigbus(int signal, siginfo_t *info, void *context) -> void;
+
             std::span<uint8_t> memorySpace;
+
+            size_t m_accessCount{0};
+            volatile sig_atomic_t m_accessFaulted{0};
+            // Next pool in this thread's list of active accesses
+            SharedMemoryPool *m_nextAccess{nullptr};
+
+            inline static thread_local SharedMemoryPool *s_activeAccesses{nullptr};
+            inline static struct sigaction s_previousSigbusAction{};
+            inline static std::once_flag s_sigbusHandlerInstalled;
     };
 }  // namespace moco::wayland::implementation
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <wayland-server-protocol.hpp>
+#include <wayland-server-protocol-single-pixel-buffer.hpp>
+
+#include "ObjectImplementationBase.hpp"
+
+namespace moco::wayland::implementation {
+    /**
+     * @brief `wp_single_pixel_buffer_manager_v1` implementation
+     * @details Creates 1x1 buffers of a single color, with no pool behind
+     * them. The color is kept by the `Buffer`, compositing fills the
+     * surface with it instead of reading pixels.
+     *
+     */
+    class SinglePixelBufferManager : public ObjectImplementationBase<::wayland::server::wp_single_pixel_buffer_manager_v1_t, SinglePixelBufferManager> {
+            using ObjectImplementationBase::on_create_u32_rgba_buffer;
+            using ObjectImplementationBase::on_destroy;
+
+        public:
+            SinglePixelBufferManager(::wayland::server::wp_single_pixel_buffer_manager_v1_t manager, Private);
+
+        private:
+            SinglePixelBufferManager(::wayland::server::wp_single_pixel_buffer_manager_v1_t manager);
+
+            auto HandleCreateU32RgbaBuffer(::wayland::server::buffer_t buffer, uint32_t red, uint32_t green, uint32_t blue, uint32_t alpha) -> void;
+            auto HandleDestroy() -> void;
+    };
+
+    class GlobalSinglePixelBufferManager : private ::wayland::server::global_wp_single_pixel_buffer_manager_v1_t {
+            using ::wayland::server::global_wp_single_pixel_buffer_manager_v1_t::on_bind;
+        public:
+            GlobalSinglePixelBufferManager(::wayland::server::display_t display);
+
+        private:
+            static auto OnBind(::wayland::server::client_t client, ::wayland::server::wp_single_pixel_buffer_manager_v1_t manager) -> void;
+    };
+}  // namespace moco::wayland::implementation
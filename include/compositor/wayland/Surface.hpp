@@ -3,9 +3,12 @@
 #include "ObjectImplementationBase.hpp"
 #include "Buffer.hpp"
 #include "Region.hpp"
+#include "SurfaceTransform.hpp"
+#include "SurfaceUploadCache.hpp"
 
+#include <array>
 #include <memory>
-#include <queue>
+#include <vector>
 #include <wayland-server-protocol.hpp>
 #include <pixman.h>
 
@@ -47,6 +50,56 @@ namespace moco::wayland::implementation {
 
         auto HasContent() -> bool;
 
+        // Compositor-side copy of the committed content
+        auto GetUploadCache() const -> const SurfaceUploadCache&;
+
+        /**
+         * @brief Copies the committed content within `region` into the
+         * upload cache.
+         * @details Content outside of it stays pending until a later
+         * upload asks for it, see `SurfaceUploadCache`. The buffer is
+         * released once all of it was copied.
+         *
+         * @param `region`: Area about to be drawn, e.g. the surface's
+         * visible damage from `OcclusionCuller`.
+         * @param `x`, `y`: Position of the surface within `region`.
+         *
+         * @return `size_t`: Bytes read from the buffer.
+         *
+         */
+        auto Upload(const pixman_region32_t &region, int x, int y) -> size_t;
+
+        // Logical size of the committed content
+        auto GetWidth() const -> size_t;
+        auto GetHeight() const -> size_t;
+
+        /**
+         * @brief Adds the committed opaque area to `region`.
+         * @details The opaque region set by the client, clipped to the
+         * surface. Content without alpha, e.g. `xrgb8888` or an opaque
+         * single-pixel buffer, is opaque as a whole.
+         *
+         * @param `region`: Region to add to.
+         * @param `x`, `y`: Position of the surface within `region`.
+         *
+         */
+        auto AddOpaqueRegion(pixman_region32_t &region, int x, int y) const -> void;
+
+        /**
+         * @brief Sends done to every committed frame callback.
+         * @details Called by the repaint once the committed content got
+         * presented. Callbacks of every commit since the last call are
+         * answered, none is dropped when a later commit replaces the
+         * content.
+         *
+         * @param `timeMs`: Presentation time in milliseconds.
+         *
+         */
+        auto SendFrameCallbacks(uint32_t timeMs) -> void;
+
+        // Whether a committed frame callback waits for a repaint
+        auto HasFrameCallbacks() const -> bool;
+
         /**
          * @brief Surface State Tracker
          *
@@ -57,23 +110,38 @@ namespace moco::wayland::implementation {
         class SurfaceState {
             public:
                 SurfaceState(const std::shared_ptr<Buffer> &buffer);
-                SurfaceState() = default;
+                SurfaceState();
                 ~SurfaceState();
 
-                SurfaceState(const SurfaceState &other);
-                SurfaceState(SurfaceState &&other) = delete;
+                // Move only, copying would duplicate the damage region
+                SurfaceState(const SurfaceState&) = delete;
+                auto operator=(const SurfaceState&) -> SurfaceState& = delete;
+
+                SurfaceState(SurfaceState &&other) noexcept;
+                auto operator=(SurfaceState &&other) noexcept -> SurfaceState&;
+
+                /**
+                 * @brief Prepares a recycled state as the next pending one.
+                 * @details Takes the buffer and every double-buffered
+                 * property that persists across commits from `current`,
+                 * then resets damage, the offset and frame callbacks.
+                 * Vectors keep their capacity.
+                 *
+                 */
+                auto Inherit(const SurfaceState &current) -> void;
 
                 auto AddBuffer(const std::shared_ptr<Buffer> &buffer) -> void;
                 auto GetBuffer() const -> std::shared_ptr<Buffer>;
 
                 auto AddSurfaceDamage(int x, int y, size_t width, size_t height) -> void;
                 auto AddSurfaceDamage(const Area &area) -> void;
-                auto GetSurfaceDamage() const -> std::vector<Area>;
+                auto GetSurfaceDamage() const -> const std::vector<Area>&;
 
                 auto AddBufferDamage(int x, int y, size_t width, size_t height) -> void;
                 auto AddBufferDamage(const Area &area) -> void;
 
                 auto GetDamageTracker() const -> pixman_region32_t;
+                auto GetDamage() const -> const pixman_region32_t&;
                 auto GetDamagedRegions() const -> std::vector<Area>;
 
                 auto SetBufferTransform(const ::wayland::server::output_transform &transform) -> void;
@@ -85,11 +153,17 @@ namespace moco::wayland::implementation {
                 auto GetLogicalWidth() const -> size_t;
                 auto GetLogicalHeight() const -> size_t;
 
+                // Movement of the surface requested by this commit, relative
+                // to the previous one. Doesn't carry over to the next commit.
                 auto SetBufferOffset(int x, int y) -> void;
                 auto GetBufferOffset() const -> std::pair<int, int>;
 
                 auto AddFrameCallback(::wayland::server::callback_t callback) -> void;
-                auto GetFrameCallbacks() const -> std::vector<::wayland::server::callback_t>;
+                auto GetFrameCallbacks() const -> const std::vector<::wayland::server::callback_t>&;
+
+                // Moves the frame callbacks to the end of `callbacks`
+                auto TakeFrameCallbacks(std::vector<::wayland::server::callback_t> &callbacks) -> void;
+
                 auto SetOpaqueRegion(std::shared_ptr<Region> region) -> void;
                 auto GetOpaqueRegion() const -> std::shared_ptr<Region>;
 
@@ -101,7 +175,18 @@ namespace moco::wayland::implementation {
                 // Buffer changing happens when AddBuffer is called ONLY.
                 auto Reset() -> void;
 
-                auto ConvertSurfaceToBuffer(const Area &area) -> Area;
+                auto ConvertSurfaceToBuffer(const Area &area) const -> Area;
+
+                auto GetSurfaceTransform() const -> SurfaceTransform;
+
+                /**
+                 * @brief Adds all surface damage of the commit to the
+                 * buffer damage.
+                 * @details Clipped to the surface, mapped with a single
+                 * `SurfaceTransform` and merged into the region at once.
+                 *
+                 */
+                auto ConvertSurfaceDamage() -> void;
 
             private:
                 // Will update true logical surface information based off of
@@ -116,18 +201,21 @@ namespace moco::wayland::implementation {
                 ::wayland::server::output_transform m_bufferTransform = ::wayland::server::output_transform::normal;
                 int m_bufferScale{1};
 
-                size_t m_bufferOffsetX;
-                size_t m_bufferOffsetY;
+                int m_bufferOffsetX{0};
+                int m_bufferOffsetY{0};
 
                 // Uniform logical surface area
                 // Calculated by inverse buffer transformatuins
-                size_t m_surfaceWidth;
-                size_t m_surfaceHeight;
+                size_t m_surfaceWidth{0};
+                size_t m_surfaceHeight{0};
 
                 std::vector<::wayland::server::callback_t> m_frameCallbacks;
 
                 std::shared_ptr<Region> m_opaqueRegion;
                 std::shared_ptr<Region> m_inputRegion;
+
+                // Scratch for `ConvertSurfaceDamage`, keeps its capacity
+                std::vector<pixman_box32_t> m_convertedDamage;
         };
 
     private:
@@ -144,10 +232,23 @@ namespace moco::wayland::implementation {
         auto HandleDamageBuffer(int x, int y, size_t width, size_t height) -> void;
         auto HandleOffset(int x, int y) -> void;
         
-        SurfaceState m_pendingState;
-        std::queue<SurfaceState> m_activeStates;
+        // Allocated once, the pending and current states trade places on
+        // every commit
+        std::array<SurfaceState, 2> m_states;
+        SurfaceState *m_pendingState{&m_states[0]};
+        SurfaceState *m_currentState{&m_states[1]};
+        // A buffer was attached since the last commit
+        bool m_pendingAttach{false};
 
         Roles m_surfaceRole;
 
+        SurfaceUploadCache m_uploadCache;
+
+        // Committed frame callbacks waiting for the repaint
+        std::vector<::wayland::server::callback_t> m_frameCallbacks;
+
+        // Scratch for `Upload`, keeps its capacity
+        std::vector<pixman_box32_t> m_uploadBoxes;
+
     };
 }  // namespace moco::wayland::implementation
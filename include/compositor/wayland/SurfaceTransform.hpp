@@ -0,0 +1,96 @@
+#pragma once
+
+#include <wayland-server-protocol.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include <pixman.h>
+
+namespace moco::wayland::implementation {
+    /**
+     * @brief Exact mapping from surface to buffer coordinates
+     * @details Each of the eight `wl_output.transform` values is a
+     * rotation and/or flip, which in integers is a matrix of 0 and ±1 plus
+     * a translation by the surface's width or height. The matrices are a
+     * constant table, everything depending on the surface is folded into
+     * the translation once, so mapping a rectangle is a few integer
+     * multiply-adds, without any rounding.
+     *
+     * Coordinates follow the protocol: the buffer is the surface with the
+     * transform applied, rotations being counter-clockwise and flips
+     * mirroring the x axis before rotating, then multiplied by the buffer
+     * scale.
+     *
+     */
+    class SurfaceTransform {
+        public:
+            /**
+             * @param `transform`: The surface's buffer transform.
+             * @param `scale`: The surface's buffer scale.
+             * @param `surfaceWidth`, `surfaceHeight`: Logical surface size,
+             * i.e. the buffer's size with the transform and scale undone.
+             *
+             * The `wl_surface.offset` of a commit moves the surface, not
+             * its content within the buffer, so it plays no part here.
+             *
+             */
+            constexpr SurfaceTransform(::wayland::server::output_transform transform, int scale, int surfaceWidth, int surfaceHeight) :
+                m_entry(s_table.at(static_cast<size_t>(transform))),
+                m_scale(scale)
+            {
+                // Negative coefficients mirror an axis, which moves it by
+                // the surface's extent along it
+                m_translateX = (m_entry.XX < 0 ? surfaceWidth : 0) + (m_entry.XY < 0 ? surfaceHeight : 0);
+                m_translateY = (m_entry.YX < 0 ? surfaceWidth : 0) + (m_entry.YY < 0 ? surfaceHeight : 0);
+            }
+
+            // Maps a rectangle, as `x1, y1` inclusive and `x2, y2` exclusive
+            constexpr auto Apply(const pixman_box32_t &box) const -> pixman_box32_t {
+                int32_t ax = MapX(box.x1, box.y1);
+                int32_t ay = MapY(box.x1, box.y1);
+                int32_t bx = MapX(box.x2, box.y2);
+                int32_t by = MapY(box.x2, box.y2);
+
+                return {
+                    .x1 = std::min(ax, bx) * m_scale,
+                    .y1 = std::min(ay, by) * m_scale,
+                    .x2 = std::max(ax, bx) * m_scale,
+                    .y2 = std::max(ay, by) * m_scale
+                };
+            }
+
+        private:
+            // bufferX = XX * x + XY * y, bufferY = YX * x + YY * y
+            struct Entry {
+                int8_t XX, XY;
+                int8_t YX, YY;
+            };
+
+            // Indexed by `wl_output.transform`
+            static constexpr std::array<Entry, 8> s_table = {{
+                { 1,  0,  0,  1},  // normal
+                { 0,  1, -1,  0},  // 90
+                {-1,  0,  0, -1},  // 180
+                { 0, -1,  1,  0},  // 270
+                {-1,  0,  0,  1},  // flipped
+                { 0,  1,  1,  0},  // flipped_90
+                { 1,  0,  0, -1},  // flipped_180
+                { 0, -1, -1,  0}   // flipped_270
+            }};
+
+            constexpr auto MapX(int32_t x, int32_t y) const -> int32_t {
+                return m_entry.XX * x + m_entry.XY * y + m_translateX;
+            }
+
+            constexpr auto MapY(int32_t x, int32_t y) const -> int32_t {
+                return m_entry.YX * x + m_entry.YY * y + m_translateY;
+            }
+
+            Entry m_entry;
+            int32_t m_scale;
+            int32_t m_translateX{0};
+            int32_t m_translateY{0};
+    };
+}  // namespace moco::wayland::implementation
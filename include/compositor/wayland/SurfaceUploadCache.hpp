@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Buffer.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include <pixman.h>
+
+namespace moco::wayland::implementation {
+    /**
+     * @brief Compositor-side copy of a surface's shm content
+     * @details Keeps a compositor-owned pixman image the size of the
+     * surface's buffer. A commit only records its damage as pending,
+     * nothing is read until the compositor asks for an area it is about
+     * to draw through `Upload`, so damage hidden behind other surfaces is
+     * never read. Damage left pending when the next buffer is committed
+     * is read from that buffer instead, which holds the complete content.
+     * The whole buffer is pending when its size or format changed.
+     *
+     * The image is always premultiplied `a8r8g8b8`, every damaged row is
+     * converted from the buffer's format while it's copied, using the
+     * converters of `PixelFormats::FormatRegistry`. Once nothing is
+     * pending, the buffer is marked as copied and the client may reuse it.
+     *
+     * A single-pixel buffer is never read, the image becomes a pixman
+     * solid fill of its color instead. It has no size, compositing it
+     * fills whatever area the surface is drawn to.
+     *
+     */
+    class SurfaceUploadCache {
+        public:
+            SurfaceUploadCache();
+            ~SurfaceUploadCache();
+
+            SurfaceUploadCache(const SurfaceUploadCache&) = delete;
+            auto operator=(const SurfaceUploadCache&) -> SurfaceUploadCache& = delete;
+
+            /**
+             * @brief Takes the committed content, without reading it.
+             *
+             * @param `buffer`: The committed buffer, null detaches it.
+             * @param `damage`: Damage in buffer coordinates.
+             *
+             */
+            auto Update(const std::shared_ptr<Buffer> &buffer, const pixman_region32_t &damage) -> void;
+
+            /**
+             * @brief Copies the pending damage within `region` into the image.
+             *
+             * @param `region`: Area about to be drawn, in buffer coordinates.
+             *
+             * @return `size_t`: Bytes read from the buffer.
+             *
+             */
+            auto Upload(const pixman_region32_t &region) -> size_t;
+
+            // Copies all pending damage, for when nothing is culled
+            auto UploadAll() -> size_t;
+
+            // Damage committed but not copied yet, in buffer coordinates
+            auto GetPendingDamage() const -> const pixman_region32_t&;
+            auto HasPendingDamage() const -> bool;
+
+            // Null until content was committed
+            auto GetImage() const -> pixman_image_t*;
+
+            // The image is a solid fill, of a single-pixel buffer
+            auto IsSolidColor() const -> bool;
+
+            auto GetLastCopiedBytes() const -> size_t;
+            auto GetTotalCopiedBytes() const -> uint64_t;
+
+        private:
+            auto UpdateSolidColor(const Buffer::SolidColor &color) -> void;
+            auto Copy(const pixman_region32_t &copyRegion) -> size_t;
+            auto ClearPending() -> void;
+
+            pixman_image_t *m_image{nullptr};
+            // Format of the buffer last committed
+            ::wayland::server::shm_format m_sourceFormat{::wayland::server::shm_format::argb8888};
+            // Set while the image is a solid fill
+            std::optional<Buffer::SolidColor> m_solidColor;
+
+            // Buffer to read `m_pendingDamage` from, null if nothing is pending
+            std::shared_ptr<Buffer> m_pendingBuffer;
+            pixman_region32_t m_pendingDamage;
+
+            size_t m_lastCopiedBytes{0};
+            uint64_t m_totalCopiedBytes{0};
+    };
+}  // namespace moco::wayland::implementation
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ObjectImplementationBase.hpp"
+#include "Surface.hpp"
+#include "Events.hpp"
+
+#include <wayland-server-protocol.hpp>
+
+#include <array>
+#include <memory>
+
+namespace moco::wayland::implementation {
+    class Touch : public ObjectImplementationBase<::wayland::server::touch_t, Touch> {
+            using ObjectImplementationBase::on_release;
+        public:
+            Touch(::wayland::server::touch_t touch, Private);
+
+            // Every slot of a frame can go down and up again
+            static constexpr size_t s_maxPoints = 20;
+
+            // Seat input, routed to the touch focus' client only
+            enum class Events {
+                Frame,
+                Cancel
+            };
+
+            template <Events Event>
+            using EventSubscriber_t = compositor::EventSubscriber_t<Event>;
+
+            enum class PointState : uint8_t {
+                Down,
+                Motion,
+                Up
+            };
+
+            struct Point {
+                int32_t Id{0};
+                PointState State{PointState::Motion};
+                // Surface local coordinates
+                double X{0};
+                double Y{0};
+            };
+
+            /**
+             * @brief Every touch point change of one touch frame.
+             * @details Delivered as the points' down, motion and up
+             * events followed by a single `wl_touch.frame`.
+             *
+             */
+            struct Frame_EventData {
+                uint32_t Serial{0};
+                uint32_t Time{0};
+                std::array<Point, s_maxPoints> Points{};
+                size_t PointCount{0};
+            };
+
+            struct Cancel_EventData {};
+
+            // `surface` receives the frame's down events, null if it has none
+            auto SendFrame(const Frame_EventData &data, const Surface *surface) -> void;
+            auto SendCancel() -> void;
+
+        private:
+            Touch(::wayland::server::touch_t touch);
+
+            auto HandleRelease() -> void;
+    };
+}  // namespace moco::wayland::implementation
+
+namespace moco::compositor {
+    template <>
+    struct EventPayload<::moco::wayland::implementation::Touch::Events::Frame> {
+        using Type = ::moco::wayland::implementation::Touch::Frame_EventData;
+    };
+
+    template <>
+    struct EventPayload<::moco::wayland::implementation::Touch::Events::Cancel> {
+        using Type = ::moco::wayland::implementation::Touch::Cancel_EventData;
+    };
+}  // namespace moco::compositor
@@ -0,0 +1,526 @@
+#include "Gestures.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cmath>
+#include <iostream>
+#include <numbers>
+#include <system_error>
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "Events.hpp"
+
+using namespace moco::backend;
+using namespace wayland::server;
+
+/* GestureRecognizer */
+
+GestureRecognizer::GestureRecognizer() :
+    GestureRecognizer(Config{}) {}
+
+GestureRecognizer::GestureRecognizer(Config config) :
+    m_config(config) {}
+
+auto GestureRecognizer::ProcessFrame(const TouchState::Frame &frame) -> Output {
+    Output output;
+
+    StepEdgeSwipe(frame, output);
+    StepPinch(frame, output);
+    StepHold(frame, output);
+
+    // Every finger lifted, the next touch starts from scratch
+    m_activeMask = frame.ActiveMask;
+    if (m_activeMask == 0) {
+        m_edgeSwipe = {};
+        m_pinch = {};
+        m_hold = {};
+    }
+
+    return output;
+}
+
+auto GestureRecognizer::ProcessTimeout(uint64_t timeUsec) -> Output {
+    Output output;
+
+    if (m_hold.MachineState == State::Possible && timeUsec >= m_hold.StartTimeUsec + m_config.HoldTimeoutUsec) {
+        BeginHold(timeUsec, output);
+    }
+
+    return output;
+}
+
+auto GestureRecognizer::Cancel(uint64_t timeUsec) -> Output {
+    Output output;
+
+    if (m_edgeSwipe.MachineState == State::Active) {
+        output.Push({.GestureKind = Kind::EdgeSwipe, .GesturePhase = Phase::Cancel, .TimeUsec = timeUsec, .Fingers = 1, .SwipeEdge = m_edgeSwipe.SwipeEdge});
+    }
+
+    if (m_pinch.MachineState == State::Active) {
+        output.Push({.GestureKind = Kind::Pinch, .GesturePhase = Phase::Cancel, .TimeUsec = timeUsec, .Fingers = 2});
+    }
+
+    if (m_hold.MachineState == State::Active) {
+        output.Push({.GestureKind = Kind::Hold, .GesturePhase = Phase::Cancel, .TimeUsec = timeUsec, .Fingers = m_hold.Fingers});
+    }
+
+    m_edgeSwipe = {};
+    m_pinch = {};
+    m_hold = {};
+    m_activeMask = 0;
+
+    return output;
+}
+
+auto GestureRecognizer::GetHoldDeadline() const -> std::optional<uint64_t> {
+    if (m_hold.MachineState != State::Possible) {
+        return std::nullopt;
+    }
+
+    return m_hold.StartTimeUsec + m_config.HoldTimeoutUsec;
+}
+
+auto GestureRecognizer::IsClaimed() const -> bool {
+    // Holds are left to clients as well (e.g. long presses),
+    // they never claim the touch sequence.
+    return m_edgeSwipe.MachineState == State::Active || m_pinch.MachineState == State::Active;
+}
+
+auto GestureRecognizer::StepEdgeSwipe(const TouchState::Frame &frame, Output &output) -> void {
+    EdgeSwipeMachine &machine = m_edgeSwipe;
+
+    if (machine.MachineState == State::Failed) {
+        return;
+    }
+
+    if (machine.MachineState == State::Idle) {
+        if (frame.DownMask == 0) {
+            return;
+        }
+
+        // Only a single finger touching down first can be an edge swipe
+        if (m_activeMask != 0 || std::popcount(frame.DownMask) != 1) {
+            machine.MachineState = State::Failed;
+            return;
+        }
+
+        size_t slot = std::countr_zero(frame.DownMask);
+        double x = frame.X[slot];
+        double y = frame.Y[slot];
+
+        std::array<double, 4> edgeDistances = {x, 1.0 - x, y, 1.0 - y};
+        auto closestEdge = std::min_element(edgeDistances.begin(), edgeDistances.end());
+        if (*closestEdge > m_config.EdgeMargin) {
+            machine.MachineState = State::Failed;
+            return;
+        }
+
+        machine = {
+            .MachineState = State::Possible,
+            .SwipeEdge = static_cast<Edge>(std::distance(edgeDistances.begin(), closestEdge)),
+            .Slot = slot,
+            .StartX = x,
+            .StartY = y,
+            .LastTimeUsec = frame.TimeUsec
+        };
+        return;
+    }
+
+    uint32_t slotBit = 1u << machine.Slot;
+    double dx = frame.X[machine.Slot] - machine.StartX;
+    double dy = frame.Y[machine.Slot] - machine.StartY;
+    double inward = GetInwardDistance(machine.SwipeEdge, dx, dy);
+    double sideways = GetSidewaysDistance(machine.SwipeEdge, dx, dy);
+
+    auto makeGesture = [&](Phase phase) -> Gesture {
+        return {
+            .GestureKind = Kind::EdgeSwipe,
+            .GesturePhase = phase,
+            .TimeUsec = frame.TimeUsec,
+            .Fingers = 1,
+            .SwipeEdge = machine.SwipeEdge,
+            .Velocity = machine.Velocity,
+            .X = frame.X[machine.Slot],
+            .Y = frame.Y[machine.Slot],
+            .Dx = dx,
+            .Dy = dy
+        };
+    };
+
+    // A second finger turns it into something else
+    if (frame.DownMask != 0) {
+        if (machine.MachineState == State::Active) {
+            output.Push(makeGesture(Phase::Cancel));
+        }
+
+        machine.MachineState = State::Failed;
+        return;
+    }
+
+    if (frame.MotionMask & slotBit && frame.TimeUsec > machine.LastTimeUsec) {
+        double elapsedSeconds = static_cast<double>(frame.TimeUsec - machine.LastTimeUsec) / 1'000'000.0;
+        machine.Velocity = (inward - machine.LastInward) / elapsedSeconds;
+        machine.LastInward = inward;
+        machine.LastTimeUsec = frame.TimeUsec;
+    }
+
+    if (machine.MachineState == State::Possible) {
+        if (frame.UpMask & slotBit) {
+            machine.MachineState = State::Failed;
+        } else if (inward >= m_config.SwipeDistance && inward > 2.0 * std::abs(sideways)) {
+            if (IsClaimed()) {
+                machine.MachineState = State::Failed;
+                return;
+            }
+
+            Claim(Kind::EdgeSwipe, frame.TimeUsec, output);
+            machine.MachineState = State::Active;
+            output.Push(makeGesture(Phase::Begin));
+        } else if (std::abs(sideways) > m_config.SwipeDistance || inward < -m_config.EdgeMargin) {
+            machine.MachineState = State::Failed;
+        }
+        return;
+    }
+
+    if (frame.UpMask & slotBit) {
+        output.Push(makeGesture(Phase::End));
+        machine.MachineState = State::Failed;
+    } else if (frame.MotionMask & slotBit) {
+        output.Push(makeGesture(Phase::Update));
+    }
+}
+
+auto GestureRecognizer::StepPinch(const TouchState::Frame &frame, Output &output) -> void {
+    PinchMachine &machine = m_pinch;
+
+    if (machine.MachineState == State::Failed) {
+        return;
+    }
+
+    if (machine.MachineState == State::Idle) {
+        int fingers = std::popcount(frame.ActiveMask);
+        if (fingers > 2) {
+            machine.MachineState = State::Failed;
+            return;
+        }
+
+        if (fingers != 2 || IsClaimed()) {
+            return;
+        }
+
+        size_t first = std::countr_zero(frame.ActiveMask);
+        size_t second = std::countr_zero(frame.ActiveMask & (frame.ActiveMask - 1));
+        double distance = std::hypot(frame.X[second] - frame.X[first], frame.Y[second] - frame.Y[first]);
+        if (distance <= 0) {
+            return;
+        }
+
+        machine = {
+            .MachineState = State::Possible,
+            .SlotMask = frame.ActiveMask,
+            .StartDistance = distance,
+            .StartAngle = std::atan2(frame.Y[second] - frame.Y[first], frame.X[second] - frame.X[first])
+        };
+        GetCentroid(frame, machine.SlotMask, machine.StartX, machine.StartY);
+        return;
+    }
+
+    if (frame.ActiveMask != machine.SlotMask) {
+        bool fingerAdded = std::popcount(frame.ActiveMask) > 2 || frame.DownMask != 0;
+        if (machine.MachineState == State::Active) {
+            output.Push({.GestureKind = Kind::Pinch, .GesturePhase = fingerAdded ? Phase::Cancel : Phase::End, .TimeUsec = frame.TimeUsec, .Fingers = 2});
+            machine.MachineState = State::Failed;
+        } else {
+            machine.MachineState = fingerAdded ? State::Failed : State::Idle;
+        }
+        return;
+    }
+
+    if ((frame.MotionMask & machine.SlotMask) == 0) {
+        return;
+    }
+
+    size_t first = std::countr_zero(machine.SlotMask);
+    size_t second = std::countr_zero(machine.SlotMask & (machine.SlotMask - 1));
+    double distance = std::hypot(frame.X[second] - frame.X[first], frame.Y[second] - frame.Y[first]);
+    double angle = std::atan2(frame.Y[second] - frame.Y[first], frame.X[second] - frame.X[first]);
+
+    Gesture gesture{
+        .GestureKind = Kind::Pinch,
+        .GesturePhase = Phase::Update,
+        .TimeUsec = frame.TimeUsec,
+        .Fingers = 2,
+        .Scale = distance / machine.StartDistance,
+        .Rotation = std::remainder(angle - machine.StartAngle, 2.0 * std::numbers::pi)
+    };
+    GetCentroid(frame, machine.SlotMask, gesture.X, gesture.Y);
+    gesture.Dx = gesture.X - machine.StartX;
+    gesture.Dy = gesture.Y - machine.StartY;
+
+    if (machine.MachineState == State::Possible) {
+        if (std::abs(gesture.Scale - 1.0) < m_config.PinchThreshold && std::abs(gesture.Rotation) < m_config.RotationThreshold) {
+            return;
+        }
+
+        if (IsClaimed()) {
+            machine.MachineState = State::Failed;
+            return;
+        }
+
+        Claim(Kind::Pinch, frame.TimeUsec, output);
+        machine.MachineState = State::Active;
+        gesture.GesturePhase = Phase::Begin;
+    }
+
+    output.Push(gesture);
+}
+
+auto GestureRecognizer::StepHold(const TouchState::Frame &frame, Output &output) -> void {
+    HoldMachine &machine = m_hold;
+
+    if (machine.MachineState == State::Failed) {
+        return;
+    }
+
+    if (machine.MachineState == State::Idle) {
+        if (frame.ActiveMask == 0 || IsClaimed()) {
+            return;
+        }
+
+        machine = {
+            .MachineState = State::Possible,
+            .Fingers = static_cast<uint32_t>(std::popcount(frame.ActiveMask)),
+            .StartTimeUsec = frame.TimeUsec
+        };
+        GetCentroid(frame, frame.ActiveMask, machine.StartX, machine.StartY);
+        return;
+    }
+
+    double x, y;
+    GetCentroid(frame, frame.ActiveMask, x, y);
+
+    if (machine.MachineState == State::Possible) {
+        if (frame.UpMask != 0) {
+            machine.MachineState = State::Failed;
+            return;
+        }
+
+        // More fingers joining restart the position, not the timeout
+        if (frame.DownMask != 0) {
+            machine.Fingers = std::popcount(frame.ActiveMask);
+            machine.StartX = x;
+            machine.StartY = y;
+        } else if (std::hypot(x - machine.StartX, y - machine.StartY) > m_config.HoldSlop) {
+            machine.MachineState = State::Failed;
+            return;
+        }
+
+        if (frame.TimeUsec >= machine.StartTimeUsec + m_config.HoldTimeoutUsec) {
+            BeginHold(frame.TimeUsec, output);
+        }
+        return;
+    }
+
+    Gesture gesture{
+        .GestureKind = Kind::Hold,
+        .TimeUsec = frame.TimeUsec,
+        .Fingers = machine.Fingers,
+        .X = machine.StartX,
+        .Y = machine.StartY
+    };
+
+    if (frame.ActiveMask == 0) {
+        gesture.GesturePhase = Phase::End;
+    } else if (frame.UpMask != 0 || frame.DownMask != 0 || std::hypot(x - machine.StartX, y - machine.StartY) > m_config.HoldSlop) {
+        gesture.GesturePhase = Phase::Cancel;
+    } else {
+        return;
+    }
+
+    output.Push(gesture);
+    machine.MachineState = State::Failed;
+}
+
+auto GestureRecognizer::BeginHold(uint64_t timeUsec, Output &output) -> void {
+    if (IsClaimed()) {
+        m_hold.MachineState = State::Failed;
+        return;
+    }
+
+    m_hold.MachineState = State::Active;
+    output.Push({
+        .GestureKind = Kind::Hold,
+        .GesturePhase = Phase::Begin,
+        .TimeUsec = timeUsec,
+        .Fingers = m_hold.Fingers,
+        .X = m_hold.StartX,
+        .Y = m_hold.StartY
+    });
+}
+
+auto GestureRecognizer::Claim(Kind claimer, uint64_t timeUsec, Output &output) -> void {
+    if (claimer != Kind::EdgeSwipe && m_edgeSwipe.MachineState == State::Possible) {
+        m_edgeSwipe.MachineState = State::Failed;
+    }
+
+    if (claimer != Kind::Pinch && m_pinch.MachineState == State::Possible) {
+        m_pinch.MachineState = State::Failed;
+    }
+
+    if (m_hold.MachineState == State::Active) {
+        output.Push({.GestureKind = Kind::Hold, .GesturePhase = Phase::Cancel, .TimeUsec = timeUsec, .Fingers = m_hold.Fingers, .X = m_hold.StartX, .Y = m_hold.StartY});
+    }
+
+    m_hold.MachineState = State::Failed;
+}
+
+auto GestureRecognizer::GetCentroid(const TouchState::Frame &frame, uint32_t mask, double &x, double &y) -> void {
+    x = 0;
+    y = 0;
+
+    int count = std::popcount(mask);
+    if (count == 0) {
+        return;
+    }
+
+    for (uint32_t remaining = mask; remaining != 0; remaining &= remaining - 1) {
+        size_t slot = std::countr_zero(remaining);
+        x += frame.X[slot];
+        y += frame.Y[slot];
+    }
+
+    x /= count;
+    y /= count;
+}
+
+auto GestureRecognizer::GetInwardDistance(Edge edge, double dx, double dy) -> double {
+    switch (edge) {
+        case Edge::Left:
+            return dx;
+        case Edge::Right:
+            return -dx;
+        case Edge::Top:
+            return dy;
+        case Edge::Bottom:
+            return -dy;
+    }
+
+    return 0;
+}
+
+auto GestureRecognizer::GetSidewaysDistance(Edge edge, double dx, double dy) -> double {
+    return (edge == Edge::Left || edge == Edge::Right) ? dy : dx;
+}
+
+/* Gestures */
+
+Gestures::Gestures(Private, display_t display, GestureRecognizer::Config config) :
+    BackendBase(Private()),
+    m_recognizer(config),
+    m_timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK))
+{
+    if (m_timerFd == -1) {
+        throw std::system_error(std::error_code(errno, std::system_category()));
+    }
+
+    Touch::Initialize(display);
+
+    m_timerSource = display.get_event_loop().add_fd(m_timerFd, fd_event_mask_t::readable, [this](int fd, uint32_t mask) -> int {
+        uint64_t expirations;
+        [[maybe_unused]] ssize_t bytesRead = read(fd, &expirations, sizeof(expirations));
+        BackendLoop();
+        return 0;
+    });
+
+    m_frameEvent = compositor::Events::Subscribe<Touch::Events::Frame>([this](const Touch::Frame_EventData &eventData) -> void {EventFrame(eventData);});
+    m_cancelEvent = compositor::Events::Subscribe<Touch::Events::Cancel>([this](const Touch::Cancel_EventData &eventData) -> void {
+        Publish(m_recognizer.Cancel(eventData.TimeUsec));
+        UpdateTimer();
+    });
+}
+
+Gestures::~Gestures() {
+    m_timerSource->remove();
+    close(m_timerFd);
+}
+
+auto Gestures::IsClaimed() const -> bool {
+    return m_recognizer.IsClaimed();
+}
+
+auto Gestures::BackendLoop() -> void {
+    Publish(m_recognizer.ProcessTimeout(GetMonotonicTimeUsec()));
+    UpdateTimer();
+}
+
+auto Gestures::EventFrame(const Touch::Frame_EventData &eventData) -> void {
+    Publish(m_recognizer.ProcessFrame(eventData));
+    UpdateTimer();
+
+    // Clients lose the sequence within the frame a gesture claimed it in
+    if (std::shared_ptr<Touch> touch = Touch::GetBackend(); touch != nullptr && m_recognizer.IsClaimed()) {
+        touch->Claim();
+    }
+}
+
+auto Gestures::Publish(const GestureRecognizer::Output &output) -> void {
+    for (size_t i = 0; i < output.Count; i++) {
+        const GestureRecognizer::Gesture &gesture = output.Gestures[i];
+
+        switch (gesture.GestureKind) {
+            case GestureRecognizer::Kind::EdgeSwipe:
+                compositor::Events::Publish<Events::EdgeSwipe>({
+                    .TimeUsec = gesture.TimeUsec,
+                    .Phase = gesture.GesturePhase,
+                    .Edge = gesture.SwipeEdge,
+                    .Dx = gesture.Dx,
+                    .Dy = gesture.Dy,
+                    .Velocity = gesture.Velocity
+                });
+                break;
+            case GestureRecognizer::Kind::Pinch:
+                compositor::Events::Publish<Events::Pinch>({
+                    .TimeUsec = gesture.TimeUsec,
+                    .Phase = gesture.GesturePhase,
+                    .Fingers = gesture.Fingers,
+                    .X = gesture.X,
+                    .Y = gesture.Y,
+                    .Dx = gesture.Dx,
+                    .Dy = gesture.Dy,
+                    .Scale = gesture.Scale,
+                    .Rotation = gesture.Rotation
+                });
+                break;
+            case GestureRecognizer::Kind::Hold:
+                compositor::Events::Publish<Events::Hold>({
+                    .TimeUsec = gesture.TimeUsec,
+                    .Phase = gesture.GesturePhase,
+                    .Fingers = gesture.Fingers,
+                    .X = gesture.X,
+                    .Y = gesture.Y
+                });
+                break;
+        }
+    }
+}
+
+auto Gestures::UpdateTimer() -> void {
+    // An all zero it_value disarms the timer
+    uint64_t deadlineUsec = m_recognizer.GetHoldDeadline().value_or(0);
+
+    itimerspec timerSpec{
+        .it_interval = {},
+        .it_value = {
+            .tv_sec = static_cast<time_t>(deadlineUsec / 1'000'000),
+            .tv_nsec = static_cast<long>(deadlineUsec % 1'000'000 * 1'000)
+        }
+    };
+
+    if (timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &timerSpec, nullptr) == -1) {
+        std::error_code err = std::error_code(errno, std::system_category());
+        std::cerr << __PRETTY_FUNCTION__ << ": " << err.message() << std::endl;
+    }
+}
@@ -0,0 +1,93 @@
+#include "InputTrace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+using namespace moco::backend::InputTrace;
+
+Writer::Writer(const std::filesystem::path &path) :
+    m_stream(path, std::ios::binary | std::ios::trunc)
+{
+    if (!m_stream) {
+        throw std::runtime_error(std::format("Failed to open input trace {} for writing.", path.string()));
+    }
+
+    FileHeader header;
+    m_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+auto Writer::WriteDevice(uint16_t device, std::string_view name, uint32_t vendor, uint32_t product, uint32_t capabilities) -> void {
+    DeviceInfo info{
+        .Vendor = vendor,
+        .Product = product,
+        .Capabilities = capabilities,
+        .NameLength = static_cast<uint16_t>(std::min<size_t>(name.size(), UINT16_MAX - sizeof(DeviceInfo)))
+    };
+
+    std::vector<std::byte> payload(sizeof(info) + info.NameLength);
+    std::memcpy(payload.data(), &info, sizeof(info));
+    std::memcpy(payload.data() + sizeof(info), name.data(), info.NameLength);
+
+    WriteRecord({.Kind = RecordKind::Device, .Device = device, .Size = static_cast<uint16_t>(payload.size())}, payload);
+}
+
+auto Writer::WriteEvent(uint64_t timeUsec, uint16_t device, uint16_t type, std::span<const std::byte> payload) -> void {
+    WriteRecord({.TimeUsec = timeUsec, .Kind = RecordKind::Event, .Type = type, .Device = device, .Size = static_cast<uint16_t>(payload.size())}, payload);
+}
+
+auto Writer::Flush() -> void {
+    m_stream.flush();
+}
+
+auto Writer::WriteRecord(const RecordHeader &header, std::span<const std::byte> payload) -> void {
+    m_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_stream.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+}
+
+Reader::Reader(const std::filesystem::path &path) {
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream) {
+        throw std::runtime_error(std::format("Failed to open input trace {} for reading.", path.string()));
+    }
+
+    m_data.resize(stream.tellg());
+    stream.seekg(0);
+    stream.read(reinterpret_cast<char*>(m_data.data()), m_data.size());
+
+    FileHeader header;
+    if (m_data.size() < sizeof(header)) {
+        throw std::runtime_error(std::format("Input trace {} is truncated.", path.string()));
+    }
+
+    std::memcpy(&header, m_data.data(), sizeof(header));
+    if (header.Magic != s_magic || header.Version != s_version) {
+        throw std::runtime_error(std::format("Input trace {} has an unsupported format (version {}).", path.string(), header.Version));
+    }
+}
+
+auto Reader::Next() -> std::optional<Record> {
+    if (m_position + sizeof(RecordHeader) > m_data.size()) {
+        return std::nullopt;
+    }
+
+    Record record;
+    std::memcpy(&record.Header, m_data.data() + m_position, sizeof(RecordHeader));
+    m_position += sizeof(RecordHeader);
+
+    // A partially written last record is dropped
+    if (m_position + record.Header.Size > m_data.size()) {
+        m_position = m_data.size();
+        return std::nullopt;
+    }
+
+    record.Payload = std::span<const std::byte>(m_data.data() + m_position, record.Header.Size);
+    m_position += record.Header.Size;
+
+    return record;
+}
+
+auto Reader::Rewind() -> void {
+    m_position = sizeof(FileHeader);
+}
@@ -0,0 +1,234 @@
+#include "KeyBindings.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+using namespace moco::backend;
+
+auto KeyBindings::Add(std::span<const Chord> sequence, Action_t action) -> bool {
+    if (sequence.empty() || sequence.size() > s_maxSequenceLength) {
+        return false;
+    }
+
+    Binding binding{.Length = sequence.size(), .Action = std::move(action)};
+    std::copy(sequence.begin(), sequence.end(), binding.Sequence.begin());
+    m_bindings.push_back(std::move(binding));
+
+    return true;
+}
+
+auto KeyBindings::Add(std::string_view sequence, Action_t action) -> bool {
+    std::array<Chord, s_maxSequenceLength> chords;
+    size_t length{0};
+
+    while (!sequence.empty()) {
+        size_t end = sequence.find(' ');
+        std::string_view chordText = sequence.substr(0, end);
+        sequence.remove_prefix(end == std::string_view::npos ? sequence.size() : end + 1);
+
+        if (chordText.empty()) {
+            continue;
+        }
+
+        std::optional<Chord> chord = ParseChord(chordText);
+        if (!chord.has_value() || length == chords.size()) {
+            std::cerr << __PRETTY_FUNCTION__ << ": "
+                      << "Invalid key binding chord \"" << chordText << "\"."
+                      << std::endl;
+            return false;
+        }
+
+        chords[length++] = chord.value();
+    }
+
+    return Add(std::span<const Chord>(chords.data(), length), std::move(action));
+}
+
+auto KeyBindings::Clear() -> void {
+    m_bindings.clear();
+    Compile();
+}
+
+auto KeyBindings::Compile() -> void {
+    // Only compiling allocates, so a plain map does for building the trie
+    std::unordered_map<uint64_t, Entry> edges;
+    uint32_t nodeCount{1};
+
+    m_actions.clear();
+
+    for (Binding &binding : m_bindings) {
+        uint32_t node = s_rootNode;
+        bool conflict{false};
+
+        for (size_t i = 0; i < binding.Length && !conflict; i++) {
+            const Chord &chord = binding.Sequence[i];
+            uint64_t key = PackKey(node, chord.Modifiers, chord.Keysym);
+            bool last = i + 1 == binding.Length;
+
+            auto edge = edges.find(key);
+            if (edge == edges.end()) {
+                if (last) {
+                    edges[key] = {.Key = key, .Target = static_cast<uint32_t>(m_actions.size()), .IsAction = true};
+                    m_actions.push_back(binding.Action);
+                } else if (nodeCount > s_maxNode) {
+                    std::cerr << __PRETTY_FUNCTION__ << ": "
+                              << "Too many key binding sequences, skipping the rest."
+                              << std::endl;
+                    break;
+                } else {
+                    edges[key] = {.Key = key, .Target = nodeCount, .IsAction = false};
+                    node = nodeCount++;
+                }
+            } else if (last || edge->second.IsAction) {
+                // The same sequence, or one being a prefix of the other
+                conflict = true;
+            } else {
+                node = edge->second.Target;
+            }
+        }
+
+        if (conflict) {
+            std::cerr << __PRETTY_FUNCTION__ << ": "
+                      << "Key binding conflicts with an earlier binding, skipping it."
+                      << std::endl;
+        }
+    }
+
+    // At most half full keeps probe sequences short
+    size_t capacity = std::bit_ceil(std::max<size_t>(edges.size() * 2, 8));
+    m_table.assign(capacity, Entry{});
+    m_tableShift = 64 - std::countr_zero(capacity);
+
+    for (const auto &[key, entry] : edges) {
+        Insert(entry);
+    }
+
+    Reset();
+}
+
+auto KeyBindings::Press(uint32_t key, uint32_t modifiers, xkb_keysym_t keysym) -> bool {
+    // Modifiers being pressed are part of the next chord,
+    // they neither match nor break a sequence.
+    if (IsModifierKeysym(keysym)) {
+        return false;
+    }
+
+    const Entry *entry = Find(PackKey(m_node, modifiers, keysym));
+
+    // A key not continuing the sequence abandons it, and
+    // may still start a binding of its own.
+    if (entry == nullptr && m_node != s_rootNode) {
+        m_node = s_rootNode;
+        entry = Find(PackKey(m_node, modifiers, keysym));
+    }
+
+    if (entry == nullptr) {
+        return false;
+    }
+
+    if (key < m_consumedKeys.size()) {
+        m_consumedKeys.set(key);
+    }
+
+    if (entry->IsAction) {
+        m_node = s_rootNode;
+        m_actions[entry->Target]();
+    } else {
+        m_node = entry->Target;
+    }
+
+    return true;
+}
+
+auto KeyBindings::Release(uint32_t key) -> bool {
+    if (key >= m_consumedKeys.size() || !m_consumedKeys.test(key)) {
+        return false;
+    }
+
+    m_consumedKeys.reset(key);
+    return true;
+}
+
+auto KeyBindings::Reset() -> void {
+    m_node = s_rootNode;
+}
+
+auto KeyBindings::IsPending() const -> bool {
+    return m_node != s_rootNode;
+}
+
+auto KeyBindings::PackKey(uint32_t node, uint32_t modifiers, xkb_keysym_t keysym) -> uint64_t {
+    return (static_cast<uint64_t>(node & s_maxNode) << 48) | (static_cast<uint64_t>(modifiers & 0xffff) << 32) | keysym;
+}
+
+auto KeyBindings::IsModifierKeysym(xkb_keysym_t keysym) -> bool {
+    // Shift_L to Hyper_R, and the ISO lock and level keys
+    return (keysym >= 0xffe1 && keysym <= 0xffee) || (keysym >= 0xfe01 && keysym <= 0xfe0f);
+}
+
+auto KeyBindings::ParseChord(std::string_view text) -> std::optional<Chord> {
+    Chord chord;
+
+    while (true) {
+        size_t separator = text.find('+');
+        // A trailing "+" is the plus key itself
+        if (separator == std::string_view::npos || separator + 1 == text.size()) {
+            break;
+        }
+
+        std::string_view modifier = text.substr(0, separator);
+        if (modifier == "Shift") {
+            chord.Modifiers |= Shift;
+        } else if (modifier == "Ctrl" || modifier == "Control") {
+            chord.Modifiers |= Ctrl;
+        } else if (modifier == "Alt" || modifier == "Mod1") {
+            chord.Modifiers |= Alt;
+        } else if (modifier == "Logo" || modifier == "Super" || modifier == "Mod4") {
+            chord.Modifiers |= Logo;
+        } else {
+            return std::nullopt;
+        }
+
+        text.remove_prefix(separator + 1);
+    }
+
+    std::string keysymName(text);
+    // Bindings match the first shift level, which is lower case
+    chord.Keysym = xkb_keysym_to_lower(xkb_keysym_from_name(keysymName.c_str(), XKB_KEYSYM_CASE_INSENSITIVE));
+    if (chord.Keysym == XKB_KEY_NoSymbol) {
+        return std::nullopt;
+    }
+
+    return chord;
+}
+
+auto KeyBindings::Find(uint64_t key) const -> const Entry* {
+    if (m_table.empty()) {
+        return nullptr;
+    }
+
+    size_t mask = m_table.size() - 1;
+    for (size_t index = (key * 0x9e3779b97f4a7c15ull) >> m_tableShift; ; index = (index + 1) & mask) {
+        const Entry &entry = m_table[index];
+        if (entry.Key == key) {
+            return &entry;
+        }
+
+        if (entry.Key == s_emptyKey) {
+            return nullptr;
+        }
+    }
+}
+
+auto KeyBindings::Insert(const Entry &entry) -> void {
+    size_t mask = m_table.size() - 1;
+    size_t index = (entry.Key * 0x9e3779b97f4a7c15ull) >> m_tableShift;
+    while (m_table[index].Key != s_emptyKey) {
+        index = (index + 1) & mask;
+    }
+
+    m_table[index] = entry;
+}
@@ -1,28 +1,119 @@
 #include "Keyboard.hpp"
 
+#include <cstdlib>
+#include <stdexcept>
+
 #include "Events.hpp"
 #include "LibInput.hpp"
+#include "wayland/Keyboard.hpp"
 
 using namespace moco::backend;
 using namespace moco::compositor;
 using namespace wayland::server;
 
 Keyboard::Keyboard(Private, display_t display) :
-    BackendBase(Private())
+    BackendBase(Private()),
+    m_display(display)
 {
     LibInput::Initialize(display);
 
-    Events::Subscribe(LibInput::Events::KeyboardKey, [this](std::any eventData) -> void {});
+    // The same keymap clients get, so both agree on modifier indices
+    m_keymap = wayland::implementation::KeymapCache::GetDefault();
+    if (m_keymap == nullptr) {
+        throw std::runtime_error("Failed to compile the xkb keymap.");
+    }
+
+    m_xkbState = xkb_state_new(m_keymap->GetKeymap());
+
+    // Binding modifiers don't depend on the keymap's modifier indices
+    const std::array<const char*, 4> modifierNames = {XKB_MOD_NAME_SHIFT, XKB_MOD_NAME_CTRL, XKB_MOD_NAME_ALT, XKB_MOD_NAME_LOGO};
+    for (size_t i = 0; i < modifierNames.size(); i++) {
+        xkb_mod_index_t index = xkb_keymap_mod_get_index(m_keymap->GetKeymap(), modifierNames[i]);
+        m_bindingModifierMasks[i] = index == XKB_MOD_INVALID ? 0 : xkb_mod_mask_t{1} << index;
+    }
+
+    m_keyboardKeyEvent = Events::Subscribe<LibInput::Events::KeyboardKey>([this](const LibInput::KeyboardKey_EventData &keyboardEvent) -> void {EventKeyboardKey(keyboardEvent);});
+    m_keyboardKeyEvent->SetLabel("backend::Keyboard::EventKeyboardKey");
+}
+
+Keyboard::~Keyboard() {
+    xkb_state_unref(m_xkbState);
+}
+
+auto Keyboard::GetKeyBindings() -> KeyBindings& {
+    return m_keyBindings;
+}
+
+auto Keyboard::BackendLoop() -> void {
+
+}
+
+auto Keyboard::EventKeyboardKey(const LibInput::KeyboardKey_EventData &keyboardEvent) -> void {
+    // xkb keycodes are evdev keycodes offset by 8
+    xkb_keycode_t keycode = keyboardEvent.Key + 8;
+    bool pressed = keyboardEvent.KeyState == LIBINPUT_KEY_STATE_PRESSED;
+
+    // Bindings see the modifiers held before the key itself
+    bool consumed = pressed ? m_keyBindings.Press(keyboardEvent.Key, GetBindingModifiers(), GetBaseKeysym(keycode))
+                            : m_keyBindings.Release(keyboardEvent.Key);
+
+    xkb_state_component changed = xkb_state_update_key(m_xkbState, keycode, pressed ? XKB_KEY_DOWN : XKB_KEY_UP);
+
+    // Consumed keys never reach clients
+    if (!consumed) {
+        Events::Publish<wayland::implementation::Keyboard::Events::Key>({
+            .Serial = m_display.next_serial(),
+            .Time = static_cast<uint32_t>(keyboardEvent.TimeUsec / 1'000),
+            .Key = keyboardEvent.Key,
+            .KeyState = pressed ? keyboard_key_state::pressed : keyboard_key_state::released
+        });
+    }
+
+    // Most keys don't touch the modifier state at all
+    if (changed & (XKB_STATE_MODS_DEPRESSED | XKB_STATE_MODS_LATCHED | XKB_STATE_MODS_LOCKED | XKB_STATE_LAYOUT_EFFECTIVE)) {
+        UpdateModifiers();
+    }
 }
 
-auto Keyboard::EventKeyboardKey(std::any eventData) -> void {
-    try {
-        libinput_event_keyboard *keyboardEvent = std::any_cast<libinput_event_keyboard*>(eventData);
+auto Keyboard::UpdateModifiers() -> void {
+    ModifierState modifierState{
+        .Depressed = xkb_state_serialize_mods(m_xkbState, XKB_STATE_MODS_DEPRESSED),
+        .Latched = xkb_state_serialize_mods(m_xkbState, XKB_STATE_MODS_LATCHED),
+        .Locked = xkb_state_serialize_mods(m_xkbState, XKB_STATE_MODS_LOCKED),
+        .Group = xkb_state_serialize_layout(m_xkbState, XKB_STATE_LAYOUT_EFFECTIVE)
+    };
 
+    // e.g. only the effective mask changed
+    if (modifierState == m_modifierState) {
+        return;
+    }
+
+    m_modifierState = modifierState;
+    Events::Publish<wayland::implementation::Keyboard::Events::Modifier>({
+        .Serial = m_display.next_serial(),
+        .ModsDepressed = modifierState.Depressed,
+        .ModsLatched = modifierState.Latched,
+        .ModsLocked = modifierState.Locked,
+        .Group = modifierState.Group
+    });
+}
+
+auto Keyboard::GetBindingModifiers() const -> uint32_t {
+    // Locked modifiers (e.g. Caps Lock) don't change which binding matches
+    xkb_mod_mask_t active = xkb_state_serialize_mods(m_xkbState, static_cast<xkb_state_component>(XKB_STATE_MODS_DEPRESSED | XKB_STATE_MODS_LATCHED));
 
-    } catch (const std::bad_any_cast &err) {
-        std::cerr << __PRETTY_FUNCTION__ << ": "
-                  << "Event data error: Type mismatch."
-                  << std::endl;
+    uint32_t modifiers{0};
+    for (size_t i = 0; i < m_bindingModifierMasks.size(); i++) {
+        if (active & m_bindingModifierMasks[i]) {
+            modifiers |= 1u << i;
+        }
     }
+
+    return modifiers;
+}
+
+auto Keyboard::GetBaseKeysym(xkb_keycode_t keycode) const -> xkb_keysym_t {
+    const xkb_keysym_t *keysyms;
+    int count = xkb_keymap_key_get_syms_by_level(m_keymap->GetKeymap(), keycode, xkb_state_key_get_layout(m_xkbState, keycode), 0, &keysyms);
+    return count > 0 ? keysyms[0] : XKB_KEY_NoSymbol;
 }
@@ -3,6 +3,15 @@
 #include <cerrno>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <system_error>
 
 #include "Events.hpp"
 
@@ -23,46 +32,129 @@ const libinput_interface LibInput::s_libinputInterface = {
     .close_restricted = CloseRestricted
 };
 
-LibInput::LibInput(Private, display_t display) :
+LibInput::LibInput(Private, display_t) :
     BackendBase(Private()),
     m_udevHandle(udev_new())
 {
     m_libinputHandle = libinput_udev_create_context(&s_libinputInterface, nullptr, m_udevHandle);
+    if (libinput_udev_assign_seat(m_libinputHandle, "seat0") != 0) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << "Failed to assign seat0 to the libinput context."
+                  << std::endl;
+    }
+
+    if (const char *tracePath = getenv("MOCO_INPUT_RECORD")) {
+        m_traceWriter.emplace(tracePath);
+    }
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_epollFd == -1 || m_stopFd == -1) {
+        throw std::system_error(std::error_code(errno, std::system_category()));
+    }
+
+    epoll_event libinputEvent{.events = EPOLLIN, .data = {.fd = libinput_get_fd(m_libinputHandle)}};
+    epoll_event stopEvent{.events = EPOLLIN, .data = {.fd = m_stopFd}};
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, libinputEvent.data.fd, &libinputEvent) == -1 ||
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_stopFd, &stopEvent) == -1) {
+        throw std::system_error(std::error_code(errno, std::system_category()));
+    }
 
-    display.get_event_loop().add_idle([this]() -> void {BackendLoop();});
+    // From here on the libinput context belongs to the input thread
+    m_inputThread = std::jthread([this](std::stop_token stopToken) -> void {InputThread(stopToken);});
 }
 
 LibInput::~LibInput() {
+    m_inputThread.request_stop();
+
+    uint64_t count{1};
+    [[maybe_unused]] ssize_t written = write(m_stopFd, &count, sizeof(count));
+    m_inputThread.join();
+
+    if (m_traceWriter.has_value()) {
+        m_traceWriter->Flush();
+    }
+
+    close(m_stopFd);
+    close(m_epollFd);
+
     libinput_unref(m_libinputHandle);
     udev_unref(m_udevHandle);
 }
 
+auto LibInput::InputThread(std::stop_token stopToken) -> void {
+    // Events queued while the seat was assigned (e.g. device added)
+    // are already waiting.
+    libinput_dispatch(m_libinputHandle);
+    BackendLoop(stopToken);
+
+    std::array<epoll_event, 2> events;
+    while (!stopToken.stop_requested()) {
+        int numEvents = epoll_wait(m_epollFd, events.data(), events.size(), -1);
+        if (numEvents == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            std::error_code err = std::error_code(errno, std::system_category());
+            std::cerr << __PRETTY_FUNCTION__ << ": " << err.message() << std::endl;
+            return;
+        }
+
+        for (int i = 0; i < numEvents; i++) {
+            if (events[i].data.fd == libinput_get_fd(m_libinputHandle)) {
+                libinput_dispatch(m_libinputHandle);
+                BackendLoop(stopToken);
+            }
+        }
+    }
+}
+
+// Only the input thread handles libinput events, and it has a stop
+// token to hand down. Anyone else waits for the ring without one.
 auto LibInput::BackendLoop() -> void {
+    BackendLoop(std::stop_token{});
+}
+
+auto LibInput::BackendLoop(const std::stop_token &stopToken) -> void {
     libinput_event *event;
     while ((event = libinput_get_event(m_libinputHandle)) != nullptr) {
         /* Handle each libinput event */
-        libinput_device *device = libinput_event_get_device(event);
-        
         switch (libinput_event_get_type(event)) {
-
-            case LIBINPUT_EVENT_NONE:
-            case LIBINPUT_EVENT_DEVICE_ADDED:
-            case LIBINPUT_EVENT_DEVICE_REMOVED:
             case LIBINPUT_EVENT_KEYBOARD_KEY:
-                HandleKeyboardEvent(libinput_event_get_keyboard_event(event));
+                HandleKeyboardEvent(libinput_event_get_keyboard_event(event), stopToken);
                 break;
             case LIBINPUT_EVENT_POINTER_MOTION:
+                HandlePointerMotionEvent(libinput_event_get_pointer_event(event), stopToken);
+                break;
             case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+                HandlePointerMotionAbsoluteEvent(libinput_event_get_pointer_event(event), stopToken);
+                break;
             case LIBINPUT_EVENT_POINTER_BUTTON:
-            case LIBINPUT_EVENT_POINTER_AXIS:
+                HandlePointerButtonEvent(libinput_event_get_pointer_event(event), stopToken);
+                break;
             case LIBINPUT_EVENT_POINTER_SCROLL_WHEEL:
             case LIBINPUT_EVENT_POINTER_SCROLL_FINGER:
             case LIBINPUT_EVENT_POINTER_SCROLL_CONTINUOUS:
+                HandlePointerScrollEvent(libinput_event_get_type(event), libinput_event_get_pointer_event(event), stopToken);
+                break;
             case LIBINPUT_EVENT_TOUCH_DOWN:
-            case LIBINPUT_EVENT_TOUCH_UP:
             case LIBINPUT_EVENT_TOUCH_MOTION:
+            case LIBINPUT_EVENT_TOUCH_UP:
             case LIBINPUT_EVENT_TOUCH_CANCEL:
             case LIBINPUT_EVENT_TOUCH_FRAME:
+                HandleTouchEvent(libinput_event_get_type(event), libinput_event_get_touch_event(event), stopToken);
+                break;
+            case LIBINPUT_EVENT_DEVICE_ADDED:
+                HandleDeviceAdded(libinput_event_get_device(event));
+                break;
+            case LIBINPUT_EVENT_DEVICE_REMOVED:
+                HandleDeviceRemoved(libinput_event_get_device(event));
+                break;
+            case LIBINPUT_EVENT_NONE:
+            // Superseded by the POINTER_SCROLL_* events, which
+            // libinput sends alongside it.
+            case LIBINPUT_EVENT_POINTER_AXIS:
             case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
             case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
             case LIBINPUT_EVENT_TABLET_TOOL_TIP:
@@ -85,12 +177,169 @@ auto LibInput::BackendLoop() -> void {
         }
 
         libinput_event_destroy(event);
-        libinput_dispatch(m_libinputHandle);
     }
 }
 
-auto LibInput::HandleKeyboardEvent(libinput_event_keyboard *event) -> void {
-    // Since we aren't multithreaded, it will be safe to pass by pointer.
-    // It only gets destroyed after this function finishes.
-    compositor::Events::Publish(Events::KeyboardKey, event);
+auto LibInput::HandleDeviceAdded(libinput_device *device) -> void {
+    if (!m_traceWriter.has_value()) {
+        return;
+    }
+
+    uint32_t capabilities{0};
+    for (libinput_device_capability capability : {LIBINPUT_DEVICE_CAP_KEYBOARD, LIBINPUT_DEVICE_CAP_POINTER, LIBINPUT_DEVICE_CAP_TOUCH,
+                                                  LIBINPUT_DEVICE_CAP_TABLET_TOOL, LIBINPUT_DEVICE_CAP_TABLET_PAD, LIBINPUT_DEVICE_CAP_GESTURE,
+                                                  LIBINPUT_DEVICE_CAP_SWITCH}) {
+        if (libinput_device_has_capability(device, capability)) {
+            capabilities |= 1u << capability;
+        }
+    }
+
+    uint16_t traceDevice = m_nextTraceDevice++;
+    m_traceDevices[device] = traceDevice;
+    m_traceWriter->WriteDevice(traceDevice, libinput_device_get_name(device), libinput_device_get_id_vendor(device), libinput_device_get_id_product(device), capabilities);
+}
+
+auto LibInput::HandleDeviceRemoved(libinput_device *device) -> void {
+    m_traceDevices.erase(device);
+}
+
+template <LibInput::Events Event>
+auto LibInput::PostEvent(libinput_event *event, compositor::EventPayload_t<Event> eventData, const std::stop_token &stopToken) -> void {
+    static_assert(std::is_trivially_copyable_v<compositor::EventPayload_t<Event>>, "Recorded event payloads must be plain data.");
+
+    if (m_traceWriter.has_value()) {
+        auto traceDevice = m_traceDevices.find(libinput_event_get_device(event));
+        m_traceWriter->WriteEvent(eventData.TimeUsec,
+                                  traceDevice != m_traceDevices.end() ? traceDevice->second : UINT16_MAX,
+                                  static_cast<uint16_t>(Event),
+                                  std::as_bytes(std::span(&eventData, 1)));
+    }
+
+    if constexpr (IsDroppable(Event)) {
+        // Only the first drop is logged, a stalled display thread would
+        // otherwise flood the log.
+        if (!compositor::Events::Post<Event>(eventData) && m_droppedEvents.fetch_add(1, std::memory_order_relaxed) == 0) {
+            std::cerr << __PRETTY_FUNCTION__ << ": "
+                      << "Event queue is full, dropping motion events."
+                      << std::endl;
+        }
+        return;
+    }
+
+    // Losing a release or a touch frame would leave clients with keys,
+    // buttons or touch points stuck, wait for the display thread to make
+    // room instead. libinput and the kernel keep buffering meanwhile.
+    std::chrono::microseconds backoff{s_minPostBackoff};
+    while (!compositor::Events::Post<Event>(eventData)) {
+        if (stopToken.stop_requested()) {
+            return;
+        }
+
+        std::this_thread::sleep_for(backoff);
+        backoff = std::min(backoff * 2, s_maxPostBackoff);
+    }
+}
+
+auto LibInput::HandleKeyboardEvent(libinput_event_keyboard *event, const std::stop_token &stopToken) -> void {
+    // Only plain data crosses over to the display thread, the
+    // libinput event gets destroyed right after this.
+    PostEvent<Events::KeyboardKey>(libinput_event_keyboard_get_base_event(event), {
+        .TimeUsec = libinput_event_keyboard_get_time_usec(event),
+        .Key = libinput_event_keyboard_get_key(event),
+        .KeyState = libinput_event_keyboard_get_key_state(event)
+    }, stopToken);
+}
+
+auto LibInput::HandlePointerMotionEvent(libinput_event_pointer *event, const std::stop_token &stopToken) -> void {
+    // High rate event, motion posted between two dispatches
+    // gets merged into one.
+    PostEvent<Events::PointerMotion>(libinput_event_pointer_get_base_event(event), {
+        .TimeUsec = libinput_event_pointer_get_time_usec(event),
+        .Dx = libinput_event_pointer_get_dx(event),
+        .Dy = libinput_event_pointer_get_dy(event),
+        .DxUnaccelerated = libinput_event_pointer_get_dx_unaccelerated(event),
+        .DyUnaccelerated = libinput_event_pointer_get_dy_unaccelerated(event)
+    }, stopToken);
+}
+
+auto LibInput::HandlePointerMotionAbsoluteEvent(libinput_event_pointer *event, const std::stop_token &stopToken) -> void {
+    PostEvent<Events::PointerMotionAbsolute>(libinput_event_pointer_get_base_event(event), {
+        .TimeUsec = libinput_event_pointer_get_time_usec(event),
+        .X = libinput_event_pointer_get_absolute_x_transformed(event, 1),
+        .Y = libinput_event_pointer_get_absolute_y_transformed(event, 1)
+    }, stopToken);
+}
+
+auto LibInput::HandlePointerButtonEvent(libinput_event_pointer *event, const std::stop_token &stopToken) -> void {
+    PostEvent<Events::PointerButton>(libinput_event_pointer_get_base_event(event), {
+        .TimeUsec = libinput_event_pointer_get_time_usec(event),
+        .Button = libinput_event_pointer_get_button(event),
+        .ButtonState = libinput_event_pointer_get_button_state(event)
+    }, stopToken);
+}
+
+auto LibInput::HandlePointerScrollEvent(libinput_event_type type, libinput_event_pointer *event, const std::stop_token &stopToken) -> void {
+    PointerScroll_EventData eventData{
+        .TimeUsec = libinput_event_pointer_get_time_usec(event),
+        .Source = type == LIBINPUT_EVENT_POINTER_SCROLL_WHEEL ? LIBINPUT_POINTER_AXIS_SOURCE_WHEEL :
+                  type == LIBINPUT_EVENT_POINTER_SCROLL_FINGER ? LIBINPUT_POINTER_AXIS_SOURCE_FINGER :
+                                                                 LIBINPUT_POINTER_AXIS_SOURCE_CONTINUOUS,
+        .HasVertical = libinput_event_pointer_has_axis(event, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL) != 0,
+        .HasHorizontal = libinput_event_pointer_has_axis(event, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL) != 0
+    };
+
+    // Values of axes that aren't set are undefined
+    if (eventData.HasVertical) {
+        eventData.Vertical = libinput_event_pointer_get_scroll_value(event, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+        if (type == LIBINPUT_EVENT_POINTER_SCROLL_WHEEL) {
+            eventData.VerticalV120 = libinput_event_pointer_get_scroll_value_v120(event, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+        }
+    }
+
+    if (eventData.HasHorizontal) {
+        eventData.Horizontal = libinput_event_pointer_get_scroll_value(event, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+        if (type == LIBINPUT_EVENT_POINTER_SCROLL_WHEEL) {
+            eventData.HorizontalV120 = libinput_event_pointer_get_scroll_value_v120(event, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+        }
+    }
+
+    PostEvent<Events::PointerScroll>(libinput_event_pointer_get_base_event(event), eventData, stopToken);
+}
+
+auto LibInput::HandleTouchEvent(libinput_event_type type, libinput_event_touch *event, const std::stop_token &stopToken) -> void {
+    libinput_event *baseEvent = libinput_event_touch_get_base_event(event);
+    uint64_t timeUsec = libinput_event_touch_get_time_usec(event);
+
+    switch (type) {
+        case LIBINPUT_EVENT_TOUCH_DOWN:
+            PostEvent<Events::TouchDown>(baseEvent, {
+                .TimeUsec = timeUsec,
+                .Slot = libinput_event_touch_get_seat_slot(event),
+                .X = libinput_event_touch_get_x_transformed(event, 1),
+                .Y = libinput_event_touch_get_y_transformed(event, 1)
+            }, stopToken);
+            break;
+        case LIBINPUT_EVENT_TOUCH_MOTION:
+            PostEvent<Events::TouchMotion>(baseEvent, {
+                .TimeUsec = timeUsec,
+                .Slot = libinput_event_touch_get_seat_slot(event),
+                .X = libinput_event_touch_get_x_transformed(event, 1),
+                .Y = libinput_event_touch_get_y_transformed(event, 1)
+            }, stopToken);
+            break;
+        case LIBINPUT_EVENT_TOUCH_UP:
+            PostEvent<Events::TouchUp>(baseEvent, {
+                .TimeUsec = timeUsec,
+                .Slot = libinput_event_touch_get_seat_slot(event)
+            }, stopToken);
+            break;
+        case LIBINPUT_EVENT_TOUCH_CANCEL:
+            PostEvent<Events::TouchCancel>(baseEvent, {.TimeUsec = timeUsec}, stopToken);
+            break;
+        case LIBINPUT_EVENT_TOUCH_FRAME:
+            PostEvent<Events::TouchFrame>(baseEvent, {.TimeUsec = timeUsec}, stopToken);
+            break;
+        default:
+            break;
+    }
 }
@@ -0,0 +1,358 @@
+#include "Pointer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <system_error>
+
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Events.hpp"
+#include "wayland/Pointer.hpp"
+
+using namespace moco::backend;
+using namespace wayland::server;
+
+/* PointerState */
+
+auto PointerState::SetOutputLayout(std::vector<OutputRect> layout) -> void {
+    m_layout = std::move(layout);
+    ClampToLayout();
+}
+
+auto PointerState::Motion(uint64_t timeUsec, double dx, double dy, double dxUnaccelerated, double dyUnaccelerated) -> void {
+    m_x += ToFixed(dx, m_remainderX);
+    m_y += ToFixed(dy, m_remainderY);
+    ClampToLayout();
+
+    m_pending.TimeUsec = timeUsec;
+    m_pending.HasMotion = true;
+    m_pending.DxUnaccelerated += dxUnaccelerated;
+    m_pending.DyUnaccelerated += dyUnaccelerated;
+}
+
+auto PointerState::MotionAbsolute(uint64_t timeUsec, double x, double y) -> void {
+    // Absolute devices span the whole layout
+    if (m_layout.empty()) {
+        return;
+    }
+
+    int32_t left{std::numeric_limits<int32_t>::max()};
+    int32_t top{std::numeric_limits<int32_t>::max()};
+    int32_t right{std::numeric_limits<int32_t>::min()};
+    int32_t bottom{std::numeric_limits<int32_t>::min()};
+    for (const OutputRect &rect : m_layout) {
+        left = std::min(left, rect.X);
+        top = std::min(top, rect.Y);
+        right = std::max(right, rect.X + rect.Width);
+        bottom = std::max(bottom, rect.Y + rect.Height);
+    }
+
+    m_remainderX = 0;
+    m_remainderY = 0;
+    m_x = ToFixed(left + x * (right - left), m_remainderX);
+    m_y = ToFixed(top + y * (bottom - top), m_remainderY);
+    ClampToLayout();
+
+    m_pending.TimeUsec = timeUsec;
+    m_pending.HasMotion = true;
+}
+
+auto PointerState::Button(uint64_t timeUsec, uint32_t button, libinput_button_state state) -> void {
+    m_pending.TimeUsec = timeUsec;
+    m_pending.HasButton = true;
+    m_pending.Button = button;
+    m_pending.ButtonState = state;
+}
+
+auto PointerState::Scroll(const LibInput::PointerScroll_EventData &eventData) -> void {
+    m_pending.TimeUsec = eventData.TimeUsec;
+    m_pending.HasScroll = true;
+    m_pending.ScrollSource = eventData.Source;
+
+    auto accumulate = [&eventData](Axis &axis, double value, double value120) -> void {
+        axis.Active = true;
+
+        // Wheels have no notion of stopping
+        if (value == 0 && eventData.Source != LIBINPUT_POINTER_AXIS_SOURCE_WHEEL) {
+            axis.Stop = true;
+            return;
+        }
+
+        axis.Value += value;
+        axis.Value120 += static_cast<int32_t>(std::lround(value120));
+    };
+
+    if (eventData.HasVertical) {
+        accumulate(m_pending.Axes[LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL], eventData.Vertical, eventData.VerticalV120);
+    }
+
+    if (eventData.HasHorizontal) {
+        accumulate(m_pending.Axes[LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL], eventData.Horizontal, eventData.HorizontalV120);
+    }
+}
+
+auto PointerState::CanTakeScroll(const LibInput::PointerScroll_EventData &eventData) const -> bool {
+    if (!m_pending.HasScroll) {
+        return true;
+    }
+
+    if (m_pending.ScrollSource != eventData.Source) {
+        return false;
+    }
+
+    // A stop merged into pending scroll of the same axis would replace
+    // it, the scroll has to go out in a frame of its own first.
+    auto canMerge = [&eventData](const Axis &axis, double value) -> bool {
+        if (axis.Stop) {
+            return false;
+        }
+
+        bool isStop = value == 0 && eventData.Source != LIBINPUT_POINTER_AXIS_SOURCE_WHEEL;
+        return !isStop || (axis.Value == 0 && axis.Value120 == 0);
+    };
+
+    return (!eventData.HasVertical || canMerge(m_pending.Axes[LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL], eventData.Vertical)) &&
+           (!eventData.HasHorizontal || canMerge(m_pending.Axes[LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL], eventData.Horizontal));
+}
+
+auto PointerState::HasChanges() const -> bool {
+    return m_pending.HasMotion || m_pending.HasButton || m_pending.HasScroll;
+}
+
+auto PointerState::TakeFrame() -> Frame {
+    Frame frame = m_pending;
+    frame.X = GetX();
+    frame.Y = GetY();
+
+    m_pending = {};
+    return frame;
+}
+
+auto PointerState::GetX() const -> double {
+    return FromFixed(m_x);
+}
+
+auto PointerState::GetY() const -> double {
+    return FromFixed(m_y);
+}
+
+auto PointerState::ClampToLayout() -> void {
+    if (m_layout.empty()) {
+        return;
+    }
+
+    // Outside of every output, move to the closest point of the closest output
+    int64_t closestX{m_x};
+    int64_t closestY{m_y};
+    double closestDistance{std::numeric_limits<double>::infinity()};
+    for (const OutputRect &rect : m_layout) {
+        int64_t x = std::clamp<int64_t>(m_x, int64_t{rect.X} * s_fixedOne, int64_t{rect.X + rect.Width} * s_fixedOne - 1);
+        int64_t y = std::clamp<int64_t>(m_y, int64_t{rect.Y} * s_fixedOne, int64_t{rect.Y + rect.Height} * s_fixedOne - 1);
+        if (x == m_x && y == m_y) {
+            return;
+        }
+
+        double distance = std::hypot(static_cast<double>(x - m_x), static_cast<double>(y - m_y));
+        if (distance < closestDistance) {
+            closestDistance = distance;
+            closestX = x;
+            closestY = y;
+        }
+    }
+
+    m_x = closestX;
+    m_y = closestY;
+
+    // Pushing against an edge doesn't build up motion
+    m_remainderX = 0;
+    m_remainderY = 0;
+}
+
+auto PointerState::ToFixed(double value, double &remainder) -> int64_t {
+    double scaled = value * s_fixedOne + remainder;
+    int64_t fixed = std::llround(scaled);
+    remainder = scaled - static_cast<double>(fixed);
+    return fixed;
+}
+
+auto PointerState::FromFixed(int64_t value) -> double {
+    return static_cast<double>(value) / s_fixedOne;
+}
+
+/* Pointer */
+
+Pointer::Pointer(Private, display_t display) :
+    BackendBase(Private()),
+    m_display(display),
+    m_timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK))
+{
+    if (m_timerFd == -1) {
+        throw std::system_error(std::error_code(errno, std::system_category()));
+    }
+
+    LibInput::Initialize(display);
+
+    m_timerSource = display.get_event_loop().add_fd(m_timerFd, fd_event_mask_t::readable, [this](int fd, uint32_t mask) -> int {
+        uint64_t expirations;
+        [[maybe_unused]] ssize_t bytesRead = read(fd, &expirations, sizeof(expirations));
+        BackendLoop();
+        return 0;
+    });
+
+    m_motionEvent = compositor::Events::Subscribe<LibInput::Events::PointerMotion>([this](const LibInput::PointerMotion_EventData &eventData) -> void {EventMotion(eventData);});
+    m_motionAbsoluteEvent = compositor::Events::Subscribe<LibInput::Events::PointerMotionAbsolute>([this](const LibInput::PointerMotionAbsolute_EventData &eventData) -> void {EventMotionAbsolute(eventData);});
+    m_buttonEvent = compositor::Events::Subscribe<LibInput::Events::PointerButton>([this](const LibInput::PointerButton_EventData &eventData) -> void {EventButton(eventData);});
+    m_scrollEvent = compositor::Events::Subscribe<LibInput::Events::PointerScroll>([this](const LibInput::PointerScroll_EventData &eventData) -> void {EventScroll(eventData);});
+}
+
+Pointer::~Pointer() {
+    m_timerSource->remove();
+    close(m_timerFd);
+}
+
+auto Pointer::SetOutputLayout(std::vector<PointerState::OutputRect> layout) -> void {
+    m_pointerState.SetOutputLayout(std::move(layout));
+}
+
+auto Pointer::SetFrameInterval(uint64_t frameIntervalUsec) -> void {
+    m_frameIntervalUsec = frameIntervalUsec;
+}
+
+auto Pointer::SetSurfaceOrigin(SurfaceOrigin_t surfaceOrigin) -> void {
+    m_surfaceOrigin = std::move(surfaceOrigin);
+}
+
+auto Pointer::Flush() -> void {
+    if (!m_pointerState.HasChanges()) {
+        return;
+    }
+
+    m_lastFlushUsec = GetMonotonicTimeUsec();
+
+    // The compositor goes first, it may move the focus
+    Frame_EventData frame = m_pointerState.TakeFrame();
+    compositor::Events::Publish<Events::Frame>(frame);
+    PublishClientFrame(frame);
+}
+
+// Runs when the frame interval timer fires
+auto Pointer::BackendLoop() -> void {
+    m_timerArmed = false;
+    Flush();
+}
+
+auto Pointer::EventMotion(const LibInput::PointerMotion_EventData &eventData) -> void {
+    m_pointerState.Motion(eventData.TimeUsec, eventData.Dx, eventData.Dy, eventData.DxUnaccelerated, eventData.DyUnaccelerated);
+    ScheduleFlush();
+}
+
+auto Pointer::EventMotionAbsolute(const LibInput::PointerMotionAbsolute_EventData &eventData) -> void {
+    m_pointerState.MotionAbsolute(eventData.TimeUsec, eventData.X, eventData.Y);
+    ScheduleFlush();
+}
+
+auto Pointer::EventButton(const LibInput::PointerButton_EventData &eventData) -> void {
+    // Pending motion goes out in the same frame, so the
+    // button lands where the pointer is.
+    m_pointerState.Button(eventData.TimeUsec, eventData.Button, eventData.ButtonState);
+    Flush();
+}
+
+auto Pointer::EventScroll(const LibInput::PointerScroll_EventData &eventData) -> void {
+    if (!m_pointerState.CanTakeScroll(eventData)) {
+        Flush();
+    }
+
+    m_pointerState.Scroll(eventData);
+    ScheduleFlush();
+}
+
+auto Pointer::ScheduleFlush() -> void {
+    if (m_timerArmed) {
+        return;
+    }
+
+    uint64_t deadline = m_lastFlushUsec + m_frameIntervalUsec;
+    if (GetMonotonicTimeUsec() >= deadline) {
+        Flush();
+        return;
+    }
+
+    ArmTimer(deadline);
+}
+
+auto Pointer::ArmTimer(uint64_t deadlineUsec) -> void {
+    itimerspec timerSpec{
+        .it_interval = {},
+        .it_value = {
+            .tv_sec = static_cast<time_t>(deadlineUsec / 1'000'000),
+            .tv_nsec = static_cast<long>(deadlineUsec % 1'000'000 * 1'000)
+        }
+    };
+
+    if (timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &timerSpec, nullptr) == -1) {
+        std::error_code err = std::error_code(errno, std::system_category());
+        std::cerr << __PRETTY_FUNCTION__ << ": " << err.message() << std::endl;
+        return;
+    }
+
+    m_timerArmed = true;
+}
+
+auto Pointer::ToClientFrame(const Frame_EventData &frame, int32_t originX, int32_t originY) -> wayland::implementation::Pointer::Frame_EventData {
+    wayland::implementation::Pointer::Frame_EventData clientFrame{
+        .Time = static_cast<uint32_t>(frame.TimeUsec / 1'000),
+        .HasMotion = frame.HasMotion,
+        .X = frame.X - originX,
+        .Y = frame.Y - originY,
+        .HasButton = frame.HasButton,
+        .Button = frame.Button,
+        .ButtonState = frame.ButtonState == LIBINPUT_BUTTON_STATE_PRESSED ? pointer_button_state::pressed : pointer_button_state::released,
+        .HasAxis = frame.HasScroll,
+        .AxisSource = GetAxisSource(frame.ScrollSource)
+    };
+
+    // libinput and wl_pointer number their axes the same
+    for (size_t i = 0; i < frame.Axes.size(); i++) {
+        clientFrame.Axes[i] = {
+            .Active = frame.Axes[i].Active,
+            .Stop = frame.Axes[i].Stop,
+            .Value = frame.Axes[i].Value,
+            .Value120 = frame.Axes[i].Value120
+        };
+    }
+
+    return clientFrame;
+}
+
+auto Pointer::PublishClientFrame(const Frame_EventData &frame) -> void {
+    auto [originX, originY] = m_surfaceOrigin ? m_surfaceOrigin() : std::pair<int32_t, int32_t>{0, 0};
+
+    wayland::implementation::Pointer::Frame_EventData clientFrame = ToClientFrame(frame, originX, originY);
+    // Only buttons take a serial
+    if (frame.HasButton) {
+        clientFrame.Serial = m_display.next_serial();
+    }
+
+    compositor::Events::Publish<wayland::implementation::Pointer::Events::Frame>(clientFrame);
+}
+
+auto Pointer::GetAxisSource(libinput_pointer_axis_source source) -> pointer_axis_source {
+    switch (source) {
+        case LIBINPUT_POINTER_AXIS_SOURCE_WHEEL:
+            return pointer_axis_source::wheel;
+        case LIBINPUT_POINTER_AXIS_SOURCE_FINGER:
+            return pointer_axis_source::finger;
+        case LIBINPUT_POINTER_AXIS_SOURCE_CONTINUOUS:
+            return pointer_axis_source::continuous;
+        case LIBINPUT_POINTER_AXIS_SOURCE_WHEEL_TILT:
+            return pointer_axis_source::wheel_tilt;
+    }
+
+    return pointer_axis_source::wheel;
+}
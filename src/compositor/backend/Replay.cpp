@@ -0,0 +1,147 @@
+#include "Replay.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <system_error>
+
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Events.hpp"
+
+using namespace moco::backend;
+using namespace wayland::server;
+
+Replay::Replay(Private, display_t display, std::filesystem::path tracePath, double speed) :
+    BackendBase(Private()),
+    m_reader(tracePath),
+    m_speed(speed),
+    m_timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK))
+{
+    if (m_timerFd == -1) {
+        throw std::system_error(std::error_code(errno, std::system_category()));
+    }
+
+    m_timerSource = display.get_event_loop().add_fd(m_timerFd, fd_event_mask_t::readable, [this](int fd, uint32_t mask) -> int {
+        uint64_t expirations;
+        [[maybe_unused]] ssize_t bytesRead = read(fd, &expirations, sizeof(expirations));
+        BackendLoop();
+        return 0;
+    });
+
+    m_nextRecord = m_reader.Next();
+    m_replayStartUsec = GetMonotonicTimeUsec();
+    ArmTimer(m_replayStartUsec);
+}
+
+Replay::~Replay() {
+    m_timerSource->remove();
+    close(m_timerFd);
+}
+
+auto Replay::IsFinished() const -> bool {
+    return !m_nextRecord.has_value();
+}
+
+auto Replay::BackendLoop() -> void {
+    uint64_t now = GetMonotonicTimeUsec();
+
+    while (m_nextRecord.has_value()) {
+        const InputTrace::Record &record = m_nextRecord.value();
+
+        if (record.Header.Kind == InputTrace::RecordKind::Event) {
+            // The first event anchors the trace's clock to ours
+            if (m_traceStartUsec == 0) {
+                m_traceStartUsec = record.Header.TimeUsec;
+            }
+
+            uint64_t replayTime = GetReplayTimeUsec(record.Header.TimeUsec);
+            if (m_speed > 0 && replayTime > now) {
+                ArmTimer(replayTime);
+                return;
+            }
+
+            // Ring is full, retry once the display thread drained it
+            if (!ReplayRecord(record, replayTime)) {
+                ArmTimer(now);
+                return;
+            }
+        }
+
+        m_nextRecord = m_reader.Next();
+    }
+}
+
+auto Replay::ArmTimer(uint64_t deadlineUsec) -> void {
+    // An all zero it_value disarms the timer
+    deadlineUsec = std::max<uint64_t>(deadlineUsec, 1);
+
+    itimerspec timerSpec{
+        .it_interval = {},
+        .it_value = {
+            .tv_sec = static_cast<time_t>(deadlineUsec / 1'000'000),
+            .tv_nsec = static_cast<long>(deadlineUsec % 1'000'000 * 1'000)
+        }
+    };
+
+    if (timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &timerSpec, nullptr) == -1) {
+        std::error_code err = std::error_code(errno, std::system_category());
+        std::cerr << __PRETTY_FUNCTION__ << ": " << err.message() << std::endl;
+    }
+}
+
+auto Replay::GetReplayTimeUsec(uint64_t traceTimeUsec) const -> uint64_t {
+    uint64_t elapsed = traceTimeUsec - m_traceStartUsec;
+    if (m_speed > 0) {
+        elapsed = static_cast<uint64_t>(static_cast<double>(elapsed) / m_speed);
+    }
+
+    return m_replayStartUsec + elapsed;
+}
+
+auto Replay::ReplayRecord(const InputTrace::Record &record, uint64_t timeUsec) -> bool {
+    switch (static_cast<LibInput::Events>(record.Header.Type)) {
+        case LibInput::Events::KeyboardKey:
+            return ReplayEvent<LibInput::Events::KeyboardKey>(record.Payload, timeUsec);
+        case LibInput::Events::PointerMotion:
+            return ReplayEvent<LibInput::Events::PointerMotion>(record.Payload, timeUsec);
+        case LibInput::Events::TouchDown:
+            return ReplayEvent<LibInput::Events::TouchDown>(record.Payload, timeUsec);
+        case LibInput::Events::TouchMotion:
+            return ReplayEvent<LibInput::Events::TouchMotion>(record.Payload, timeUsec);
+        case LibInput::Events::TouchUp:
+            return ReplayEvent<LibInput::Events::TouchUp>(record.Payload, timeUsec);
+        case LibInput::Events::TouchCancel:
+            return ReplayEvent<LibInput::Events::TouchCancel>(record.Payload, timeUsec);
+        case LibInput::Events::TouchFrame:
+            return ReplayEvent<LibInput::Events::TouchFrame>(record.Payload, timeUsec);
+        case LibInput::Events::PointerMotionAbsolute:
+            return ReplayEvent<LibInput::Events::PointerMotionAbsolute>(record.Payload, timeUsec);
+        case LibInput::Events::PointerButton:
+            return ReplayEvent<LibInput::Events::PointerButton>(record.Payload, timeUsec);
+        case LibInput::Events::PointerScroll:
+            return ReplayEvent<LibInput::Events::PointerScroll>(record.Payload, timeUsec);
+    }
+
+    std::cerr << __PRETTY_FUNCTION__ << ": "
+              << "Unknown event type " << record.Header.Type << " in input trace, skipping."
+              << std::endl;
+    return true;
+}
+
+template <LibInput::Events Event>
+auto Replay::ReplayEvent(std::span<const std::byte> payload, uint64_t timeUsec) -> bool {
+    compositor::EventPayload_t<Event> eventData;
+    if (payload.size() != sizeof(eventData)) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << "Event payload size mismatch in input trace, skipping."
+                  << std::endl;
+        return true;
+    }
+
+    std::memcpy(&eventData, payload.data(), sizeof(eventData));
+    eventData.TimeUsec = timeUsec;
+    return compositor::Events::Post<Event>(eventData);
+}
@@ -0,0 +1,292 @@
+#include "Touch.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <utility>
+
+#include "Events.hpp"
+#include "wayland/Touch.hpp"
+
+using namespace moco::backend;
+using namespace moco::compositor;
+using namespace wayland::server;
+
+/* TouchState */
+
+auto TouchState::IsValidSlot(int32_t slot) -> bool {
+    if (slot < 0 || static_cast<size_t>(slot) >= s_maxSlots) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << "Touch slot " << slot << " is out of range, ignoring."
+                  << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+auto TouchState::Down(int32_t slot, uint64_t timeUsec, double x, double y) -> void {
+    if (!IsValidSlot(slot)) {
+        return;
+    }
+
+    m_x[slot] = m_previousX[slot] = x;
+    m_y[slot] = m_previousY[slot] = y;
+    m_timeUsec[slot] = m_previousTimeUsec[slot] = timeUsec;
+
+    m_activeMask |= 1u << slot;
+    m_downMask |= 1u << slot;
+}
+
+auto TouchState::Motion(int32_t slot, uint64_t timeUsec, double x, double y) -> void {
+    if (!IsValidSlot(slot) || !(m_activeMask & (1u << slot))) {
+        return;
+    }
+
+    // Coalesced motion can arrive more than once per timestamp,
+    // only a newer sample moves the history along.
+    if (timeUsec != m_timeUsec[slot]) {
+        m_previousX[slot] = m_x[slot];
+        m_previousY[slot] = m_y[slot];
+        m_previousTimeUsec[slot] = m_timeUsec[slot];
+    }
+
+    m_x[slot] = x;
+    m_y[slot] = y;
+    m_timeUsec[slot] = timeUsec;
+
+    m_motionMask |= 1u << slot;
+}
+
+auto TouchState::Up(int32_t slot, uint64_t timeUsec) -> void {
+    if (!IsValidSlot(slot) || !(m_activeMask & (1u << slot))) {
+        return;
+    }
+
+    m_timeUsec[slot] = timeUsec;
+    m_activeMask &= ~(1u << slot);
+    m_upMask |= 1u << slot;
+}
+
+auto TouchState::Cancel() -> void {
+    m_activeMask = 0;
+    m_downMask = 0;
+    m_motionMask = 0;
+    m_upMask = 0;
+}
+
+auto TouchState::HasChanges() const -> bool {
+    return (m_downMask | m_motionMask | m_upMask) != 0;
+}
+
+auto TouchState::TakeFrame(uint64_t timeUsec, std::optional<uint64_t> deadlineUsec) -> Frame {
+    Frame frame{
+        .TimeUsec = timeUsec,
+        .ActiveMask = m_activeMask,
+        .DownMask = m_downMask,
+        // Lifted slots don't report their motion
+        .MotionMask = m_motionMask & ~m_downMask & ~m_upMask,
+        .UpMask = m_upMask,
+        .X = m_x,
+        .Y = m_y
+    };
+
+    if (deadlineUsec.has_value()) {
+        for (uint32_t moving = frame.MotionMask; moving != 0; moving &= moving - 1) {
+            size_t slot = std::countr_zero(moving);
+            Resample(slot, deadlineUsec.value(), frame.X[slot], frame.Y[slot]);
+        }
+    }
+
+    m_downMask = 0;
+    m_motionMask = 0;
+    m_upMask = 0;
+
+    return frame;
+}
+
+auto TouchState::SetMaxPrediction(uint64_t maxPredictionUsec) -> void {
+    m_maxPredictionUsec = maxPredictionUsec;
+}
+
+auto TouchState::Resample(size_t slot, uint64_t deadlineUsec, double &x, double &y) const -> void {
+    if (m_timeUsec[slot] <= m_previousTimeUsec[slot]) {
+        return;
+    }
+
+    double interval = static_cast<double>(m_timeUsec[slot] - m_previousTimeUsec[slot]);
+
+    // Negative offsets interpolate between the two samples, positive
+    // ones predict past the latest one.
+    double offset = static_cast<double>(deadlineUsec) - static_cast<double>(m_timeUsec[slot]);
+    offset = std::clamp(offset, -interval, static_cast<double>(m_maxPredictionUsec));
+
+    double factor = offset / interval;
+    x = std::clamp(m_x[slot] + (m_x[slot] - m_previousX[slot]) * factor, 0.0, 1.0);
+    y = std::clamp(m_y[slot] + (m_y[slot] - m_previousY[slot]) * factor, 0.0, 1.0);
+}
+
+/* TouchClientState */
+
+auto TouchClientState::SetOutput(const OutputRect &output) -> void {
+    m_output = output;
+}
+
+auto TouchClientState::SetSurfaceOrigin(SurfaceOrigin_t surfaceOrigin) -> void {
+    m_surfaceOrigin = std::move(surfaceOrigin);
+}
+
+auto TouchClientState::TakeFrame(const TouchState::Frame &frame) -> std::optional<ClientFrame_t> {
+    // A claimed sequence ends once every finger is lifted
+    if (m_claimed) {
+        m_claimed = frame.ActiveMask != 0;
+        return std::nullopt;
+    }
+
+    ClientFrame_t clientFrame{
+        .Time = static_cast<uint32_t>(frame.TimeUsec / 1'000)
+    };
+
+    auto addPoint = [&](size_t slot, wayland::implementation::Touch::PointState state) -> void {
+        auto [originX, originY] = m_slotOrigins[slot];
+        clientFrame.Points[clientFrame.PointCount++] = {
+            .Id = static_cast<int32_t>(slot),
+            .State = state,
+            .X = m_output.X + frame.X[slot] * m_output.Width - originX,
+            .Y = m_output.Y + frame.Y[slot] * m_output.Height - originY
+        };
+    };
+
+    for (uint32_t changed = frame.DownMask | frame.MotionMask | frame.UpMask; changed != 0; changed &= changed - 1) {
+        size_t slot = std::countr_zero(changed);
+        uint32_t bit = 1u << slot;
+
+        if (frame.DownMask & bit) {
+            m_slotOrigins[slot] = m_surfaceOrigin ? m_surfaceOrigin() : std::pair<int32_t, int32_t>{0, 0};
+            m_clientMask |= bit;
+            addPoint(slot, wayland::implementation::Touch::PointState::Down);
+        } else if ((frame.MotionMask & bit) && (m_clientMask & bit)) {
+            addPoint(slot, wayland::implementation::Touch::PointState::Motion);
+        }
+
+        // A slot may go down and up within a single frame
+        if ((frame.UpMask & bit) && (m_clientMask & bit)) {
+            m_clientMask &= ~bit;
+            addPoint(slot, wayland::implementation::Touch::PointState::Up);
+        }
+    }
+
+    if (clientFrame.PointCount == 0) {
+        return std::nullopt;
+    }
+
+    return clientFrame;
+}
+
+auto TouchClientState::Claim() -> bool {
+    if (m_claimed) {
+        return false;
+    }
+
+    m_claimed = true;
+    return std::exchange(m_clientMask, 0) != 0;
+}
+
+auto TouchClientState::Cancel() -> bool {
+    m_claimed = false;
+    return std::exchange(m_clientMask, 0) != 0;
+}
+
+auto TouchClientState::IsClaimed() const -> bool {
+    return m_claimed;
+}
+
+/* Touch */
+
+Touch::Touch(Private, display_t display) :
+    BackendBase(Private()),
+    m_display(display)
+{
+    LibInput::Initialize(display);
+
+    m_touchDownEvent = compositor::Events::Subscribe<LibInput::Events::TouchDown>([this](const LibInput::TouchDown_EventData &eventData) -> void {
+        m_touchState.Down(eventData.Slot, eventData.TimeUsec, eventData.X, eventData.Y);
+    });
+    m_touchMotionEvent = compositor::Events::Subscribe<LibInput::Events::TouchMotion>([this](const LibInput::TouchMotion_EventData &eventData) -> void {
+        m_touchState.Motion(eventData.Slot, eventData.TimeUsec, eventData.X, eventData.Y);
+    });
+    m_touchUpEvent = compositor::Events::Subscribe<LibInput::Events::TouchUp>([this](const LibInput::TouchUp_EventData &eventData) -> void {
+        m_touchState.Up(eventData.Slot, eventData.TimeUsec);
+    });
+    m_touchCancelEvent = compositor::Events::Subscribe<LibInput::Events::TouchCancel>([this](const LibInput::TouchCancel_EventData &eventData) -> void {EventTouchCancel(eventData);});
+    m_touchFrameEvent = compositor::Events::Subscribe<LibInput::Events::TouchFrame>([this](const LibInput::TouchFrame_EventData &eventData) -> void {EventTouchFrame(eventData);});
+}
+
+auto Touch::SetResampling(bool resampling) -> void {
+    m_resampling = resampling;
+}
+
+auto Touch::SetOutput(const OutputRect &output) -> void {
+    m_clientState.SetOutput(output);
+}
+
+auto Touch::SetSurfaceOrigin(SurfaceOrigin_t surfaceOrigin) -> void {
+    m_clientState.SetSurfaceOrigin(std::move(surfaceOrigin));
+}
+
+auto Touch::Claim() -> void {
+    if (m_clientState.Claim()) {
+        compositor::Events::Publish<wayland::implementation::Touch::Events::Cancel>({});
+    }
+}
+
+auto Touch::Flush(uint64_t deadlineUsec) -> void {
+    if (!m_resampling || !m_touchState.HasChanges()) {
+        return;
+    }
+
+    PublishFrame(m_touchState.TakeFrame(m_lastFrameTimeUsec, deadlineUsec));
+}
+
+auto Touch::BackendLoop() -> void {
+
+}
+
+auto Touch::EventTouchFrame(const LibInput::TouchFrame_EventData &eventData) -> void {
+    m_lastFrameTimeUsec = eventData.TimeUsec;
+
+    // Resampled frames wait for the output's frame deadline
+    if (m_resampling || !m_touchState.HasChanges()) {
+        return;
+    }
+
+    PublishFrame(m_touchState.TakeFrame(eventData.TimeUsec));
+}
+
+auto Touch::EventTouchCancel(const LibInput::TouchCancel_EventData &eventData) -> void {
+    m_touchState.Cancel();
+    compositor::Events::Publish<Events::Cancel>({.TimeUsec = eventData.TimeUsec});
+
+    if (m_clientState.Cancel()) {
+        compositor::Events::Publish<wayland::implementation::Touch::Events::Cancel>({});
+    }
+}
+
+auto Touch::PublishFrame(const Frame_EventData &frame) -> void {
+    // The compositor goes first, it may move the focus
+    compositor::Events::Publish<Events::Frame>(frame);
+    PublishClientFrame(frame);
+}
+
+auto Touch::PublishClientFrame(const Frame_EventData &frame) -> void {
+    std::optional<TouchClientState::ClientFrame_t> clientFrame = m_clientState.TakeFrame(frame);
+    if (!clientFrame) {
+        return;
+    }
+
+    if ((frame.DownMask | frame.UpMask) != 0) {
+        clientFrame->Serial = m_display.next_serial();
+    }
+
+    compositor::Events::Publish<wayland::implementation::Touch::Events::Frame>(*clientFrame);
+}
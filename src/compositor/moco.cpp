@@ -1,5 +1,7 @@
 #include "moco.hpp"
 
+#include "Events.hpp"
+
 using namespace moco::compositor;
 using namespace wayland::server;
 
@@ -10,8 +12,22 @@ Compositor::Compositor() :
 {
     // Connect to socket named `wayland-1` just for testing purposes
     m_socket = m_display.add_socket("wayland-1");
+
+    // Queued events are drained once per event loop iteration
+    Events::SetDispatchScheduler([this]() -> void {
+        m_display.get_event_loop().add_idle([]() -> void {Events::Dispatch();});
+    });
+
+    // Events posted by other threads (e.g. input backends) wake the
+    // display thread up through an eventfd.
+    m_postedEventsSource = m_display.get_event_loop().add_fd(Events::GetWakeupFd(), fd_event_mask_t::readable, [](int fd, uint32_t mask) -> int {
+        Events::DispatchPosted();
+        return 0;
+    });
 }
 
 Compositor::~Compositor() {
+    Events::SetDispatchScheduler(nullptr);
+    m_postedEventsSource->remove();
     m_display.terminate();
 }
@@ -0,0 +1,136 @@
+#include "Buffer.hpp"
+
+#include "SharedMemory.hpp"
+#include "SharedMemoryPool.hpp"
+
+#include <algorithm>
+
+using namespace moco::wayland::implementation;
+using namespace wayland::server;
+
+Buffer::HoldStatistics Buffer::s_holdStatistics;
+
+Buffer::Buffer(buffer_t buffer, PixelFormats::Format format) :
+    ObjectImplementationBase(buffer),
+    m_format(format)
+{
+    on_destroy() = [this]() -> void {HandleDestroy();};
+}
+
+auto Buffer::GetBytes() const -> std::span<uint8_t> {
+    if (m_parentPool == nullptr) {
+        return {};
+    }
+
+    return m_parentPool->GetData().subspan(m_offset, m_size);
+}
+
+auto Buffer::BeginAccess() -> void {
+    if (m_parentPool != nullptr) {
+        m_parentPool->BeginAccess();
+    }
+}
+
+auto Buffer::EndAccess() -> bool {
+    if (m_parentPool == nullptr || m_parentPool->EndAccess()) {
+        return true;
+    }
+
+    PostError(SharedMemory::Error::InvalidFd, "Error accessing the buffer's memory, the pool's file shrank.");
+    return false;
+}
+
+auto Buffer::Attach() -> void {
+    m_state = State::Attached;
+}
+
+auto Buffer::Commit() -> void {
+    if (m_state != State::Attached) {
+        return;
+    }
+
+    m_state = State::Committed;
+    m_releasePending = false;
+
+    // Committing again without a release in between keeps the first time
+    if (!m_held) {
+        m_held = true;
+        m_heldSince = std::chrono::steady_clock::now();
+        s_holdStatistics.Held++;
+    }
+}
+
+auto Buffer::MarkCopied() -> void {
+    if (m_state == State::Committed) {
+        m_state = State::Copied;
+    }
+}
+
+auto Buffer::BeginRender() -> void {
+    m_renderUses++;
+    m_state = State::InUse;
+}
+
+auto Buffer::EndRender() -> void {
+    if (m_renderUses == 0 || --m_renderUses > 0) {
+        return;
+    }
+
+    m_state = State::Committed;
+    if (m_releasePending) {
+        Release();
+    }
+}
+
+auto Buffer::Release() -> void {
+    if (!m_held) {
+        return;
+    }
+
+    if (m_renderUses > 0) {
+        m_releasePending = true;
+        return;
+    }
+
+    if (!m_destroyed) {
+        release();
+    }
+
+    RecordHoldTime();
+    m_state = State::Released;
+    m_releasePending = false;
+}
+
+auto Buffer::AddStateReference() -> void {
+    m_stateReferences++;
+}
+
+auto Buffer::RemoveStateReference() -> void {
+    if (m_stateReferences > 0 && --m_stateReferences == 0) {
+        Release();
+    }
+}
+
+auto Buffer::GetHoldStatistics() -> const HoldStatistics& {
+    return s_holdStatistics;
+}
+
+auto Buffer::HandleDestroy() -> void {
+    m_destroyed = true;
+
+    // Destroyed while held, it was held up to now
+    if (m_held) {
+        RecordHoldTime();
+    }
+}
+
+auto Buffer::RecordHoldTime() -> void {
+    std::chrono::nanoseconds holdTime = std::chrono::steady_clock::now() - m_heldSince;
+
+    s_holdStatistics.Releases++;
+    s_holdStatistics.TotalHoldTime += holdTime;
+    s_holdStatistics.MaxHoldTime = std::max(s_holdStatistics.MaxHoldTime, holdTime);
+    s_holdStatistics.Held--;
+
+    m_held = false;
+}
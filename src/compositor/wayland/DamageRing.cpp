@@ -0,0 +1,75 @@
+#include "DamageRing.hpp"
+
+#include <algorithm>
+#include <utility>
+
+using namespace moco::wayland::implementation;
+
+DamageRing::DamageRing(int width, int height) :
+    m_width(width),
+    m_height(height)
+{
+    for (pixman_region32_t &frame : m_frames) {
+        pixman_region32_init(&frame);
+    }
+
+    pixman_region32_init(&m_pending);
+    AddFullDamage();
+}
+
+DamageRing::~DamageRing() {
+    for (pixman_region32_t &frame : m_frames) {
+        pixman_region32_fini(&frame);
+    }
+
+    pixman_region32_fini(&m_pending);
+}
+
+auto DamageRing::Resize(int width, int height) -> void {
+    m_width = width;
+    m_height = height;
+
+    m_frameCount = 0;
+    AddFullDamage();
+}
+
+auto DamageRing::AddDamage(const pixman_region32_t &damage) -> void {
+    pixman_region32_union(&m_pending, &m_pending, &damage);
+    pixman_region32_intersect_rect(&m_pending, &m_pending, 0, 0, m_width, m_height);
+}
+
+auto DamageRing::AddDamage(int x, int y, uint32_t width, uint32_t height) -> void {
+    pixman_region32_union_rect(&m_pending, &m_pending, x, y, width, height);
+    pixman_region32_intersect_rect(&m_pending, &m_pending, 0, 0, m_width, m_height);
+}
+
+auto DamageRing::AddFullDamage() -> void {
+    pixman_region32_fini(&m_pending);
+    pixman_region32_init_rect(&m_pending, 0, 0, m_width, m_height);
+}
+
+auto DamageRing::GetRepaintRegion(uint32_t bufferAge, pixman_region32_t &region) const -> void {
+    // Age 1 holds the newest recorded frame, so frames up to `age - 1`
+    // back are needed
+    if (bufferAge == 0 || bufferAge - 1 > m_frameCount) {
+        pixman_region32_fini(&region);
+        pixman_region32_init_rect(&region, 0, 0, m_width, m_height);
+        return;
+    }
+
+    pixman_region32_copy(&region, &m_pending);
+    for (size_t i = 0; i < bufferAge - 1; i++) {
+        const pixman_region32_t &frame = m_frames[(m_newest + s_capacity - i) % s_capacity];
+        pixman_region32_union(&region, &region, &frame);
+    }
+}
+
+auto DamageRing::Rotate() -> void {
+    // The oldest frame's region takes the pending damage, and its old
+    // rectangles are cleared as the new pending damage
+    m_newest = (m_newest + 1) % s_capacity;
+    std::swap(m_frames[m_newest], m_pending);
+    pixman_region32_clear(&m_pending);
+
+    m_frameCount = std::min(m_frameCount + 1, s_capacity);
+}
@@ -0,0 +1,316 @@
+#include "FormatRegistry.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MOCO_FORMAT_KERNELS_X86 1
+#endif
+
+using namespace moco::wayland::implementation::PixelFormats;
+using namespace wayland::server;
+
+namespace moco::wayland::implementation::PixelFormats::Kernels {
+    /* Scalar, also converting what's left of a row after the vector loops */
+
+    inline auto Load32(const uint8_t *source) -> uint32_t {
+        uint32_t pixel;
+        std::memcpy(&pixel, source, sizeof(pixel));
+        return pixel;
+    }
+
+    template <bool Swap, bool Opaque>
+    inline auto Convert8888(uint32_t pixel) -> uint32_t {
+        if constexpr (Swap) {
+            pixel = (pixel & 0xff00ff00) | ((pixel >> 16) & 0xff) | ((pixel & 0xff) << 16);
+        }
+
+        return Opaque ? pixel | 0xff000000 : pixel;
+    }
+
+    // Keeps the 8 most significant bits of every 10 bit channel
+    template <bool Swap, bool Opaque>
+    inline auto Convert2101010(uint32_t pixel) -> uint32_t {
+        uint32_t first = (pixel >> 22) & 0xff;
+        uint32_t green = (pixel >> 12) & 0xff;
+        uint32_t last = (pixel >> 2) & 0xff;
+
+        uint32_t alpha = 0xff;
+        if constexpr (!Opaque) {
+            // 0b11 -> 0xff
+            alpha = (pixel >> 30) * 0x55;
+        }
+
+        return Swap ? (alpha << 24) | (last << 16) | (green << 8) | first
+                    : (alpha << 24) | (first << 16) | (green << 8) | last;
+    }
+
+    inline auto ConvertRgb565(uint16_t pixel) -> uint32_t {
+        uint32_t red = pixel >> 11;
+        uint32_t green = (pixel >> 5) & 0x3f;
+        uint32_t blue = pixel & 0x1f;
+
+        // Replicating the high bits maps full intensity to 0xff
+        return 0xff000000
+             | (((red << 3) | (red >> 2)) << 16)
+             | (((green << 2) | (green >> 4)) << 8)
+             | ((blue << 3) | (blue >> 2));
+    }
+
+    template <uint32_t (*Convert)(uint32_t)>
+    auto ScalarRow32(const uint8_t *source, uint32_t *destination, size_t width) -> void {
+        for (size_t i = 0; i < width; i++) {
+            destination[i] = Convert(Load32(source + i * 4));
+        }
+    }
+
+    auto ScalarRowRgb565(const uint8_t *source, uint32_t *destination, size_t width) -> void {
+        for (size_t i = 0; i < width; i++) {
+            uint16_t pixel;
+            std::memcpy(&pixel, source + i * 2, sizeof(pixel));
+            destination[i] = ConvertRgb565(pixel);
+        }
+    }
+
+    // Already canonical
+    auto CopyRow(const uint8_t *source, uint32_t *destination, size_t width) -> void {
+        std::memcpy(destination, source, width * 4);
+    }
+
+#ifdef MOCO_FORMAT_KERNELS_X86
+    /* SSE2, 4 pixels at a time */
+
+    template <bool Swap, bool Opaque>
+    __attribute__((target("sse2")))
+    auto Sse2Row8888(const uint8_t *source, uint32_t *destination, size_t width) -> void {
+        const __m128i alpha = _mm_set1_epi32(Opaque ? static_cast<int>(0xff000000) : 0);
+        const __m128i alphaGreenMask = _mm_set1_epi32(static_cast<int>(0xff00ff00));
+        const __m128i redBlueMask = _mm_set1_epi32(0x00ff00ff);
+
+        size_t i = 0;
+        for (; i + 4 <= width; i += 4) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+            if constexpr (Swap) {
+                __m128i redBlue = _mm_and_si128(pixels, redBlueMask);
+                redBlue = _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16));
+                pixels = _mm_or_si128(_mm_and_si128(pixels, alphaGreenMask), _mm_and_si128(redBlue, redBlueMask));
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_or_si128(pixels, alpha));
+        }
+
+        ScalarRow32<Convert8888<Swap, Opaque>>(source + i * 4, destination + i, width - i);
+    }
+
+    template <bool Swap, bool Opaque>
+    __attribute__((target("sse2")))
+    auto Sse2Row2101010(const uint8_t *source, uint32_t *destination, size_t width) -> void {
+        const __m128i channelMask = _mm_set1_epi32(0xff);
+
+        size_t i = 0;
+        for (; i + 4 <= width; i += 4) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+            __m128i first = _mm_and_si128(_mm_srli_epi32(pixels, 22), channelMask);
+            __m128i green = _mm_and_si128(_mm_srli_epi32(pixels, 12), channelMask);
+            __m128i last = _mm_and_si128(_mm_srli_epi32(pixels, 2), channelMask);
+
+            __m128i alpha;
+            if constexpr (Opaque) {
+                alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+            } else {
+                __m128i alpha2 = _mm_srli_epi32(pixels, 30);
+                alpha2 = _mm_or_si128(alpha2, _mm_slli_epi32(alpha2, 2));
+                alpha = _mm_slli_epi32(_mm_or_si128(alpha2, _mm_slli_epi32(alpha2, 4)), 24);
+            }
+
+            __m128i red = Swap ? last : first;
+            __m128i blue = Swap ? first : last;
+            __m128i result = _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(red, 16)), _mm_or_si128(_mm_slli_epi32(green, 8), blue));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), result);
+        }
+
+        ScalarRow32<Convert2101010<Swap, Opaque>>(source + i * 4, destination + i, width - i);
+    }
+
+    __attribute__((target("sse2")))
+    inline auto Sse2Expand565(__m128i pixels, __m128i &low, __m128i &high) -> void {
+        __m128i red = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(pixels, 8), _mm_set1_epi16(0xf8)), _mm_srli_epi16(pixels, 13));
+        __m128i green = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(pixels, 3), _mm_set1_epi16(0xfc)), _mm_and_si128(_mm_srli_epi16(pixels, 9), _mm_set1_epi16(0x03)));
+        __m128i blue = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(pixels, 3), _mm_set1_epi16(0xf8)), _mm_and_si128(_mm_srli_epi16(pixels, 2), _mm_set1_epi16(0x07)));
+
+        // 16 bit halves of the result, interleaved into whole pixels
+        __m128i greenBlue = _mm_or_si128(_mm_slli_epi16(green, 8), blue);
+        __m128i alphaRed = _mm_or_si128(red, _mm_set1_epi16(static_cast<short>(0xff00)));
+        low = _mm_unpacklo_epi16(greenBlue, alphaRed);
+        high = _mm_unpackhi_epi16(greenBlue, alphaRed);
+    }
+
+    __attribute__((target("sse2")))
+    auto Sse2RowRgb565(const uint8_t *source, uint32_t *destination, size_t width) -> void {
+        size_t i = 0;
+        for (; i + 8 <= width; i += 8) {
+            __m128i low, high;
+            Sse2Expand565(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2)), low, high);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), low);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 4), high);
+        }
+
+        ScalarRowRgb565(source + i * 2, destination + i, width - i);
+    }
+
+    /* AVX2, 8 pixels at a time */
+
+    template <bool Swap, bool Opaque>
+    __attribute__((target("avx2")))
+    auto Avx2Row8888(const uint8_t *source, uint32_t *destination, size_t width) -> void {
+        const __m256i alpha = _mm256_set1_epi32(Opaque ? static_cast<int>(0xff000000) : 0);
+        // Swaps bytes 0 and 2 of every pixel, per 128 bit lane
+        const __m256i swapRedBlue = _mm256_setr_epi8(
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+        size_t i = 0;
+        for (; i + 8 <= width; i += 8) {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+            if constexpr (Swap) {
+                pixels = _mm256_shuffle_epi8(pixels, swapRedBlue);
+            }
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_or_si256(pixels, alpha));
+        }
+
+        Sse2Row8888<Swap, Opaque>(source + i * 4, destination + i, width - i);
+    }
+
+    template <bool Swap, bool Opaque>
+    __attribute__((target("avx2")))
+    auto Avx2Row2101010(const uint8_t *source, uint32_t *destination, size_t width) -> void {
+        const __m256i channelMask = _mm256_set1_epi32(0xff);
+
+        size_t i = 0;
+        for (; i + 8 <= width; i += 8) {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+            __m256i first = _mm256_and_si256(_mm256_srli_epi32(pixels, 22), channelMask);
+            __m256i green = _mm256_and_si256(_mm256_srli_epi32(pixels, 12), channelMask);
+            __m256i last = _mm256_and_si256(_mm256_srli_epi32(pixels, 2), channelMask);
+
+            __m256i alpha;
+            if constexpr (Opaque) {
+                alpha = _mm256_set1_epi32(static_cast<int>(0xff000000));
+            } else {
+                alpha = _mm256_slli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(pixels, 30), _mm256_set1_epi32(0x55)), 24);
+            }
+
+            __m256i red = Swap ? last : first;
+            __m256i blue = Swap ? first : last;
+            __m256i result = _mm256_or_si256(_mm256_or_si256(alpha, _mm256_slli_epi32(red, 16)), _mm256_or_si256(_mm256_slli_epi32(green, 8), blue));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), result);
+        }
+
+        Sse2Row2101010<Swap, Opaque>(source + i * 4, destination + i, width - i);
+    }
+
+    __attribute__((target("avx2")))
+    auto Avx2RowRgb565(const uint8_t *source, uint32_t *destination, size_t width) -> void {
+        size_t i = 0;
+        for (; i + 16 <= width; i += 16) {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 2));
+
+            __m256i red = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(pixels, 8), _mm256_set1_epi16(0xf8)), _mm256_srli_epi16(pixels, 13));
+            __m256i green = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(pixels, 3), _mm256_set1_epi16(0xfc)), _mm256_and_si256(_mm256_srli_epi16(pixels, 9), _mm256_set1_epi16(0x03)));
+            __m256i blue = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi16(pixels, 3), _mm256_set1_epi16(0xf8)), _mm256_and_si256(_mm256_srli_epi16(pixels, 2), _mm256_set1_epi16(0x07)));
+
+            __m256i greenBlue = _mm256_or_si256(_mm256_slli_epi16(green, 8), blue);
+            __m256i alphaRed = _mm256_or_si256(red, _mm256_set1_epi16(static_cast<short>(0xff00)));
+
+            // Unpacking works per 128 bit lane, pixels 0-3 and 8-11 end up in `low`
+            __m256i low = _mm256_unpacklo_epi16(greenBlue, alphaRed);
+            __m256i high = _mm256_unpackhi_epi16(greenBlue, alphaRed);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_permute2x128_si256(low, high, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i + 8), _mm256_permute2x128_si256(low, high, 0x31));
+        }
+
+        Sse2RowRgb565(source + i * 2, destination + i, width - i);
+    }
+#endif
+}  // namespace moco::wayland::implementation::PixelFormats::Kernels
+
+auto FormatRegistry::Get(shm_format format) -> const FormatInfo* {
+    const Registry &registry = GetRegistry();
+    auto info = std::find_if(registry.Formats.begin(), registry.Formats.end(), [format](const FormatInfo &info) -> bool {return info.ShmFormat == format;});
+
+    return info == registry.Formats.end() ? nullptr : &*info;
+}
+
+auto FormatRegistry::GetSupportedFormats() -> std::span<const shm_format> {
+    return GetRegistry().ShmFormats;
+}
+
+auto FormatRegistry::GetKernelSet() -> std::string_view {
+    return GetRegistry().KernelSet;
+}
+
+auto FormatRegistry::GetRegistry() -> const Registry& {
+    static const Registry registry = CreateRegistry();
+    return registry;
+}
+
+auto FormatRegistry::GetRowConverters(std::string_view kernelSet) -> std::array<RowConverter_t, s_formatCount> {
+    using namespace Kernels;
+
+    // Same order as `CreateRegistry`, argb8888 is always a plain copy
+    if (kernelSet == "scalar") {
+        return {
+            CopyRow, ScalarRow32<Convert8888<false, true>>, ScalarRow32<Convert8888<true, false>>, ScalarRow32<Convert8888<true, true>>, ScalarRowRgb565,
+            ScalarRow32<Convert2101010<false, false>>, ScalarRow32<Convert2101010<false, true>>, ScalarRow32<Convert2101010<true, false>>, ScalarRow32<Convert2101010<true, true>>
+        };
+    }
+
+#ifdef MOCO_FORMAT_KERNELS_X86
+    __builtin_cpu_init();
+
+    if (kernelSet == "avx2" && __builtin_cpu_supports("avx2")) {
+        return {
+            CopyRow, Avx2Row8888<false, true>, Avx2Row8888<true, false>, Avx2Row8888<true, true>, Avx2RowRgb565,
+            Avx2Row2101010<false, false>, Avx2Row2101010<false, true>, Avx2Row2101010<true, false>, Avx2Row2101010<true, true>
+        };
+    }
+
+    if (kernelSet == "sse2" && __builtin_cpu_supports("sse2")) {
+        return {
+            CopyRow, Sse2Row8888<false, true>, Sse2Row8888<true, false>, Sse2Row8888<true, true>, Sse2RowRgb565,
+            Sse2Row2101010<false, false>, Sse2Row2101010<false, true>, Sse2Row2101010<true, false>, Sse2Row2101010<true, true>
+        };
+    }
+#endif
+
+    return {};
+}
+
+auto FormatRegistry::CreateRegistry() -> Registry {
+    std::array<shm_format, s_formatCount> shmFormats = {
+        shm_format::argb8888, shm_format::xrgb8888, shm_format::abgr8888, shm_format::xbgr8888, shm_format::rgb565,
+        shm_format::argb2101010, shm_format::xrgb2101010, shm_format::abgr2101010, shm_format::xbgr2101010
+    };
+    std::array<uint32_t, s_formatCount> bytesPerPixel = {4, 4, 4, 4, 2, 4, 4, 4, 4};
+    std::array<bool, s_formatCount> hasAlpha = {true, false, true, false, false, true, false, true, false};
+
+    Registry registry{};
+
+    // Best instruction set first, scalar always works
+    for (std::string_view kernelSet : s_kernelSets) {
+        std::array<RowConverter_t, s_formatCount> converters = GetRowConverters(kernelSet);
+        if (converters[0] != nullptr) {
+            for (size_t i = 0; i < s_formatCount; i++) {
+                registry.Formats[i] = {shmFormats[i], bytesPerPixel[i], hasAlpha[i], converters[i]};
+            }
+            registry.KernelSet = kernelSet;
+            break;
+        }
+    }
+
+    registry.ShmFormats = shmFormats;
+
+    return registry;
+}
@@ -0,0 +1,302 @@
+#include "KeymapCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace moco::wayland::implementation;
+
+KeymapCache::Keymap::Keymap(xkb_keymap *keymap, int fd, size_t size) :
+    m_keymap(keymap),
+    m_fd(fd),
+    m_size(size) {}
+
+KeymapCache::Keymap::~Keymap() {
+    xkb_keymap_unref(m_keymap);
+    close(m_fd);
+}
+
+auto KeymapCache::Keymap::GetKeymap() const -> xkb_keymap* {
+    return m_keymap;
+}
+
+auto KeymapCache::Keymap::GetFd() const -> int {
+    return m_fd;
+}
+
+auto KeymapCache::Keymap::GetSize() const -> size_t {
+    return m_size;
+}
+
+auto KeymapCache::Keymap::OpenReadOnly() const -> int {
+    return KeymapCache::OpenReadOnly(m_fd);
+}
+
+auto KeymapCache::Get(const xkb_rule_names &ruleNames) -> Keymap_t {
+    std::string key = GetKey(ruleNames);
+
+    std::shared_ptr<const Entries_t> entries = s_entries.load();
+    if (auto entry = entries->find(key); entry != entries->end()) {
+        return entry->second;
+    }
+
+    Keymap_t keymap = Compile(key, ruleNames);
+    if (keymap == nullptr) {
+        return nullptr;
+    }
+
+    // Another thread may have swapped the map meanwhile, retry on a fresh copy
+    std::shared_ptr<const Entries_t> updated;
+    do {
+        if (auto entry = entries->find(key); entry != entries->end()) {
+            return entry->second;
+        }
+
+        auto copy = std::make_shared<Entries_t>(*entries);
+        copy->emplace(key, keymap);
+        updated = std::move(copy);
+    } while (!s_entries.compare_exchange_weak(entries, updated));
+
+    return keymap;
+}
+
+auto KeymapCache::GetDefault() -> Keymap_t {
+    xkb_rule_names ruleNames = {
+        .rules = getenv("XKB_DEFAULT_RULES") ?: "evdev",
+        .model = getenv("XKB_DEFAULT_MODEL") ?: "",
+        .layout = getenv("XKB_DEFAULT_LAYOUT") ?: "us",
+        .variant = getenv("XKB_DEFAULT_VARIANT") ?: "",
+        .options = getenv("XKB_DEFAULT_OPTIONS") ?: ""
+    };
+
+    return Get(ruleNames);
+}
+
+auto KeymapCache::Invalidate() -> void {
+    s_entries.store(std::make_shared<const Entries_t>());
+}
+
+auto KeymapCache::Compile(const std::string &key, const xkb_rule_names &ruleNames) -> Keymap_t {
+    xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    if (context == nullptr) {
+        return nullptr;
+    }
+
+    std::filesystem::path filePath = GetFilePath(key);
+    if (!filePath.empty()) {
+        if (Keymap_t keymap = ReadFile(filePath, key, context); keymap != nullptr) {
+            xkb_context_unref(context);
+            return keymap;
+        }
+    }
+
+    // The keymap keeps its own reference on the context
+    xkb_keymap *keymap = xkb_keymap_new_from_names(context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    xkb_context_unref(context);
+    if (keymap == nullptr) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << "Failed to compile the xkb keymap."
+                  << std::endl;
+        return nullptr;
+    }
+
+    char *keymapString = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+    std::string_view text(keymapString, std::strlen(keymapString) + 1);
+
+    if (!filePath.empty()) {
+        WriteFile(filePath, key, text);
+    }
+
+    Keymap_t cached = CreateKeymap(keymap, text);
+    free(keymapString);
+
+    return cached;
+}
+
+auto KeymapCache::CreateKeymap(xkb_keymap *keymap, std::string_view text) -> Keymap_t {
+    int fd = memfd_create("moco::xkb_keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << "Failed to create the keymap memfd: " << std::strerror(errno)
+                  << std::endl;
+        xkb_keymap_unref(keymap);
+        return nullptr;
+    }
+
+    // Clients share the fd, none of them may change what the others read
+    if (!WriteAll(fd, text) || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << "Failed to fill the keymap memfd: " << std::strerror(errno)
+                  << std::endl;
+        close(fd);
+        xkb_keymap_unref(keymap);
+        return nullptr;
+    }
+
+    // Writing left the offset at the end, clients reading the shared fd
+    // instead of mmapping it would see an empty keymap
+    if (lseek(fd, 0, SEEK_SET) < 0) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << "Failed to rewind the keymap memfd: " << std::strerror(errno)
+                  << std::endl;
+        close(fd);
+        xkb_keymap_unref(keymap);
+        return nullptr;
+    }
+
+    return std::make_shared<const Keymap>(keymap, fd, text.size());
+}
+
+auto KeymapCache::OpenReadOnly(int fd) -> int {
+    int readOnlyFd = open(std::format("/proc/self/fd/{}", fd).c_str(), O_RDONLY | O_CLOEXEC);
+    if (readOnlyFd < 0) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << "Failed to reopen fd " << fd << ": " << std::strerror(errno)
+                  << std::endl;
+    }
+
+    return readOnlyFd;
+}
+
+auto KeymapCache::GetKey(const xkb_rule_names &ruleNames) -> std::string {
+    std::string key;
+    for (const char *name : {ruleNames.rules, ruleNames.model, ruleNames.layout, ruleNames.variant, ruleNames.options}) {
+        // Null separated, names never contain one
+        key.append(name ?: "");
+        key.push_back('\0');
+    }
+
+    return key;
+}
+
+auto KeymapCache::GetFilePath(const std::string &key) -> std::filesystem::path {
+    std::filesystem::path directory;
+    if (const char *cacheHome = getenv("XDG_CACHE_HOME"); cacheHome != nullptr && cacheHome[0] == '/') {
+        directory = cacheHome;
+    } else if (const char *home = getenv("HOME"); home != nullptr && home[0] == '/') {
+        directory = std::filesystem::path(home) / ".cache";
+    } else {
+        return {};
+    }
+
+    // FNV-1a, file names have to be stable across runs
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : key) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+    }
+
+    return directory / "moco" / "keymaps" / std::format("{:016x}.xkb", hash);
+}
+
+auto KeymapCache::ReadFile(const std::filesystem::path &path, const std::string &key, xkb_context *context) -> Keymap_t {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) < 0 || static_cast<size_t>(fileStat.st_size) < sizeof(FileHeader)) {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t fileSize = fileStat.st_size;
+    void *mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+
+    const char *data = static_cast<const char*>(mapping);
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    // Anything unexpected, including a file from another libxkbcommon, is a miss
+    bool valid = header.Magic == s_fileMagic
+        && header.Version == s_fileVersion
+        && header.XkbcommonVersion == GetXkbcommonVersion()
+        && header.KeymapSize > 0
+        && header.KeymapSize <= fileSize
+        && sizeof(header) + header.KeyLength + header.KeymapSize == fileSize
+        && std::string_view(data + sizeof(header), header.KeyLength) == key;
+
+    const char *keymapText = valid ? data + sizeof(header) + header.KeyLength : nullptr;
+
+    Keymap_t keymap;
+    if (valid && keymapText[header.KeymapSize - 1] == '\0') {
+        if (xkb_keymap *parsed = xkb_keymap_new_from_buffer(context, keymapText, header.KeymapSize - 1, XKB_KEYMAP_FORMAT_TEXT_V1, XKB_KEYMAP_COMPILE_NO_FLAGS)) {
+            keymap = CreateKeymap(parsed, std::string_view(keymapText, header.KeymapSize));
+        }
+    }
+
+    munmap(mapping, fileSize);
+    return keymap;
+}
+
+auto KeymapCache::WriteFile(const std::filesystem::path &path, const std::string &key, std::string_view text) -> void {
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    if (error) {
+        return;
+    }
+
+    FileHeader header{
+        .KeyLength = static_cast<uint32_t>(key.size()),
+        .KeymapSize = text.size(),
+        .XkbcommonVersion = GetXkbcommonVersion()
+    };
+
+    // Written aside and renamed, so readers never see a partial file
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += std::format(".{}.tmp", getpid());
+
+    int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+
+    bool written = WriteAll(fd, std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)))
+        && WriteAll(fd, key)
+        && WriteAll(fd, text);
+    close(fd);
+
+    if (!written || rename(temporaryPath.c_str(), path.c_str()) < 0) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << "Failed to write the keymap cache " << path << "."
+                  << std::endl;
+        unlink(temporaryPath.c_str());
+    }
+}
+
+auto KeymapCache::WriteAll(int fd, std::string_view data) -> bool {
+    while (!data.empty()) {
+        ssize_t result = write(fd, data.data(), data.size());
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (result <= 0) {
+            return false;
+        }
+
+        data.remove_prefix(result);
+    }
+
+    return true;
+}
+
+auto KeymapCache::GetXkbcommonVersion() -> std::array<char, 32> {
+    std::array<char, 32> version{};
+    std::string_view name = MOCO_XKBCOMMON_VERSION;
+    std::copy_n(name.begin(), std::min(name.size(), version.size() - 1), version.begin());
+
+    return version;
+}
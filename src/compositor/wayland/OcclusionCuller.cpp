@@ -0,0 +1,67 @@
+#include "OcclusionCuller.hpp"
+
+using namespace moco::wayland::implementation;
+
+OcclusionCuller::OcclusionCuller() {
+    pixman_region32_init(&m_opaque);
+}
+
+OcclusionCuller::~OcclusionCuller() {
+    ResizeVisibleDamage(0);
+    pixman_region32_fini(&m_opaque);
+}
+
+auto OcclusionCuller::Cull(std::span<const Entry> stack, const pixman_region32_t &damage) -> void {
+    ResizeVisibleDamage(stack.size());
+    pixman_region32_clear(&m_opaque);
+    m_culledCount = 0;
+
+    pixman_region32_t remaining;
+    pixman_region32_init(&remaining);
+    pixman_region32_copy(&remaining, &damage);
+
+    for (size_t i = 0; i < stack.size(); i++) {
+        pixman_region32_t &visible = m_visibleDamage[i];
+        const Entry &entry = stack[i];
+
+        // Everything below is hidden, or nothing was damaged at all
+        if (!pixman_region32_not_empty(&remaining) || entry.EntrySurface == nullptr) {
+            m_culledCount++;
+            continue;
+        }
+
+        pixman_region32_intersect_rect(&visible, &remaining, entry.X, entry.Y, entry.EntrySurface->GetWidth(), entry.EntrySurface->GetHeight());
+        if (pixman_region32_not_empty(&visible)) {
+            entry.EntrySurface->Upload(visible, entry.X, entry.Y);
+        } else {
+            m_culledCount++;
+        }
+
+        // Damage behind this surface's opaque area is gone for the ones below
+        pixman_region32_clear(&m_opaque);
+        entry.EntrySurface->AddOpaqueRegion(m_opaque, entry.X, entry.Y);
+        pixman_region32_subtract(&remaining, &remaining, &m_opaque);
+    }
+
+    pixman_region32_fini(&remaining);
+}
+
+auto OcclusionCuller::GetVisibleDamage(size_t index) const -> const pixman_region32_t& {
+    return m_visibleDamage.at(index);
+}
+
+auto OcclusionCuller::GetCulledCount() const -> size_t {
+    return m_culledCount;
+}
+
+auto OcclusionCuller::ResizeVisibleDamage(size_t size) -> void {
+    // pixman regions may own memory, they can't be copied around as is
+    for (pixman_region32_t &region : m_visibleDamage) {
+        pixman_region32_fini(&region);
+    }
+
+    m_visibleDamage.resize(size);
+    for (pixman_region32_t &region : m_visibleDamage) {
+        pixman_region32_init(&region);
+    }
+}
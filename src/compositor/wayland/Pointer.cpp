@@ -0,0 +1,77 @@
+#include "Pointer.hpp"
+
+using namespace moco::wayland::implementation;
+using namespace wayland::server;
+
+Pointer::Pointer(pointer_t pointer, Private) :
+    Pointer(pointer) {}
+
+Pointer::Pointer(pointer_t pointer) :
+    ObjectImplementationBase(pointer)
+{
+    on_release() = [this]() -> void {HandleRelease();};
+}
+
+auto Pointer::SendEnter(uint32_t serial, const Surface &surface, double x, double y) -> void {
+    enter(serial, surface, x, y);
+
+    if (get_version() >= s_frameSinceVersion) {
+        frame();
+    }
+}
+
+auto Pointer::SendLeave(uint32_t serial, const Surface &surface) -> void {
+    leave(serial, surface);
+
+    if (get_version() >= s_frameSinceVersion) {
+        frame();
+    }
+}
+
+auto Pointer::SendFrame(const Frame_EventData &data) -> void {
+    if (data.HasMotion) {
+        motion(data.Time, data.X, data.Y);
+    }
+
+    if (data.HasButton) {
+        button(data.Serial, data.Time, data.Button, data.ButtonState);
+    }
+
+    if (data.HasAxis) {
+        if (get_version() >= s_frameSinceVersion) {
+            axis_source(data.AxisSource);
+        }
+
+        for (pointer_axis axisType : {pointer_axis::vertical_scroll, pointer_axis::horizontal_scroll}) {
+            const Axis &axisData = data.Axes[static_cast<size_t>(axisType)];
+            if (!axisData.Active) {
+                continue;
+            }
+
+            // A stop may come with the last scroll of the axis, which has
+            // to reach the client before the stop ends the sequence.
+            if (!axisData.Stop || axisData.Value != 0 || axisData.Value120 != 0) {
+                // High resolution clients get the exact sum of wheel
+                // movement, older ones derive it from the axis value.
+                if (axisData.Value120 != 0 && get_version() >= s_axisValue120SinceVersion) {
+                    axis_value120(axisType, axisData.Value120);
+                }
+
+                axis(data.Time, axisType, axisData.Value);
+            }
+
+            if (axisData.Stop && get_version() >= s_frameSinceVersion) {
+                axis_stop(data.Time, axisType);
+            }
+        }
+    }
+
+    // Clients before version 5 treat every event as its own frame
+    if (get_version() >= s_frameSinceVersion) {
+        frame();
+    }
+}
+
+auto Pointer::HandleRelease() -> void {
+
+}
@@ -20,6 +20,10 @@ Region::~Region() {
     pixman_region32_fini(&m_region);
 }
 
+auto Region::GetRegion() const -> const pixman_region32_t& {
+    return m_region;
+}
+
 auto Region::HandleDestory() -> void {
     /* Nothing to do (yet) */
 }
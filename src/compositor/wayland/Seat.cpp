@@ -1,13 +1,17 @@
 #include "Seat.hpp"
 
+#include <algorithm>
+#include <array>
+
 using namespace moco::wayland::implementation;
 using namespace wayland::server;
 
-Seat::Seat(seat_t seat, Private) :
-    Seat(seat) {}
+Seat::Seat(seat_t seat, GlobalSeat &globalSeat, Private) :
+    Seat(seat, globalSeat) {}
 
-Seat::Seat(seat_t seat) :
-    ObjectImplementationBase(seat)
+Seat::Seat(seat_t seat, GlobalSeat &globalSeat) :
+    ObjectImplementationBase(seat),
+    m_globalSeat(globalSeat)
 {
     on_get_pointer() = [this](pointer_t pointer) -> void {HandleGetPointer(pointer);};
     on_get_keyboard() = [this](keyboard_t keyboard) -> void {HandleGetKeyboard(keyboard);};
@@ -16,15 +20,15 @@ Seat::Seat(seat_t seat) :
 }
 
 auto Seat::HandleGetPointer(pointer_t pointer) -> void {
-
+    m_globalSeat.AddPointer(Pointer::Create(pointer));
 }
 
 auto Seat::HandleGetKeyboard(keyboard_t keyboard) -> void {
-
+    m_globalSeat.AddKeyboard(Keyboard::Create(keyboard));
 }
 
 auto Seat::HandleGetTouch(touch_t touch) -> void {
-
+    m_globalSeat.AddTouch(Touch::Create(touch));
 }
 
 auto Seat::HandleRelease() -> void {
@@ -32,11 +36,259 @@ auto Seat::HandleRelease() -> void {
 }
 
 GlobalSeat::GlobalSeat(display_t display) :
-    global_seat_t(display)
+    global_seat_t(display),
+    m_display(display)
 {
-    on_bind() = OnBind;
+    on_bind() = [this](client_t client, seat_t seat) -> void {HandleBind(client, seat);};
+
+    m_keyEvent = compositor::Events::Subscribe<Keyboard::Events::Key>([this](const Keyboard::Key_EventData &data) -> void {EventKey(data);});
+    m_keyEvent->SetLabel("wayland::implementation::GlobalSeat::EventKey");
+    m_modifierEvent = compositor::Events::Subscribe<Keyboard::Events::Modifier>([this](const Keyboard::Modifier_EventData &data) -> void {EventModifier(data);});
+    m_pointerFrameEvent = compositor::Events::Subscribe<Pointer::Events::Frame>([this](const Pointer::Frame_EventData &data) -> void {EventPointerFrame(data);});
+    m_touchFrameEvent = compositor::Events::Subscribe<Touch::Events::Frame>([this](const Touch::Frame_EventData &data) -> void {EventTouchFrame(data);});
+    m_touchCancelEvent = compositor::Events::Subscribe<Touch::Events::Cancel>([this](const Touch::Cancel_EventData &data) -> void {EventTouchCancel(data);});
+}
+
+auto GlobalSeat::SetKeyboardFocus(const std::shared_ptr<Surface> &surface) -> void {
+    std::shared_ptr<Surface> previous = m_keyboardFocus.FocusSurface.lock();
+    if (previous == surface) {
+        return;
+    }
+
+    if (previous != nullptr) {
+        if (ClientResources *resources = GetResources(m_keyboardFocus)) {
+            uint32_t serial = m_display.next_serial();
+            ForEach(resources->Keyboards, [&](Keyboard &keyboard) -> void {keyboard.SendLeave(serial, *previous);});
+        }
+    }
+
+    m_keyboardFocus = MakeFocus(surface);
+
+    if (ClientResources *resources = GetResources(m_keyboardFocus)) {
+        uint32_t serial = m_display.next_serial();
+        ForEach(resources->Keyboards, [&](Keyboard &keyboard) -> void {
+            keyboard.SendEnter(serial, *surface, m_pressedKeys);
+            // Clients must not assume the modifiers they had before leave
+            keyboard.SendModifiers(m_modifiers);
+        });
+    }
+}
+
+auto GlobalSeat::SetPointerFocus(const std::shared_ptr<Surface> &surface, double x, double y) -> void {
+    std::shared_ptr<Surface> previous = m_pointerFocus.FocusSurface.lock();
+    if (previous == surface) {
+        return;
+    }
+
+    if (previous != nullptr) {
+        if (ClientResources *resources = GetResources(m_pointerFocus)) {
+            uint32_t serial = m_display.next_serial();
+            ForEach(resources->Pointers, [&](Pointer &pointer) -> void {pointer.SendLeave(serial, *previous);});
+        }
+    }
+
+    m_pointerFocus = MakeFocus(surface);
+    m_pointerX = x;
+    m_pointerY = y;
+
+    if (ClientResources *resources = GetResources(m_pointerFocus)) {
+        uint32_t serial = m_display.next_serial();
+        ForEach(resources->Pointers, [&](Pointer &pointer) -> void {pointer.SendEnter(serial, *surface, x, y);});
+    }
+}
+
+auto GlobalSeat::SetTouchFocus(const std::shared_ptr<Surface> &surface) -> void {
+    m_touchFocus = MakeFocus(surface);
 }
 
-auto GlobalSeat::OnBind(client_t client, seat_t seat) -> void {
-    Seat::Create(seat);
+auto GlobalSeat::GetKeyboardFocus() const -> std::shared_ptr<Surface> {
+    return m_keyboardFocus.FocusSurface.lock();
+}
+
+auto GlobalSeat::GetPointerFocus() const -> std::shared_ptr<Surface> {
+    return m_pointerFocus.FocusSurface.lock();
+}
+
+auto GlobalSeat::GetTouchFocus() const -> std::shared_ptr<Surface> {
+    return m_touchFocus.FocusSurface.lock();
+}
+
+auto GlobalSeat::AddKeyboard(const std::shared_ptr<Keyboard> &keyboard) -> void {
+    m_clients[keyboard->get_client().c_ptr()].Keyboards.push_back(keyboard);
+
+    if (HasFocus(m_keyboardFocus, *keyboard)) {
+        keyboard->SendEnter(m_display.next_serial(), *m_keyboardFocus.FocusSurface.lock(), m_pressedKeys);
+        keyboard->SendModifiers(m_modifiers);
+    }
+}
+
+auto GlobalSeat::AddPointer(const std::shared_ptr<Pointer> &pointer) -> void {
+    m_clients[pointer->get_client().c_ptr()].Pointers.push_back(pointer);
+
+    if (HasFocus(m_pointerFocus, *pointer)) {
+        pointer->SendEnter(m_display.next_serial(), *m_pointerFocus.FocusSurface.lock(), m_pointerX, m_pointerY);
+    }
+}
+
+auto GlobalSeat::AddTouch(const std::shared_ptr<Touch> &touch) -> void {
+    m_clients[touch->get_client().c_ptr()].Touches.push_back(touch);
+}
+
+auto GlobalSeat::HandleBind(client_t client, seat_t seat) -> void {
+    // Drops clients whose resources are all gone, their
+    // `wl_client` address may be reused by a new client.
+    for (auto entry = m_clients.begin(); entry != m_clients.end();) {
+        ClientResources &resources = entry->second;
+        std::erase_if(resources.Keyboards, [](const auto &resource) -> bool {return resource.expired();});
+        std::erase_if(resources.Pointers, [](const auto &resource) -> bool {return resource.expired();});
+        std::erase_if(resources.Touches, [](const auto &resource) -> bool {return resource.expired();});
+
+        if (resources.Keyboards.empty() && resources.Pointers.empty() && resources.Touches.empty()) {
+            entry = m_clients.erase(entry);
+        } else {
+            entry++;
+        }
+    }
+
+    Seat::Create(seat, *this);
+}
+
+auto GlobalSeat::EventKey(const Keyboard::Key_EventData &data) -> void {
+    if (data.KeyState == keyboard_key_state::pressed) {
+        if (std::find(m_pressedKeys.begin(), m_pressedKeys.end(), data.Key) == m_pressedKeys.end()) {
+            m_pressedKeys.push_back(data.Key);
+        }
+    } else {
+        std::erase(m_pressedKeys, data.Key);
+    }
+
+    if (ClientResources *resources = GetResources(m_keyboardFocus)) {
+        ForEach(resources->Keyboards, [&](Keyboard &keyboard) -> void {keyboard.SendKey(data);});
+    }
+}
+
+auto GlobalSeat::EventModifier(const Keyboard::Modifier_EventData &data) -> void {
+    m_modifiers = data;
+
+    if (ClientResources *resources = GetResources(m_keyboardFocus)) {
+        ForEach(resources->Keyboards, [&](Keyboard &keyboard) -> void {keyboard.SendModifiers(data);});
+    }
+}
+
+auto GlobalSeat::EventPointerFrame(const Pointer::Frame_EventData &data) -> void {
+    if (data.HasMotion) {
+        m_pointerX = data.X;
+        m_pointerY = data.Y;
+    }
+
+    if (ClientResources *resources = GetResources(m_pointerFocus)) {
+        ForEach(resources->Pointers, [&](Pointer &pointer) -> void {pointer.SendFrame(data);});
+    }
+}
+
+auto GlobalSeat::EventTouchFrame(const Touch::Frame_EventData &data) -> void {
+    // Points of one frame may belong to several clients, each gets the
+    // points it owns in a frame of its own
+    struct ClientFrame {
+        wl_client *Client{nullptr};
+        Touch::Frame_EventData Frame;
+    };
+
+    std::array<ClientFrame, Touch::s_maxPoints> clientFrames;
+    size_t clientFrameCount{0};
+
+    for (size_t i = 0; i < data.PointCount; i++) {
+        const Touch::Point &point = data.Points[i];
+
+        if (point.State == Touch::PointState::Down) {
+            if (m_touchFocus.FocusSurface.expired()) {
+                continue;
+            }
+            m_touchPoints[point.Id] = m_touchFocus;
+        }
+
+        auto touchPoint = m_touchPoints.find(point.Id);
+        if (touchPoint == m_touchPoints.end()) {
+            continue;
+        }
+
+        wl_client *client = touchPoint->second.Client;
+        if (point.State == Touch::PointState::Up) {
+            m_touchPoints.erase(touchPoint);
+        }
+
+        auto clientFrame = std::find_if(clientFrames.begin(), clientFrames.begin() + clientFrameCount, [client](const ClientFrame &frame) -> bool {return frame.Client == client;});
+        if (clientFrame == clientFrames.begin() + clientFrameCount) {
+            clientFrame->Client = client;
+            clientFrame->Frame.Serial = data.Serial;
+            clientFrame->Frame.Time = data.Time;
+            clientFrameCount++;
+        }
+
+        clientFrame->Frame.Points[clientFrame->Frame.PointCount++] = point;
+    }
+
+    // Down events only ever go to the current focus
+    std::shared_ptr<Surface> downSurface = m_touchFocus.FocusSurface.lock();
+    for (size_t i = 0; i < clientFrameCount; i++) {
+        auto resources = m_clients.find(clientFrames[i].Client);
+        if (resources == m_clients.end()) {
+            continue;
+        }
+
+        const Surface *surface = clientFrames[i].Client == m_touchFocus.Client ? downSurface.get() : nullptr;
+        ForEach(resources->second.Touches, [&](Touch &touch) -> void {touch.SendFrame(clientFrames[i].Frame, surface);});
+    }
+}
+
+auto GlobalSeat::EventTouchCancel(const Touch::Cancel_EventData&) -> void {
+    // Every client holding points gets a single cancel
+    std::vector<wl_client*> clients;
+    for (const auto &[id, focus] : m_touchPoints) {
+        if (std::find(clients.begin(), clients.end(), focus.Client) == clients.end()) {
+            clients.push_back(focus.Client);
+        }
+    }
+    m_touchPoints.clear();
+
+    for (wl_client *client : clients) {
+        if (auto resources = m_clients.find(client); resources != m_clients.end()) {
+            ForEach(resources->second.Touches, [&](Touch &touch) -> void {touch.SendCancel();});
+        }
+    }
+}
+
+auto GlobalSeat::GetResources(const Focus &focus) -> ClientResources* {
+    if (focus.Client == nullptr || focus.FocusSurface.expired()) {
+        return nullptr;
+    }
+
+    auto entry = m_clients.find(focus.Client);
+    return entry == m_clients.end() ? nullptr : &entry->second;
+}
+
+template <typename Resource>
+auto GlobalSeat::HasFocus(const Focus &focus, const Resource &resource) -> bool {
+    return focus.Client != nullptr && !focus.FocusSurface.expired() && focus.Client == resource.get_client().c_ptr();
+}
+
+template <typename Resource, typename Function>
+auto GlobalSeat::ForEach(std::vector<std::weak_ptr<Resource>> &resources, Function &&function) -> void {
+    std::erase_if(resources, [&](const std::weak_ptr<Resource> &resource) -> bool {
+        std::shared_ptr<Resource> instance = resource.lock();
+        if (instance == nullptr) {
+            return true;
+        }
+
+        function(*instance);
+        return false;
+    });
+}
+
+auto GlobalSeat::MakeFocus(const std::shared_ptr<Surface> &surface) -> Focus {
+    if (surface == nullptr) {
+        return {};
+    }
+
+    return {.FocusSurface = surface, .Client = surface->get_client().c_ptr()};
 }
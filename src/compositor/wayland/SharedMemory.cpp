@@ -2,6 +2,7 @@
 
 #include <sys/mman.h>
 
+#include "FormatRegistry.hpp"
 #include "SharedMemoryPool.hpp"
 
 using namespace moco::wayland::implementation;
@@ -17,8 +18,8 @@ SharedMemory::SharedMemory(shm_t shm) :
     on_destroy() = [this]() -> void {HandleDestroy();};
 }
 
-auto SharedMemory::GetSupportedFormats() -> decltype(s_supportedFormats) {
-    return s_supportedFormats;
+auto SharedMemory::GetSupportedFormats() -> std::span<const shm_format> {
+    return PixelFormats::FormatRegistry::GetSupportedFormats();
 }
 
 auto SharedMemory::HandleCreatePool(shm_pool_t pool, int32_t fd, size_t size) -> void {
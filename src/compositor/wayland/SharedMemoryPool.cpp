@@ -1,6 +1,8 @@
 #include "SharedMemoryPool.hpp"
 #include "SharedMemory.hpp"
+#include "FormatRegistry.hpp"
 
+#include <cstdint>
 #include <format>
 #include <iostream>
 #include <algorithm>
@@ -39,11 +41,20 @@ auto SharedMemoryPool::HandleDestroy() -> void {
 }
 
 auto SharedMemoryPool::HandleCreateBuffer(buffer_t buffer, int offset, int width, int height, int stride, shm_format format) -> void {
-    if (std::find(SharedMemory::GetSupportedFormats().begin(), SharedMemory::GetSupportedFormats().end(), format) == SharedMemory::GetSupportedFormats().end()) {
+    const PixelFormats::FormatInfo *formatInfo = PixelFormats::FormatRegistry::Get(format);
+    if (formatInfo == nullptr) {
         PostError(SharedMemory::Error::InvalidFormat, "Invalid or unsupported format specified in buffer creation.");
+        return;
     }
 
-    Buffer::Create(buffer, format)->AssignData(memorySpace.subspan(offset, height * stride), shared_from_this())->SetBufferFormat(height, width, stride);
+    // Buffers outlive resizes, so they're only checked against the pool once
+    std::optional<size_t> size = GetBufferSize(offset, width, height, stride, formatInfo->BytesPerPixel, memorySpace.size());
+    if (!size.has_value()) {
+        PostError(SharedMemory::Error::InvalidStride, "Buffer doesn't fit in the pool.");
+        return;
+    }
+
+    Buffer::Create(buffer, format)->AssignData(offset, size.value(), shared_from_this())->SetBufferFormat(height, width, stride);
 }
 
 auto SharedMemoryPool::HandleResize(size_t newSize) -> void {
@@ -57,11 +68,9 @@ auto SharedMemoryPool::HandleResize(size_t newSize) -> void {
                 memorySpace.size()));
     }
 
-    // MREMAP_MAYMOVE -> Potentially move all data if there exists a mapping in the space
-    // where we would extend into.
-    // Using this would also cause us to need to update each buffer created with a new address
-    // which becomes annoying
-    void *addr = mremap(memorySpace.data(), memorySpace.size(), newSize, 0 /* MREMAP_MAYMOVE */);
+    // Buffers only keep their offset into the pool, so the mapping is free
+    // to move if the address range after it is taken.
+    void *addr = mremap(memorySpace.data(), memorySpace.size(), newSize, MREMAP_MAYMOVE);
     if (addr == MAP_FAILED) {
         throw std::system_error(std::error_code(errno, std::system_category()));
     }
@@ -71,6 +80,99 @@ auto SharedMemoryPool::HandleResize(size_t newSize) -> void {
 
 /* Implementation */
 
+auto SharedMemoryPool::GetBufferSize(int32_t offset, int32_t width, int32_t height, int32_t stride, size_t bytesPerPixel, size_t poolSize) -> std::optional<size_t> {
+    if (offset < 0 || width <= 0 || height <= 0 || stride <= 0) {
+        return std::nullopt;
+    }
+
+    uint64_t rowBytes{0};
+    uint64_t size{0};
+    uint64_t end{0};
+    if (__builtin_mul_overflow(static_cast<uint64_t>(width), static_cast<uint64_t>(bytesPerPixel), &rowBytes) ||
+        static_cast<uint64_t>(stride) < rowBytes ||
+        __builtin_mul_overflow(static_cast<uint64_t>(height), static_cast<uint64_t>(stride), &size) ||
+        __builtin_add_overflow(static_cast<uint64_t>(offset), size, &end) ||
+        end > poolSize) {
+        return std::nullopt;
+    }
+
+    return static_cast<size_t>(size);
+}
+
 auto SharedMemoryPool::Assign(std::span<uint8_t> data) -> void {
     memorySpace = data;
 }
+
+auto SharedMemoryPool::GetData() const -> std::span<uint8_t> {
+    return memorySpace;
+}
+
+auto SharedMemoryPool::BeginAccess() -> void {
+    std::call_once(s_sigbusHandlerInstalled, InstallSigbusHandler);
+
+    if (m_accessCount++ == 0) {
+        m_nextAccess = s_activeAccesses;
+        s_activeAccesses = this;
+    }
+}
+
+auto SharedMemoryPool::EndAccess() -> bool {
+    if (m_accessCount == 0) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << "EndAccess called without a matching BeginAccess."
+                  << std::endl;
+        return m_accessFaulted == 0;
+    }
+
+    if (--m_accessCount == 0) {
+        // Accesses of different pools may end in any order
+        for (SharedMemoryPool **access = &s_activeAccesses; *access != nullptr; access = &(*access)->m_nextAccess) {
+            if (*access == this) {
+                *access = m_nextAccess;
+                break;
+            }
+        }
+        m_nextAccess = nullptr;
+    }
+
+    return m_accessFaulted == 0;
+}
+
+/* SIGBUS handling */
+
+auto SharedMemoryPool::InstallSigbusHandler() -> void {
+    struct sigaction action{};
+    action.sa_sigaction = HandleSigbus;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGBUS, &action, &s_previousSigbusAction) == -1) {
+        std::cerr << __PRETTY_FUNCTION__ << ": "
+                  << std::system_error(std::error_code(errno, std::system_category())).what()
+                  << std::endl;
+    }
+}
+
+// Only async-signal-safe calls in here
+auto SharedMemoryPool::HandleSigbus(int signal, siginfo_t *info, void *context) -> void {
+    uint8_t *address = static_cast<uint8_t*>(info->si_addr);
+
+    for (SharedMemoryPool *pool = s_activeAccesses; pool != nullptr; pool = pool->m_nextAccess) {
+        uint8_t *begin = pool->memorySpace.data();
+        if (address < begin || address >= begin + pool->memorySpace.size()) {
+            continue;
+        }
+
+        // Zero pages in place of the shrunk file, the faulting access is retried on return
+        void *replacement = mmap(begin, pool->memorySpace.size(), PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (replacement == MAP_FAILED) {
+            break;
+        }
+
+        pool->m_accessFaulted = 1;
+        return;
+    }
+
+    // Not a pool access, the previous handler gets the retried fault
+    sigaction(SIGBUS, &s_previousSigbusAction, nullptr);
+}
@@ -0,0 +1,35 @@
+#include "SinglePixelBufferManager.hpp"
+
+#include "Buffer.hpp"
+
+using namespace moco::wayland::implementation;
+using namespace wayland::server;
+
+SinglePixelBufferManager::SinglePixelBufferManager(wp_single_pixel_buffer_manager_v1_t manager, Private) :
+    SinglePixelBufferManager(manager) {}
+
+SinglePixelBufferManager::SinglePixelBufferManager(wp_single_pixel_buffer_manager_v1_t manager) :
+    ObjectImplementationBase(manager)
+{
+    on_create_u32_rgba_buffer() = [this](buffer_t buffer, uint32_t red, uint32_t green, uint32_t blue, uint32_t alpha) -> void {HandleCreateU32RgbaBuffer(buffer, red, green, blue, alpha);};
+    on_destroy() = [this]() -> void {HandleDestroy();};
+}
+
+auto SinglePixelBufferManager::HandleCreateU32RgbaBuffer(buffer_t buffer, uint32_t red, uint32_t green, uint32_t blue, uint32_t alpha) -> void {
+    // Premultiplied, as for every other buffer
+    Buffer::Create(buffer, shm_format::argb8888)->AssignSolidColor({red, green, blue, alpha});
+}
+
+auto SinglePixelBufferManager::HandleDestroy() -> void {
+    /* Buffers outlive the manager, nothing to do */
+}
+
+GlobalSinglePixelBufferManager::GlobalSinglePixelBufferManager(display_t display) :
+    global_wp_single_pixel_buffer_manager_v1_t(display)
+{
+    on_bind() = OnBind;
+}
+
+auto GlobalSinglePixelBufferManager::OnBind(client_t client, wp_single_pixel_buffer_manager_v1_t manager) -> void {
+    SinglePixelBufferManager::Create(manager);
+}
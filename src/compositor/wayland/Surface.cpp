@@ -1,8 +1,9 @@
 #include "Surface.hpp"
 
-#include "Matrix.hpp"
+#include "FormatRegistry.hpp"
 
-#include <numbers>
+#include <algorithm>
+#include <iterator>
 
 using namespace moco::wayland::implementation;
 using namespace wayland::server;
@@ -16,30 +17,193 @@ auto Surface::GetRole() const -> Roles {
 }
 
 auto Surface::HasContent() -> bool {
-    return (m_activeStates.front().GetBuffer() != nullptr);
+    return (m_currentState->GetBuffer() != nullptr);
+}
+
+auto Surface::GetUploadCache() const -> const SurfaceUploadCache& {
+    return m_uploadCache;
+}
+
+auto Surface::Upload(const pixman_region32_t &region, int x, int y) -> size_t {
+    if (!m_uploadCache.HasPendingDamage()) {
+        return 0;
+    }
+
+    const SurfaceTransform transform = m_currentState->GetSurfaceTransform();
+    int32_t width = static_cast<int32_t>(m_currentState->GetLogicalWidth());
+    int32_t height = static_cast<int32_t>(m_currentState->GetLogicalHeight());
+
+    // Surface local and clipped to the surface, then mapped like damage
+    int boxCount;
+    const pixman_box32_t *boxes = pixman_region32_rectangles(&region, &boxCount);
+    m_uploadBoxes.clear();
+    for (int i = 0; i < boxCount; i++) {
+        pixman_box32_t box = {
+            .x1 = std::max(boxes[i].x1 - x, 0),
+            .y1 = std::max(boxes[i].y1 - y, 0),
+            .x2 = std::min(boxes[i].x2 - x, width),
+            .y2 = std::min(boxes[i].y2 - y, height)
+        };
+
+        if (box.x1 < box.x2 && box.y1 < box.y2) {
+            m_uploadBoxes.push_back(transform.Apply(box));
+        }
+    }
+
+    pixman_region32_t bufferRegion;
+    pixman_region32_init_rects(&bufferRegion, m_uploadBoxes.data(), static_cast<int>(m_uploadBoxes.size()));
+    size_t copiedBytes = m_uploadCache.Upload(bufferRegion);
+    pixman_region32_fini(&bufferRegion);
+
+    // Everything pending was copied, the client can reuse the buffer
+    if (std::shared_ptr<Buffer> buffer = m_currentState->GetBuffer(); buffer != nullptr && buffer->GetState() == Buffer::State::Copied) {
+        buffer->Release();
+    }
+
+    return copiedBytes;
+}
+
+auto Surface::GetWidth() const -> size_t {
+    return m_currentState->GetLogicalWidth();
+}
+
+auto Surface::GetHeight() const -> size_t {
+    return m_currentState->GetLogicalHeight();
+}
+
+auto Surface::AddOpaqueRegion(pixman_region32_t &region, int x, int y) const -> void {
+    if (m_currentState->GetBuffer() == nullptr) {
+        return;
+    }
+
+    const SurfaceState &state = *m_currentState;
+    const std::shared_ptr<Buffer> buffer = state.GetBuffer();
+    int width = static_cast<int>(state.GetLogicalWidth());
+    int height = static_cast<int>(state.GetLogicalHeight());
+
+    // Content without alpha is opaque whatever region the client set
+    std::optional<Buffer::SolidColor> color = buffer->GetSolidColor();
+    const PixelFormats::FormatInfo *format = PixelFormats::FormatRegistry::Get(buffer->GetShmFormat());
+    bool fullyOpaque = color.has_value() ? color->Alpha == UINT32_MAX : format != nullptr && !format->HasAlpha;
+
+    if (fullyOpaque) {
+        pixman_region32_union_rect(&region, &region, x, y, width, height);
+        return;
+    }
+
+    if (state.GetOpaqueRegion() == nullptr) {
+        return;
+    }
+
+    // Parts of the opaque region outside of the surface mean nothing
+    pixman_region32_t opaque;
+    pixman_region32_init(&opaque);
+    pixman_region32_intersect_rect(&opaque, &state.GetOpaqueRegion()->GetRegion(), 0, 0, width, height);
+    pixman_region32_translate(&opaque, x, y);
+    pixman_region32_union(&region, &region, &opaque);
+    pixman_region32_fini(&opaque);
+}
+
+auto Surface::SendFrameCallbacks(uint32_t timeMs) -> void {
+    for (callback_t &callback : m_frameCallbacks) {
+        callback.done(timeMs);
+    }
+
+    m_frameCallbacks.clear();
+}
+
+auto Surface::HasFrameCallbacks() const -> bool {
+    return !m_frameCallbacks.empty();
+}
+
+Surface::SurfaceState::SurfaceState() {
+    pixman_region32_init(&m_damageTracker);
 }
 
 Surface::SurfaceState::SurfaceState(const std::shared_ptr<Buffer> &buffer) :
     m_buffer(buffer)
 {
+    if (m_buffer != nullptr) {
+        m_buffer->AddStateReference();
+    }
+
     pixman_region32_init(&m_damageTracker);
 }
 
 Surface::SurfaceState::~SurfaceState() {
+    // The last state holding the buffer gives it back to the client
+    if (m_buffer != nullptr) {
+        m_buffer->RemoveStateReference();
+    }
+
     pixman_region32_fini(&m_damageTracker);
 }
 
-Surface::SurfaceState::SurfaceState(const SurfaceState &other) {
-    // Only copy if we need to
-    if (m_buffer != other.m_buffer) {
-        m_buffer = other.m_buffer;
+Surface::SurfaceState::SurfaceState(SurfaceState &&other) noexcept :
+    m_buffer(std::move(other.m_buffer)),
+    m_surfaceDamage(std::move(other.m_surfaceDamage)),
+    m_damageTracker(other.m_damageTracker),
+    m_bufferTransform(other.m_bufferTransform),
+    m_bufferScale(other.m_bufferScale),
+    m_bufferOffsetX(other.m_bufferOffsetX),
+    m_bufferOffsetY(other.m_bufferOffsetY),
+    m_surfaceWidth(other.m_surfaceWidth),
+    m_surfaceHeight(other.m_surfaceHeight),
+    m_frameCallbacks(std::move(other.m_frameCallbacks)),
+    m_opaqueRegion(std::move(other.m_opaqueRegion)),
+    m_inputRegion(std::move(other.m_inputRegion))
+{
+    // The region's rectangles now belong to this state, and the buffer
+    // reference moved along with the pointer
+    pixman_region32_init(&other.m_damageTracker);
+}
+
+auto Surface::SurfaceState::operator=(SurfaceState &&other) noexcept -> SurfaceState& {
+    if (this != &other) {
+        std::swap(m_buffer, other.m_buffer);
+        std::swap(m_surfaceDamage, other.m_surfaceDamage);
+        std::swap(m_damageTracker, other.m_damageTracker);
+        std::swap(m_frameCallbacks, other.m_frameCallbacks);
+        std::swap(m_opaqueRegion, other.m_opaqueRegion);
+        std::swap(m_inputRegion, other.m_inputRegion);
+        std::swap(m_convertedDamage, other.m_convertedDamage);
+
+        m_bufferTransform = other.m_bufferTransform;
+        m_bufferScale = other.m_bufferScale;
+        m_bufferOffsetX = other.m_bufferOffsetX;
+        m_bufferOffsetY = other.m_bufferOffsetY;
+        m_surfaceWidth = other.m_surfaceWidth;
+        m_surfaceHeight = other.m_surfaceHeight;
     }
 
-    pixman_region32_init(&m_damageTracker);
-    pixman_region32_copy(&m_damageTracker, &other.m_damageTracker);
+    return *this;
+}
+
+auto Surface::SurfaceState::Inherit(const SurfaceState &current) -> void {
+    if (m_buffer != current.m_buffer) {
+        AddBuffer(current.m_buffer);
+    }
+
+    m_bufferTransform = current.m_bufferTransform;
+    m_bufferScale = current.m_bufferScale;
+    m_surfaceWidth = current.m_surfaceWidth;
+    m_surfaceHeight = current.m_surfaceHeight;
+    m_opaqueRegion = current.m_opaqueRegion;
+    m_inputRegion = current.m_inputRegion;
+
+    Reset();
 }
 
 auto Surface::SurfaceState::AddBuffer(const std::shared_ptr<Buffer> &buffer) -> void {
+    // Referencing first, re-attaching the same buffer mustn't release it
+    if (buffer != nullptr) {
+        buffer->AddStateReference();
+    }
+
+    if (m_buffer != nullptr) {
+        m_buffer->RemoveStateReference();
+    }
+
     m_buffer = buffer;
     UpdateLogicalSurfaceDimensions();
 }
@@ -64,10 +228,14 @@ auto Surface::SurfaceState::AddSurfaceDamage(const Area &area) -> void {
     m_surfaceDamage.push_back(area);
 }
 
-auto Surface::SurfaceState::GetSurfaceDamage() const -> std::vector<Area> {
+auto Surface::SurfaceState::GetSurfaceDamage() const -> const std::vector<Area>& {
     return m_surfaceDamage;
 }
 
+auto Surface::SurfaceState::GetDamage() const -> const pixman_region32_t& {
+    return m_damageTracker;
+}
+
 auto Surface::SurfaceState::GetDamagedRegions() const -> std::vector<Area> {
     int numberOfBoxes;
     pixman_box32_t *boxes = pixman_region32_rectangles(&m_damageTracker, &numberOfBoxes);
@@ -120,13 +288,22 @@ auto Surface::SurfaceState::SetBufferOffset(int x, int y) -> void {
 }
 
 auto Surface::SurfaceState::GetBufferOffset() const -> std::pair<int, int> {
-    return std::make_pair<int, int>(m_bufferOffsetX, m_bufferOffsetY);
+    return {m_bufferOffsetX, m_bufferOffsetY};
+}
+
+auto Surface::SurfaceState::AddFrameCallback(callback_t callback) -> void {
+    m_frameCallbacks.push_back(callback);
 }
 
-auto Surface::SurfaceState::GetFrameCallbacks() const -> std::vector<callback_t> {
+auto Surface::SurfaceState::GetFrameCallbacks() const -> const std::vector<callback_t>& {
     return m_frameCallbacks;
 }
 
+auto Surface::SurfaceState::TakeFrameCallbacks(std::vector<callback_t> &callbacks) -> void {
+    callbacks.insert(callbacks.end(), std::make_move_iterator(m_frameCallbacks.begin()), std::make_move_iterator(m_frameCallbacks.end()));
+    m_frameCallbacks.clear();
+}
+
 auto Surface::SurfaceState::SetOpaqueRegion(std::shared_ptr<Region> region) -> void {
     m_opaqueRegion = region;
 }
@@ -147,11 +324,22 @@ auto Surface::SurfaceState::Reset() -> void {
     pixman_region32_clear(&m_damageTracker);
     m_surfaceDamage.clear();
 
+    // The offset moves the surface once, it's not a persistent property
+    m_bufferOffsetX = 0;
+    m_bufferOffsetY = 0;
+
     m_frameCallbacks.clear();
 }
 
 // Only gets the dimensions for the logical surface, not the content within it.
 auto Surface::SurfaceState::UpdateLogicalSurfaceDimensions() -> void {
+    // Without content the surface has no size
+    if (m_buffer == nullptr) {
+        m_surfaceWidth = 0;
+        m_surfaceHeight = 0;
+        return;
+    }
+
     // Undo scaling done by client to the buffer
     size_t logicalWidth = m_buffer->GetWidth() / m_bufferScale;
     size_t logicalHeight = m_buffer->GetHeight() / m_bufferScale;
@@ -175,58 +363,53 @@ auto Surface::SurfaceState::UpdateLogicalSurfaceDimensions() -> void {
     m_surfaceHeight = logicalHeight;
 }
 
-auto Surface::SurfaceState::ConvertSurfaceToBuffer(const Area &area) -> Area {
-    // First, we need to convert from logical surface coordiantes
-    // back to physical buffer coordinates. Helper object to do that.
-    helper::Transformation transformation(area.x, area.y);
-
-    size_t newWidth = area.width;
-    size_t newHeight = area.height;
-
-    // Move origin to center of the surface so the
-    // transformations work correctly.
-    transformation.AddTranslation(GetLogicalWidth() / -2, GetLogicalHeight() / -2);
-
-    // Perform the transformation to get to the buffer state
-    output_transform transform = GetBufferTransform();
-    if (transform == output_transform::flipped) {
-        transformation.AddYReflect();
-    } else if (transform == output_transform::flipped_90) {
-        transformation.AddYReflect();
-        transformation.AddRotate(std::numbers::pi / 2.0);
-        std::swap(newWidth, newHeight);
-    } else if (transform == output_transform::flipped_180) {
-        transformation.AddYReflect();
-        transformation.AddRotate(std::numbers::pi);
-    } else if (transform == output_transform::flipped_270) {
-        transformation.AddYReflect();
-        transformation.AddRotate((3.0 / 2.0) * std::numbers::pi);
-        std::swap(newWidth, newHeight);
-    } else if (transform == output_transform::_90) {
-        transformation.AddRotate(std::numbers::pi / 2.0);
-        std::swap(newWidth, newHeight);
-    } else if (transform == output_transform::_180) {
-        transformation.AddRotate(std::numbers::pi);
-    } else if (transform == output_transform::_270) {
-        transformation.AddRotate((3.0 / 2.0) * std::numbers::pi);
-        std::swap(newWidth, newHeight);
-    }
+auto Surface::SurfaceState::GetSurfaceTransform() const -> SurfaceTransform {
+    return SurfaceTransform(m_bufferTransform, m_bufferScale, m_surfaceWidth, m_surfaceHeight);
+}
 
-    // Translate points back to the "original" position
-    transformation.AddTranslation(GetLogicalWidth() * 2, GetLogicalHeight() * 2);
+auto Surface::SurfaceState::ConvertSurfaceToBuffer(const Area &area) const -> Area {
+    pixman_box32_t box = GetSurfaceTransform().Apply({
+        .x1 = area.x,
+        .y1 = area.y,
+        .x2 = area.x + static_cast<int32_t>(area.width),
+        .y2 = area.y + static_cast<int32_t>(area.height)
+    });
 
-    // Add the buffer scale
-    transformation.AddScale(GetBufferScale(), GetBufferScale());
+    return Area{.x = box.x1,
+                .y = box.y1,
+                .width = static_cast<size_t>(box.x2 - box.x1),
+                .height = static_cast<size_t>(box.y2 - box.y1)};
+}
 
-    // Handle buffer offset
-    transformation.AddTranslation(m_bufferOffsetX * -1, m_bufferOffsetY * -1);
+auto Surface::SurfaceState::ConvertSurfaceDamage() -> void {
+    if (m_surfaceDamage.empty()) {
+        return;
+    }
 
-    auto [newX, newY] = transformation.GetTransformedPoints();
+    const SurfaceTransform transform = GetSurfaceTransform();
+    int32_t width = static_cast<int32_t>(m_surfaceWidth);
+    int32_t height = static_cast<int32_t>(m_surfaceHeight);
+
+    m_convertedDamage.clear();
+    for (const Area &area : m_surfaceDamage) {
+        // Damage outside of the surface is allowed, and ignored
+        pixman_box32_t box = {
+            .x1 = std::max(area.x, 0),
+            .y1 = std::max(area.y, 0),
+            .x2 = static_cast<int32_t>(std::min<int64_t>(static_cast<int64_t>(area.x) + area.width, width)),
+            .y2 = static_cast<int32_t>(std::min<int64_t>(static_cast<int64_t>(area.y) + area.height, height))
+        };
+
+        if (box.x1 < box.x2 && box.y1 < box.y2) {
+            m_convertedDamage.push_back(transform.Apply(box));
+        }
+    }
 
-    return Area{.x = newX,
-                .y = newY,
-                .width = newWidth,
-                .height = newHeight};
+    // One region from every rectangle, instead of a union per rectangle
+    pixman_region32_t converted;
+    pixman_region32_init_rects(&converted, m_convertedDamage.data(), static_cast<int>(m_convertedDamage.size()));
+    pixman_region32_union(&m_damageTracker, &m_damageTracker, &converted);
+    pixman_region32_fini(&converted);
 }
 
 Surface::Surface(surface_t surface, Private) :
@@ -258,49 +441,83 @@ auto Surface::HandleAttach(buffer_t buffer, [[maybe_unused]] int x = 0, [[maybe_
     // undefined anyway if it's not, but since it should be defined
     // we can use `Get`, which allows us to not have to specify a format.
     // We add the buffer to the current pending state, to later be committed.
-    m_pendingState.AddBuffer(Buffer::Get(buffer));
+    // A null buffer detaches the surface's content
+    std::shared_ptr<Buffer> attachedBuffer = buffer.proxy_has_object() ? Buffer::Get(buffer) : nullptr;
+    if (attachedBuffer != nullptr) {
+        attachedBuffer->Attach();
+    }
+
+    m_pendingState->AddBuffer(attachedBuffer);
+    m_pendingAttach = true;
 }
 
 auto Surface::HandleDamage(int x, int y, size_t width, size_t height) -> void {
     // Surface damage withh be converted to buffer local upon commit
-    m_pendingState.AddSurfaceDamage(x, y, width, height);
+    m_pendingState->AddSurfaceDamage(x, y, width, height);
 }
 
 auto Surface::HandleFrame(callback_t callback) -> void {
-    m_pendingState.AddFrameCallback(callback);
+    m_pendingState->AddFrameCallback(callback);
 }
 
 auto Surface::HandleSetOpaqueRegion(region_t region) -> void {
-    m_pendingState.SetOpaqueRegion(Region::Get(region));
+    // A null region unsets it
+    m_pendingState->SetOpaqueRegion(region.proxy_has_object() ? Region::Get(region) : nullptr);
 }
 
 auto Surface::HandleSetInputRegion(region_t region) -> void {
-    m_pendingState.SetInputRegion(Region::Get(region));
+    m_pendingState->SetInputRegion(region.proxy_has_object() ? Region::Get(region) : nullptr);
 }
 
 auto Surface::HandleCommit() -> void {
-    if (m_pendingState.GetBuffer()->GetHeight() / m_pendingState.GetBufferScale() % 2 != 0 ||
-        m_pendingState.GetBuffer()->GetWidth() / m_pendingState.GetBufferScale() % 2 != 0) {
+    // Single-pixel buffers are 1x1, the size has to divide by the scale
+    // rather than by two
+    if (std::shared_ptr<Buffer> committedBuffer = m_pendingState->GetBuffer(); committedBuffer != nullptr &&
+        (committedBuffer->GetHeight() % m_pendingState->GetBufferScale() != 0 ||
+         committedBuffer->GetWidth() % m_pendingState->GetBufferScale() != 0)) {
         PostError(Error::InvalidSize, "Buffer size must be an integer multiple of the scale.");
     }
 
     // Once we get the commit request, we know that no other
     // transactions will happen, thus we can safely convert
     // surface to buffer.
-    for (const Area &surfaceArea : m_pendingState.GetSurfaceDamage()) {
-        m_pendingState.AddBufferDamage(m_pendingState.ConvertSurfaceToBuffer(surfaceArea));
+    m_pendingState->ConvertSurfaceDamage();
+
+    // The pending state becomes current, no state is copied
+    std::swap(m_pendingState, m_currentState);
+
+    // Callbacks wait for the repaint, resetting the state mustn't drop them
+    m_currentState->TakeFrameCallbacks(m_frameCallbacks);
+
+    // A buffer is only read once per attach, it may be released by now
+    std::shared_ptr<Buffer> buffer = m_currentState->GetBuffer();
+    if (m_pendingAttach) {
+        if (buffer != nullptr) {
+            buffer->Commit();
+        }
+
+        // Nothing is read yet, only the damage drawn later gets copied.
+        // Damage still pending from the previous buffer moves over to
+        // this one before that one is released below.
+        m_uploadCache.Update(buffer, m_currentState->GetDamage());
+
+        // Renders from the cache, the client can reuse the buffer right away
+        if (buffer != nullptr && buffer->GetState() == Buffer::State::Copied) {
+            buffer->Release();
+        }
     }
 
-    m_activeStates.push(m_pendingState);
+    m_pendingAttach = false;
 
-    m_pendingState.Reset();
+    // Whatever the client doesn't change carries over to the next commit
+    m_pendingState->Inherit(*m_currentState);
 }
 
 auto Surface::HandleSetBufferTransform(output_transform transform) -> void {
     // Should post InvalidTransform error if transform is invalid,
     // however I don't think we can get an invalid transform here,
     // as it should be a valid output_transform object.
-    m_pendingState.SetBufferTransform(transform);
+    m_pendingState->SetBufferTransform(transform);
 }
 
 auto Surface::HandleSetBufferScale(int scale) -> void {
@@ -308,13 +525,13 @@ auto Surface::HandleSetBufferScale(int scale) -> void {
         PostError(Error::InvalidScale, "Buffer scale must be greater than 0.");
     }
 
-    m_pendingState.SetBufferScale(scale);
+    m_pendingState->SetBufferScale(scale);
 }
 
 auto Surface::HandleDamageBuffer(int x, int y, size_t width, size_t height) -> void {
-    m_pendingState.AddBufferDamage({x, y, width, height});
+    m_pendingState->AddBufferDamage({x, y, width, height});
 }
 
 auto Surface::HandleOffset(int x, int y) -> void {
-    m_pendingState.SetBufferOffset(x, y);
+    m_pendingState->SetBufferOffset(x, y);
 }
@@ -0,0 +1,200 @@
+#include "SurfaceUploadCache.hpp"
+
+#include "FormatRegistry.hpp"
+
+using namespace moco::wayland::implementation;
+
+SurfaceUploadCache::SurfaceUploadCache() {
+    pixman_region32_init(&m_pendingDamage);
+}
+
+SurfaceUploadCache::~SurfaceUploadCache() {
+    if (m_image != nullptr) {
+        pixman_image_unref(m_image);
+    }
+
+    pixman_region32_fini(&m_pendingDamage);
+}
+
+auto SurfaceUploadCache::Update(const std::shared_ptr<Buffer> &buffer, const pixman_region32_t &damage) -> void {
+    if (buffer == nullptr) {
+        ClearPending();
+        return;
+    }
+
+    if (std::optional<Buffer::SolidColor> color = buffer->GetSolidColor(); color.has_value()) {
+        ClearPending();
+        UpdateSolidColor(color.value());
+        buffer->MarkCopied();
+        return;
+    }
+
+    const PixelFormats::FormatInfo *format = PixelFormats::FormatRegistry::Get(buffer->GetShmFormat());
+    if (format == nullptr) {
+        ClearPending();
+        return;
+    }
+
+    int width = static_cast<int>(buffer->GetWidth());
+    int height = static_cast<int>(buffer->GetHeight());
+
+    bool fullCopy = m_image == nullptr
+        || m_solidColor.has_value()
+        || pixman_image_get_width(m_image) != width
+        || pixman_image_get_height(m_image) != height
+        || m_sourceFormat != format->ShmFormat;
+
+    if (fullCopy) {
+        if (m_image != nullptr) {
+            pixman_image_unref(m_image);
+        }
+
+        m_image = pixman_image_create_bits(PIXMAN_a8r8g8b8, width, height, nullptr, 0);
+        m_sourceFormat = format->ShmFormat;
+        m_solidColor.reset();
+        if (m_image == nullptr) {
+            ClearPending();
+            return;
+        }
+
+        pixman_region32_fini(&m_pendingDamage);
+        pixman_region32_init_rect(&m_pendingDamage, 0, 0, width, height);
+    } else {
+        // Damage outside of the buffer is allowed, and ignored
+        pixman_region32_union(&m_pendingDamage, &m_pendingDamage, &damage);
+        pixman_region32_intersect_rect(&m_pendingDamage, &m_pendingDamage, 0, 0, width, height);
+    }
+
+    // Whatever the previous buffer still had pending is read from this one
+    m_pendingBuffer = buffer;
+    if (!pixman_region32_not_empty(&m_pendingDamage)) {
+        ClearPending();
+        buffer->MarkCopied();
+    }
+}
+
+auto SurfaceUploadCache::Upload(const pixman_region32_t &region) -> size_t {
+    m_lastCopiedBytes = 0;
+    if (m_pendingBuffer == nullptr) {
+        return 0;
+    }
+
+    pixman_region32_t copyRegion;
+    pixman_region32_init(&copyRegion);
+    pixman_region32_intersect(&copyRegion, &m_pendingDamage, &region);
+    size_t copiedBytes = Copy(copyRegion);
+    pixman_region32_fini(&copyRegion);
+
+    return copiedBytes;
+}
+
+auto SurfaceUploadCache::UploadAll() -> size_t {
+    m_lastCopiedBytes = 0;
+    if (m_pendingBuffer == nullptr) {
+        return 0;
+    }
+
+    // `Copy` shrinks the pending damage while walking it
+    pixman_region32_t copyRegion;
+    pixman_region32_init(&copyRegion);
+    pixman_region32_copy(&copyRegion, &m_pendingDamage);
+    size_t copiedBytes = Copy(copyRegion);
+    pixman_region32_fini(&copyRegion);
+
+    return copiedBytes;
+}
+
+auto SurfaceUploadCache::GetPendingDamage() const -> const pixman_region32_t& {
+    return m_pendingDamage;
+}
+
+auto SurfaceUploadCache::HasPendingDamage() const -> bool {
+    return m_pendingBuffer != nullptr;
+}
+
+auto SurfaceUploadCache::Copy(const pixman_region32_t &copyRegion) -> size_t {
+    const std::shared_ptr<Buffer> buffer = m_pendingBuffer;
+    const PixelFormats::FormatInfo *format = PixelFormats::FormatRegistry::Get(buffer->GetShmFormat());
+    if (!pixman_region32_not_empty(&copyRegion) || format == nullptr || m_image == nullptr) {
+        return 0;
+    }
+
+    int width = static_cast<int>(buffer->GetWidth());
+    int height = static_cast<int>(buffer->GetHeight());
+
+    buffer->BeginAccess();
+
+    // Source rows in bytes, as formats differ in pixel size
+    helper::ImageView<const uint8_t> source(buffer->GetBytes().data(), width * format->BytesPerPixel, height, buffer->GetStride());
+    helper::ImageView<uint32_t> destination(pixman_image_get_data(m_image), width, height, pixman_image_get_stride(m_image) / sizeof(uint32_t));
+
+    int boxCount;
+    const pixman_box32_t *boxes = pixman_region32_rectangles(&copyRegion, &boxCount);
+    for (int i = 0; i < boxCount; i++) {
+        const pixman_box32_t &box = boxes[i];
+        size_t boxWidth = box.x2 - box.x1;
+        size_t boxHeight = box.y2 - box.y1;
+
+        helper::ImageView<const uint8_t> sourceBox = source.Slice(box.x1 * format->BytesPerPixel, box.y1, boxWidth * format->BytesPerPixel, boxHeight);
+        helper::ImageView<uint32_t> destinationBox = destination.Slice(box.x1, box.y1, boxWidth, boxHeight);
+        for (size_t y = 0; y < boxHeight; y++) {
+            format->ConvertRow(sourceBox.Row(y).data(), destinationBox.Row(y).data(), boxWidth);
+        }
+
+        m_lastCopiedBytes += boxWidth * boxHeight * format->BytesPerPixel;
+    }
+
+    // A faulted buffer read as zeroes, the client already got an error for it
+    buffer->EndAccess();
+
+    pixman_region32_subtract(&m_pendingDamage, &m_pendingDamage, &copyRegion);
+    if (!pixman_region32_not_empty(&m_pendingDamage)) {
+        ClearPending();
+        buffer->MarkCopied();
+    }
+
+    m_totalCopiedBytes += m_lastCopiedBytes;
+    return m_lastCopiedBytes;
+}
+
+auto SurfaceUploadCache::ClearPending() -> void {
+    m_pendingBuffer.reset();
+    pixman_region32_clear(&m_pendingDamage);
+}
+
+auto SurfaceUploadCache::GetImage() const -> pixman_image_t* {
+    return m_image;
+}
+
+auto SurfaceUploadCache::IsSolidColor() const -> bool {
+    return m_solidColor.has_value();
+}
+
+auto SurfaceUploadCache::UpdateSolidColor(const Buffer::SolidColor &color) -> void {
+    if (m_solidColor == color && m_image != nullptr) {
+        return;
+    }
+
+    if (m_image != nullptr) {
+        pixman_image_unref(m_image);
+    }
+
+    // pixman colors are 16 bits per channel
+    pixman_color_t pixmanColor = {
+        .red = static_cast<uint16_t>(color.Red >> 16),
+        .green = static_cast<uint16_t>(color.Green >> 16),
+        .blue = static_cast<uint16_t>(color.Blue >> 16),
+        .alpha = static_cast<uint16_t>(color.Alpha >> 16)
+    };
+
+    m_image = pixman_image_create_solid_fill(&pixmanColor);
+    m_solidColor = m_image != nullptr ? std::optional(color) : std::nullopt;
+}
+
+auto SurfaceUploadCache::GetLastCopiedBytes() const -> size_t {
+    return m_lastCopiedBytes;
+}
+
+auto SurfaceUploadCache::GetTotalCopiedBytes() const -> uint64_t {
+    return m_totalCopiedBytes;
+}
@@ -0,0 +1,44 @@
+#include "Touch.hpp"
+
+using namespace moco::wayland::implementation;
+using namespace wayland::server;
+
+Touch::Touch(touch_t touch, Private) :
+    Touch(touch) {}
+
+Touch::Touch(touch_t touch) :
+    ObjectImplementationBase(touch)
+{
+    on_release() = [this]() -> void {HandleRelease();};
+}
+
+auto Touch::SendFrame(const Frame_EventData &data, const Surface *surface) -> void {
+    for (size_t i = 0; i < data.PointCount; i++) {
+        const Point &point = data.Points[i];
+        switch (point.State) {
+            case PointState::Down:
+                if (surface != nullptr) {
+                    down(data.Serial, data.Time, *surface, point.Id, point.X, point.Y);
+                }
+                break;
+            case PointState::Motion:
+                motion(data.Time, point.Id, point.X, point.Y);
+                break;
+            case PointState::Up:
+                up(data.Serial, data.Time, point.Id);
+                break;
+        }
+    }
+
+    // One frame per libinput touch frame, clients process
+    // the whole batch at once.
+    frame();
+}
+
+auto Touch::SendCancel() -> void {
+    cancel();
+}
+
+auto Touch::HandleRelease() -> void {
+
+}
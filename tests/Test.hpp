@@ -0,0 +1,72 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <source_location>
+#include <string_view>
+#include <vector>
+
+namespace moco::test {
+    /**
+     * @brief Registry of the test cases linked into `moco_tests`
+     * @details Cases register themselves through `MOCO_TEST` during static
+     * initialization. CTest runs each case as its own process, passing
+     * the case's name as the only argument.
+     *
+     */
+    class TestRegistry {
+        public:
+            using TestFunction_t = std::function<void()>;
+
+            struct TestCase {
+                std::string_view Name;
+                TestFunction_t Function;
+            };
+
+            static inline auto Register(std::string_view name, TestFunction_t function) -> bool {
+                GetTests().push_back({name, std::move(function)});
+                return true;
+            }
+
+            static inline auto GetTests() -> std::vector<TestCase>& {
+                static std::vector<TestCase> tests;
+                return tests;
+            }
+
+            // Failed checks of the case currently running
+            static inline auto GetFailures() -> size_t& {
+                static size_t failures{0};
+                return failures;
+            }
+    };
+
+    /**
+     * @brief Records a failed check without stopping the case
+     * @details Every failing check is reported, so a table driven case
+     * shows all the rows that are wrong instead of only the first one.
+     *
+     * @return `bool`: `condition`, to allow bailing out of loops early.
+     *
+     */
+    inline auto Check(bool condition, std::string_view expression, std::source_location location = std::source_location::current()) -> bool {
+        if (!condition) {
+            TestRegistry::GetFailures()++;
+            std::cerr << location.file_name() << ":" << location.line() << ": "
+                      << "Check failed: " << expression
+                      << std::endl;
+        }
+
+        return condition;
+    }
+}  // namespace moco::test
+
+#define MOCO_TEST_CONCAT_IMPL(a, b) a##b
+#define MOCO_TEST_CONCAT(a, b) MOCO_TEST_CONCAT_IMPL(a, b)
+
+// Defines and registers a test case, `MOCO_TEST(Suite.Case) { ... }`
+#define MOCO_TEST(name) \
+    static auto MOCO_TEST_CONCAT(TestFunction_, __LINE__)() -> void; \
+    static const bool MOCO_TEST_CONCAT(s_testRegistered_, __LINE__) = ::moco::test::TestRegistry::Register(#name, MOCO_TEST_CONCAT(TestFunction_, __LINE__)); \
+    static auto MOCO_TEST_CONCAT(TestFunction_, __LINE__)() -> void
+
+#define MOCO_CHECK(condition) ::moco::test::Check(static_cast<bool>(condition), #condition)
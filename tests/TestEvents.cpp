@@ -0,0 +1,186 @@
+#include "Test.hpp"
+
+#include "Events.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace moco::compositor;
+
+namespace {
+    enum class TestEvents {
+        Value,
+        Motion,
+        Other
+    };
+
+    struct Value_EventData {
+        int Value{0};
+    };
+
+    struct Motion_EventData {
+        int32_t Slot{0};
+        double Dx{0};
+    };
+}
+
+namespace moco::compositor {
+    template <>
+    struct EventPayload<TestEvents::Value> {
+        using Type = Value_EventData;
+    };
+
+    template <>
+    struct EventPayload<TestEvents::Motion> {
+        using Type = Motion_EventData;
+
+        // Motion of the same slot accumulates
+        static auto Coalesce(Type &queued, const Type &incoming) -> bool {
+            if (queued.Slot != incoming.Slot) {
+                return false;
+            }
+
+            queued.Dx += incoming.Dx;
+            return true;
+        }
+    };
+
+    template <>
+    struct EventPayload<TestEvents::Other> {
+        using Type = Value_EventData;
+    };
+}  // namespace moco::compositor
+
+// Only the subscribers of the published event value get the payload
+MOCO_TEST(Events.Publish) {
+    std::vector<int> received;
+    std::vector<int> other;
+
+    EventSubscriber_t<TestEvents::Value> first = Events::Subscribe<TestEvents::Value>([&received](const Value_EventData &eventData) -> void {
+        received.push_back(eventData.Value);
+    });
+    EventSubscriber_t<TestEvents::Value> second = Events::Subscribe<TestEvents::Value>([&received](const Value_EventData &eventData) -> void {
+        received.push_back(eventData.Value * 10);
+    });
+    EventSubscriber_t<TestEvents::Other> otherSubscriber = Events::Subscribe<TestEvents::Other>([&other](const Value_EventData &eventData) -> void {
+        other.push_back(eventData.Value);
+    });
+
+    MOCO_CHECK(Events::Publish<TestEvents::Value>({.Value = 4}) == 2);
+    MOCO_CHECK((received == std::vector<int>{4, 40}));
+    MOCO_CHECK(other.empty());
+
+    second.reset();
+    MOCO_CHECK(Events::Publish<TestEvents::Value>({.Value = 5}) == 1);
+    MOCO_CHECK((received == std::vector<int>{4, 40, 5}));
+}
+
+// Subscribing or unsubscribing from within a handler neither skips
+// nor repeats anyone during the running publish
+MOCO_TEST(Events.SubscribeDuringPublish) {
+    std::vector<int> calls;
+    EventSubscriber_t<TestEvents::Value> added;
+    EventSubscriber_t<TestEvents::Value> removed;
+
+    EventSubscriber_t<TestEvents::Value> first = Events::Subscribe<TestEvents::Value>([&](const Value_EventData&) -> void {
+        calls.push_back(1);
+        removed.reset();
+        if (!added) {
+            added = Events::Subscribe<TestEvents::Value>([&calls](const Value_EventData&) -> void {calls.push_back(3);});
+        }
+    });
+    removed = Events::Subscribe<TestEvents::Value>([&calls](const Value_EventData&) -> void {calls.push_back(2);});
+    EventSubscriber_t<TestEvents::Value> last = Events::Subscribe<TestEvents::Value>([&calls](const Value_EventData&) -> void {calls.push_back(4);});
+
+    Events::Publish<TestEvents::Value>({});
+    MOCO_CHECK((calls == std::vector<int>{1, 4}));
+
+    calls.clear();
+    Events::Publish<TestEvents::Value>({});
+    MOCO_CHECK((calls == std::vector<int>{1, 4, 3}));
+}
+
+// Queued events publish in order, consecutive coalescable ones merge
+MOCO_TEST(Events.EnqueueCoalesces) {
+    std::vector<double> motion;
+    std::vector<int> values;
+
+    EventSubscriber_t<TestEvents::Motion> motionSubscriber = Events::Subscribe<TestEvents::Motion>([&motion](const Motion_EventData &eventData) -> void {
+        motion.push_back(eventData.Dx);
+    });
+    EventSubscriber_t<TestEvents::Value> valueSubscriber = Events::Subscribe<TestEvents::Value>([&values](const Value_EventData &eventData) -> void {
+        values.push_back(eventData.Value);
+    });
+
+    Events::Enqueue<TestEvents::Motion>({.Slot = 0, .Dx = 1});
+    Events::Enqueue<TestEvents::Motion>({.Slot = 0, .Dx = 2});
+    Events::Enqueue<TestEvents::Motion>({.Slot = 1, .Dx = 4});
+    Events::Enqueue<TestEvents::Value>({.Value = 1});
+    Events::Enqueue<TestEvents::Value>({.Value = 2});
+    Events::Enqueue<TestEvents::Motion>({.Slot = 1, .Dx = 8});
+
+    MOCO_CHECK(motion.empty());
+    MOCO_CHECK(Events::Dispatch() == 5);
+    MOCO_CHECK((motion == std::vector<double>{3, 4, 8}));
+    MOCO_CHECK((values == std::vector<int>{1, 2}));
+    MOCO_CHECK(Events::Dispatch() == 0);
+}
+
+// Events posted from other threads all arrive, in order per thread
+MOCO_TEST(Events.PostFromThreads) {
+    constexpr int s_threads = 4;
+    constexpr int s_eventsPerThread = 200;
+
+    std::vector<std::vector<int>> received(s_threads);
+    EventSubscriber_t<TestEvents::Value> subscriber = Events::Subscribe<TestEvents::Value>([&received](const Value_EventData &eventData) -> void {
+        received[eventData.Value / s_eventsPerThread].push_back(eventData.Value % s_eventsPerThread);
+    });
+
+    std::atomic<int> dropped{0};
+    std::vector<std::jthread> threads;
+    for (int thread = 0; thread < s_threads; thread++) {
+        threads.emplace_back([thread, &dropped]() -> void {
+            for (int i = 0; i < s_eventsPerThread; i++) {
+                // Stays below the ring's capacity, so nothing may be dropped
+                if (!Events::Post<TestEvents::Value>({.Value = thread * s_eventsPerThread + i})) {
+                    dropped++;
+                }
+            }
+        });
+    }
+    threads.clear();
+
+    Events::DispatchPosted();
+    MOCO_CHECK(dropped == 0);
+
+    for (const std::vector<int> &values : received) {
+        if (MOCO_CHECK(values.size() == s_eventsPerThread)) {
+            for (int i = 0; i < s_eventsPerThread; i++) {
+                MOCO_CHECK(values[i] == i);
+            }
+        }
+    }
+}
+
+// Statistics count publishes and handler calls only while enabled
+MOCO_TEST(Events.Statistics) {
+    EventSubscriber_t<TestEvents::Other> subscriber = Events::Subscribe<TestEvents::Other>([](const Value_EventData&) -> void {});
+    subscriber->AddHandler([](const Value_EventData&) -> void {});
+
+    EventStatistics &statistics = EventStatistics::Get<TestEvents::Other>();
+    statistics.Reset();
+
+    Events::Publish<TestEvents::Other>({});
+    MOCO_CHECK(statistics.GetPublishCount() == 0);
+
+    EventStatistics::SetEnabled(true);
+    Events::Publish<TestEvents::Other>({});
+    Events::Publish<TestEvents::Other>({});
+    EventStatistics::SetEnabled(false);
+
+    MOCO_CHECK(statistics.GetPublishCount() == 2);
+    MOCO_CHECK(statistics.GetHandlerLatency().GetCount() == 4);
+    MOCO_CHECK(statistics.GetEventName().ends_with("Other"));
+}
@@ -0,0 +1,141 @@
+#include "Test.hpp"
+
+#include "FormatRegistry.hpp"
+
+#include <wayland-server-protocol.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace moco::wayland::implementation::PixelFormats;
+using namespace wayland::server;
+
+namespace {
+    // Widest row checked, long enough for every vector loop and tail
+    constexpr size_t s_maxWidth = 70;
+
+    struct KnownPixel {
+        shm_format Format;
+        uint32_t Source;
+        uint32_t Expected;
+    };
+
+    // Worked out by hand from the channel layouts of `wl_shm.format`
+    constexpr std::array<KnownPixel, 12> s_knownPixels = {{
+        {shm_format::argb8888, 0x80402010, 0x80402010},
+        {shm_format::xrgb8888, 0x00402010, 0xff402010},
+        {shm_format::abgr8888, 0x80102040, 0x80402010},
+        {shm_format::xbgr8888, 0x12102040, 0xff402010},
+        {shm_format::rgb565, 0xffff, 0xffffffff},
+        {shm_format::rgb565, 0xf800, 0xffff0000},
+        {shm_format::rgb565, 0x0410, 0xff008284},
+        {shm_format::argb2101010, 0xc0000000 | (0x3ffu << 20), 0xffff0000},
+        {shm_format::argb2101010, 0x40000000 | (0x200u << 10), 0x55008000},
+        {shm_format::xrgb2101010, 0x00000000 | 0x3ffu, 0xff0000ff},
+        {shm_format::abgr2101010, 0x80000000 | (0x3ffu << 20), 0xaa0000ff},
+        {shm_format::xbgr2101010, 0xc0000000 | 0x3ffu, 0xffff0000}
+    }};
+}
+
+// Every supported format has an entry with a converter
+MOCO_TEST(FormatRegistry.SupportedFormats) {
+    MOCO_CHECK(FormatRegistry::GetSupportedFormats().size() == FormatRegistry::s_formatCount);
+
+    for (shm_format format : FormatRegistry::GetSupportedFormats()) {
+        const FormatInfo *info = FormatRegistry::Get(format);
+        if (MOCO_CHECK(info != nullptr)) {
+            MOCO_CHECK(info->ShmFormat == format);
+            MOCO_CHECK(info->ConvertRow != nullptr);
+            MOCO_CHECK(info->BytesPerPixel == (format == shm_format::rgb565 ? 2 : 4));
+        }
+    }
+
+    MOCO_CHECK(FormatRegistry::GetRowConverters("scalar")[0] != nullptr);
+    MOCO_CHECK(FormatRegistry::GetRowConverters("neon")[0] == nullptr);
+}
+
+// The scalar converters produce hand checked values
+MOCO_TEST(FormatRegistry.ScalarKnownPixels) {
+    std::array<RowConverter_t, FormatRegistry::s_formatCount> scalar = FormatRegistry::GetRowConverters("scalar");
+    std::span<const shm_format> formats = FormatRegistry::GetSupportedFormats();
+
+    for (const KnownPixel &pixel : s_knownPixels) {
+        size_t index = static_cast<size_t>(std::find(formats.begin(), formats.end(), pixel.Format) - formats.begin());
+        if (!MOCO_CHECK(index < formats.size())) {
+            continue;
+        }
+
+        std::array<uint8_t, 4> source{};
+        std::memcpy(source.data(), &pixel.Source, pixel.Format == shm_format::rgb565 ? 2 : 4);
+
+        uint32_t converted{0};
+        scalar[index](source.data(), &converted, 1);
+        if (!MOCO_CHECK(converted == pixel.Expected)) {
+            std::cerr << std::hex << "format=0x" << static_cast<uint32_t>(pixel.Format)
+                      << " source=0x" << pixel.Source
+                      << " got=0x" << converted
+                      << " expected=0x" << pixel.Expected
+                      << std::dec << std::endl;
+        }
+    }
+}
+
+// Every vector kernel matches the scalar one bit for bit, for every
+// format, every width up to `s_maxWidth`, and source rows starting at
+// any byte offset so unaligned loads and the scalar tails are covered
+MOCO_TEST(FormatRegistry.KernelEquivalence) {
+    std::array<RowConverter_t, FormatRegistry::s_formatCount> scalar = FormatRegistry::GetRowConverters("scalar");
+    std::span<const shm_format> formats = FormatRegistry::GetSupportedFormats();
+
+    std::mt19937 random(0x6d6f636f);
+    std::vector<uint8_t> source((s_maxWidth + 1) * 4 + 4);
+    for (uint8_t &byte : source) {
+        byte = static_cast<uint8_t>(random());
+    }
+
+    // One element past each row catches kernels writing too far
+    constexpr uint32_t s_canary = 0xdeadbeef;
+    std::vector<uint32_t> expected(s_maxWidth + 2);
+    std::vector<uint32_t> converted(s_maxWidth + 2);
+
+    for (std::string_view kernelSet : FormatRegistry::s_kernelSets) {
+        std::array<RowConverter_t, FormatRegistry::s_formatCount> converters = FormatRegistry::GetRowConverters(kernelSet);
+        if (kernelSet == "scalar") {
+            continue;
+        }
+
+        if (converters[0] == nullptr) {
+            std::cout << "Skipping " << kernelSet << ", not supported here" << std::endl;
+            continue;
+        }
+
+        for (size_t format = 0; format < FormatRegistry::s_formatCount; format++) {
+            for (size_t sourceOffset = 0; sourceOffset < 4; sourceOffset++) {
+                // Also misaligns the destination by a pixel
+                for (size_t destinationOffset = 0; destinationOffset < 2; destinationOffset++) {
+                    for (size_t width = 0; width <= s_maxWidth; width++) {
+                        std::fill(expected.begin(), expected.end(), s_canary);
+                        std::fill(converted.begin(), converted.end(), s_canary);
+
+                        scalar[format](source.data() + sourceOffset, expected.data() + destinationOffset, width);
+                        converters[format](source.data() + sourceOffset, converted.data() + destinationOffset, width);
+
+                        if (!MOCO_CHECK(converted == expected)) {
+                            std::cerr << "kernels=" << kernelSet
+                                      << " format=0x" << std::hex << static_cast<uint32_t>(formats[format]) << std::dec
+                                      << " width=" << width
+                                      << " sourceOffset=" << sourceOffset
+                                      << " destinationOffset=" << destinationOffset
+                                      << std::endl;
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,493 @@
+#include "Test.hpp"
+
+#include "EventStatistics.hpp"
+#include "Gestures.hpp"
+#include "InputTrace.hpp"
+#include "LibInput.hpp"
+#include "Touch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace moco::backend;
+using namespace moco::compositor;
+
+namespace {
+    using Gesture = GestureRecognizer::Gesture;
+    using Kind = GestureRecognizer::Kind;
+    using Phase = GestureRecognizer::Phase;
+    using Edge = GestureRecognizer::Edge;
+
+    // Frames of a 60Hz touch screen
+    constexpr uint64_t s_frameUsec = 16'667;
+
+    /**
+     * @brief Writes a touch sequence the way `LibInput` records one
+     * @details Every call appends the raw event payload to the trace,
+     * `Frame` ends the current touch frame and advances the clock.
+     *
+     */
+    class TouchScript {
+        public:
+            TouchScript(InputTrace::Writer &writer, uint64_t startUsec) :
+                m_writer(writer),
+                m_timeUsec(startUsec) {}
+
+            auto Down(int32_t slot, double x, double y) -> void {
+                Write<LibInput::Events::TouchDown>({.TimeUsec = m_timeUsec, .Slot = slot, .X = x, .Y = y});
+            }
+
+            auto Motion(int32_t slot, double x, double y) -> void {
+                Write<LibInput::Events::TouchMotion>({.TimeUsec = m_timeUsec, .Slot = slot, .X = x, .Y = y});
+            }
+
+            auto Up(int32_t slot) -> void {
+                Write<LibInput::Events::TouchUp>({.TimeUsec = m_timeUsec, .Slot = slot});
+            }
+
+            auto Frame(uint64_t advanceUsec = s_frameUsec) -> void {
+                Write<LibInput::Events::TouchFrame>({.TimeUsec = m_timeUsec});
+                m_timeUsec += advanceUsec;
+            }
+
+        private:
+            template <LibInput::Events Event>
+            auto Write(const EventPayload_t<Event> &eventData) -> void {
+                m_writer.WriteEvent(eventData.TimeUsec, 0, static_cast<uint16_t>(Event), std::as_bytes(std::span(&eventData, 1)));
+            }
+
+            InputTrace::Writer &m_writer;
+            uint64_t m_timeUsec;
+    };
+
+    template <typename T>
+    auto Decode(const InputTrace::Record &record) -> std::optional<T> {
+        if (!MOCO_CHECK(record.Payload.size() == sizeof(T))) {
+            return std::nullopt;
+        }
+
+        T eventData;
+        std::memcpy(&eventData, record.Payload.data(), sizeof(T));
+        return eventData;
+    }
+
+    /**
+     * @brief Reads a trace back into touch frames
+     * @details Does what the `Touch` backend does with the replayed
+     * libinput events: feeds them to a `TouchState` and takes a frame
+     * on every touch frame event.
+     *
+     */
+    auto ReadFrames(const std::filesystem::path &path) -> std::vector<TouchState::Frame> {
+        std::vector<TouchState::Frame> frames;
+        TouchState touchState;
+
+        InputTrace::Reader reader(path);
+        while (std::optional<InputTrace::Record> record = reader.Next()) {
+            if (record->Header.Kind != InputTrace::RecordKind::Event) {
+                continue;
+            }
+
+            switch (static_cast<LibInput::Events>(record->Header.Type)) {
+                case LibInput::Events::TouchDown:
+                    if (auto eventData = Decode<LibInput::TouchDown_EventData>(*record)) {
+                        touchState.Down(eventData->Slot, eventData->TimeUsec, eventData->X, eventData->Y);
+                    }
+                    break;
+                case LibInput::Events::TouchMotion:
+                    if (auto eventData = Decode<LibInput::TouchMotion_EventData>(*record)) {
+                        touchState.Motion(eventData->Slot, eventData->TimeUsec, eventData->X, eventData->Y);
+                    }
+                    break;
+                case LibInput::Events::TouchUp:
+                    if (auto eventData = Decode<LibInput::TouchUp_EventData>(*record)) {
+                        touchState.Up(eventData->Slot, eventData->TimeUsec);
+                    }
+                    break;
+                case LibInput::Events::TouchFrame:
+                    if (auto eventData = Decode<LibInput::TouchFrame_EventData>(*record); eventData && touchState.HasChanges()) {
+                        frames.push_back(touchState.TakeFrame(eventData->TimeUsec));
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        return frames;
+    }
+
+    struct RecognizeResult {
+        std::vector<Gesture> Gestures;
+        // Claimed after any of the frames
+        bool WasClaimed{false};
+    };
+
+    // Runs frames through a recognizer, driving the hold timeout like `Gestures` does
+    auto Recognize(const std::vector<TouchState::Frame> &frames) -> RecognizeResult {
+        RecognizeResult result;
+        GestureRecognizer recognizer;
+
+        auto collect = [&result](const GestureRecognizer::Output &output) -> void {
+            result.Gestures.insert(result.Gestures.end(), output.Gestures.begin(), output.Gestures.begin() + output.Count);
+        };
+
+        for (const TouchState::Frame &frame : frames) {
+            std::optional<uint64_t> deadline = recognizer.GetHoldDeadline();
+            if (deadline.has_value() && deadline.value() <= frame.TimeUsec) {
+                collect(recognizer.ProcessTimeout(deadline.value()));
+            }
+
+            collect(recognizer.ProcessFrame(frame));
+            result.WasClaimed |= recognizer.IsClaimed();
+        }
+
+        return result;
+    }
+
+    struct Scenario {
+        std::string Name;
+        // The gesture it should be recognized as, none for plain client input
+        std::optional<Kind> Expected;
+        std::optional<Edge> ExpectedEdge;
+        std::function<void(TouchScript&, std::mt19937&)> Script;
+    };
+
+    // Small per sample noise, like a real digitizer's
+    auto Jitter(std::mt19937 &random, double amplitude = 0.002) -> double {
+        return std::uniform_real_distribution<double>(-amplitude, amplitude)(random);
+    }
+
+    auto Uniform(std::mt19937 &random, double min, double max) -> double {
+        return std::uniform_real_distribution<double>(min, max)(random);
+    }
+
+    auto EdgeSwipe(Edge edge) -> Scenario {
+        return {
+            .Name = "edge swipe",
+            .Expected = Kind::EdgeSwipe,
+            .ExpectedEdge = edge,
+            .Script = [edge](TouchScript &script, std::mt19937 &random) -> void {
+                double along = Uniform(random, 0.2, 0.8);
+                double start = Uniform(random, 0.0, 0.02);
+                double distance = Uniform(random, 0.15, 0.4);
+                int frames = static_cast<int>(Uniform(random, 8, 24));
+
+                auto position = [&](double inward) -> std::pair<double, double> {
+                    switch (edge) {
+                        case Edge::Left:
+                            return {inward, along};
+                        case Edge::Right:
+                            return {1.0 - inward, along};
+                        case Edge::Top:
+                            return {along, inward};
+                        case Edge::Bottom:
+                            return {along, 1.0 - inward};
+                    }
+                    return {0, 0};
+                };
+
+                auto [x, y] = position(start);
+                script.Down(0, x, y);
+                script.Frame();
+
+                for (int frame = 1; frame <= frames; frame++) {
+                    auto [x, y] = position(start + distance * frame / frames);
+                    script.Motion(0, std::clamp(x + Jitter(random), 0.0, 1.0), std::clamp(y + Jitter(random), 0.0, 1.0));
+                    script.Frame();
+                }
+
+                script.Up(0);
+                script.Frame();
+            }
+        };
+    }
+
+    auto Pinch(double scale, double rotation) -> Scenario {
+        return {
+            .Name = rotation != 0 ? "rotate" : (scale < 1 ? "pinch in" : "pinch out"),
+            .Expected = Kind::Pinch,
+            .Script = [scale, rotation](TouchScript &script, std::mt19937 &random) -> void {
+                double centerX = Uniform(random, 0.35, 0.65);
+                double centerY = Uniform(random, 0.35, 0.65);
+                double radius = Uniform(random, 0.08, 0.15);
+                double angle = Uniform(random, 0, 3.14);
+                int frames = static_cast<int>(Uniform(random, 10, 30));
+
+                auto finger = [&](int32_t slot, double progress) -> std::pair<double, double> {
+                    double r = radius * (1.0 + (scale - 1.0) * progress);
+                    double a = angle + rotation * progress + (slot == 0 ? 0 : 3.14159265);
+                    return {centerX + r * std::cos(a) + Jitter(random), centerY + r * std::sin(a) + Jitter(random)};
+                };
+
+                for (int32_t slot : {0, 1}) {
+                    auto [x, y] = finger(slot, 0);
+                    script.Down(slot, x, y);
+                }
+                script.Frame();
+
+                for (int frame = 1; frame <= frames; frame++) {
+                    for (int32_t slot : {0, 1}) {
+                        auto [x, y] = finger(slot, static_cast<double>(frame) / frames);
+                        script.Motion(slot, x, y);
+                    }
+                    script.Frame();
+                }
+
+                script.Up(0);
+                script.Up(1);
+                script.Frame();
+            }
+        };
+    }
+
+    auto Hold(int32_t fingers) -> Scenario {
+        return {
+            .Name = fingers == 1 ? "hold" : "two finger hold",
+            .Expected = Kind::Hold,
+            .Script = [fingers](TouchScript &script, std::mt19937 &random) -> void {
+                double x = Uniform(random, 0.2, 0.8);
+                double y = Uniform(random, 0.2, 0.8);
+
+                for (int32_t slot = 0; slot < fingers; slot++) {
+                    script.Down(slot, x + slot * 0.15, y);
+                }
+                script.Frame();
+
+                // 700ms of a finger resting, wobbling within the slop
+                for (int frame = 0; frame < 42; frame++) {
+                    for (int32_t slot = 0; slot < fingers; slot++) {
+                        script.Motion(slot, x + slot * 0.15 + Jitter(random), y + Jitter(random));
+                    }
+                    script.Frame();
+                }
+
+                for (int32_t slot = 0; slot < fingers; slot++) {
+                    script.Up(slot);
+                }
+                script.Frame();
+            }
+        };
+    }
+
+    // Input meant for clients, none of it may be taken for a gesture
+    auto ClientInput() -> std::vector<Scenario> {
+        return {
+            {
+                .Name = "tap",
+                .Script = [](TouchScript &script, std::mt19937 &random) -> void {
+                    script.Down(0, Uniform(random, 0.1, 0.9), Uniform(random, 0.1, 0.9));
+                    script.Frame(static_cast<uint64_t>(Uniform(random, 40'000, 150'000)));
+                    script.Up(0);
+                    script.Frame();
+                }
+            },
+            {
+                .Name = "drag",
+                .Script = [](TouchScript &script, std::mt19937 &random) -> void {
+                    double x = Uniform(random, 0.2, 0.5);
+                    double y = Uniform(random, 0.2, 0.5);
+                    script.Down(0, x, y);
+                    script.Frame();
+                    for (int frame = 1; frame <= 20; frame++) {
+                        script.Motion(0, x + 0.015 * frame + Jitter(random), y + 0.01 * frame + Jitter(random));
+                        script.Frame();
+                    }
+                    script.Up(0);
+                    script.Frame();
+                }
+            },
+            {
+                .Name = "two finger scroll",
+                .Script = [](TouchScript &script, std::mt19937 &random) -> void {
+                    double x = Uniform(random, 0.3, 0.5);
+                    double y = Uniform(random, 0.5, 0.7);
+                    script.Down(0, x, y);
+                    script.Down(1, x + 0.15, y);
+                    script.Frame();
+                    for (int frame = 1; frame <= 20; frame++) {
+                        double offset = -0.015 * frame;
+                        script.Motion(0, x + Jitter(random), y + offset + Jitter(random));
+                        script.Motion(1, x + 0.15 + Jitter(random), y + offset + Jitter(random));
+                        script.Frame();
+                    }
+                    script.Up(0);
+                    script.Up(1);
+                    script.Frame();
+                }
+            },
+            {
+                .Name = "drag along an edge",
+                .Script = [](TouchScript &script, std::mt19937 &random) -> void {
+                    double y = Uniform(random, 0.2, 0.4);
+                    script.Down(0, 0.01, y);
+                    script.Frame();
+                    for (int frame = 1; frame <= 20; frame++) {
+                        script.Motion(0, 0.01 + std::abs(Jitter(random)), y + 0.02 * frame);
+                        script.Frame();
+                    }
+                    script.Up(0);
+                    script.Frame();
+                }
+            }
+        };
+    }
+
+    auto GetScenarios() -> std::vector<Scenario> {
+        std::vector<Scenario> scenarios = {
+            EdgeSwipe(Edge::Left),
+            EdgeSwipe(Edge::Right),
+            EdgeSwipe(Edge::Top),
+            EdgeSwipe(Edge::Bottom),
+            Pinch(0.5, 0),
+            Pinch(1.6, 0),
+            Pinch(1.0, 0.8),
+            Hold(1),
+            Hold(2)
+        };
+
+        for (Scenario &scenario : ClientInput()) {
+            scenarios.push_back(std::move(scenario));
+        }
+
+        return scenarios;
+    }
+
+    // Variations of every scenario, each written to a trace and read back
+    constexpr size_t s_variants = 16;
+
+    auto GetTracePath() -> std::filesystem::path {
+        return std::filesystem::temp_directory_path() / ("moco_test_gestures_" + std::to_string(getpid()) + ".trace");
+    }
+
+    auto RecordScenario(const Scenario &scenario, uint32_t seed) -> std::vector<TouchState::Frame> {
+        std::filesystem::path path = GetTracePath();
+        std::mt19937 random(seed);
+
+        {
+            InputTrace::Writer writer(path);
+            TouchScript script(writer, 1'000'000);
+            scenario.Script(script, random);
+        }
+
+        std::vector<TouchState::Frame> frames = ReadFrames(path);
+        std::filesystem::remove(path);
+        return frames;
+    }
+}
+
+// Every recorded sequence is recognized as what it was meant to be, with
+// one begin and one end, and only swipes and pinches claim the sequence
+MOCO_TEST(Gestures.ReplayAccuracy) {
+    size_t total{0};
+    size_t correct{0};
+
+    for (const Scenario &scenario : GetScenarios()) {
+        for (uint32_t variant = 0; variant < s_variants; variant++) {
+            std::vector<TouchState::Frame> frames = RecordScenario(scenario, variant + 1);
+            RecognizeResult result = Recognize(frames);
+            total++;
+
+            size_t begins{0};
+            size_t ends{0};
+            std::optional<Kind> recognized;
+            std::optional<Edge> edge;
+            for (const Gesture &gesture : result.Gestures) {
+                if (gesture.GesturePhase == Phase::Begin) {
+                    begins++;
+                    recognized = gesture.GestureKind;
+                    edge = gesture.SwipeEdge;
+                } else if (gesture.GesturePhase == Phase::End) {
+                    ends++;
+                }
+            }
+
+            bool expectClaim = scenario.Expected.has_value() && scenario.Expected != Kind::Hold;
+            bool matches = recognized == scenario.Expected
+                        && (!scenario.ExpectedEdge.has_value() || edge == scenario.ExpectedEdge)
+                        && begins == (scenario.Expected.has_value() ? 1 : 0)
+                        && ends == begins
+                        && result.WasClaimed == expectClaim;
+
+            if (MOCO_CHECK(matches)) {
+                correct++;
+            } else {
+                std::cerr << scenario.Name << " variant " << variant
+                          << ": " << result.Gestures.size() << " gestures, "
+                          << begins << " begins, " << ends << " ends, "
+                          << (result.WasClaimed ? "claimed" : "not claimed")
+                          << std::endl;
+            }
+        }
+    }
+
+    std::cout << "Recognized " << correct << " of " << total << " sequences" << std::endl;
+}
+
+// A recognized swipe's velocity and distance follow the finger
+MOCO_TEST(Gestures.EdgeSwipeMotion) {
+    std::vector<TouchState::Frame> frames = RecordScenario(EdgeSwipe(Edge::Bottom), 1);
+    RecognizeResult result = Recognize(frames);
+
+    const Gesture *end = nullptr;
+    for (const Gesture &gesture : result.Gestures) {
+        if (gesture.GestureKind == Kind::EdgeSwipe && gesture.GesturePhase == Phase::End) {
+            end = &gesture;
+        }
+    }
+
+    if (MOCO_CHECK(end != nullptr)) {
+        // Upwards, away from the bottom edge
+        MOCO_CHECK(end->Dy < -0.1);
+        MOCO_CHECK(end->Velocity > 0);
+    }
+}
+
+/**
+ * Cost of a single recognizer step, over every frame of every recorded
+ * sequence. The budget is far above the expected cost of well under a
+ * microsecond, it catches accidental allocations or quadratic loops in
+ * the input path rather than measuring precisely, `moco_bench` does that.
+ *
+ */
+MOCO_TEST(Gestures.PerFrameCost) {
+    constexpr std::chrono::microseconds s_budgetP99{20};
+    constexpr size_t s_repetitions = 20;
+
+    std::vector<std::vector<TouchState::Frame>> sequences;
+    for (const Scenario &scenario : GetScenarios()) {
+        sequences.push_back(RecordScenario(scenario, 1));
+    }
+
+    LatencyHistogram histogram;
+    for (size_t repetition = 0; repetition < s_repetitions; repetition++) {
+        for (const std::vector<TouchState::Frame> &frames : sequences) {
+            GestureRecognizer recognizer;
+            for (const TouchState::Frame &frame : frames) {
+                auto start = std::chrono::steady_clock::now();
+                GestureRecognizer::Output output = recognizer.ProcessFrame(frame);
+                histogram.Record(std::chrono::steady_clock::now() - start);
+
+                MOCO_CHECK(output.Count <= GestureRecognizer::s_maxGesturesPerStep);
+            }
+        }
+    }
+
+    std::cout << "Frames: " << histogram.GetCount()
+              << " mean: " << histogram.GetMean().count() << "ns"
+              << " p99: " << histogram.GetPercentile(99).count() << "ns"
+              << std::endl;
+    MOCO_CHECK(histogram.GetPercentile(99) < s_budgetP99);
+}
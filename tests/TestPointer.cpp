@@ -0,0 +1,114 @@
+#include "Test.hpp"
+
+#include "Pointer.hpp"
+
+#include <wayland-server-protocol.hpp>
+
+#include <cstdint>
+
+using namespace moco::backend;
+using namespace wayland::server;
+
+namespace {
+    using ClientFrame_t = moco::wayland::implementation::Pointer::Frame_EventData;
+
+    auto FingerScroll(uint64_t timeUsec, double vertical) -> LibInput::PointerScroll_EventData {
+        return {
+            .TimeUsec = timeUsec,
+            .Source = LIBINPUT_POINTER_AXIS_SOURCE_FINGER,
+            .HasVertical = true,
+            .Vertical = vertical
+        };
+    }
+}
+
+// Sub-pixel motion adds up exactly, however many events it's split into
+MOCO_TEST(Pointer.MotionDoesNotDrift) {
+    PointerState pointerState;
+    pointerState.SetOutputLayout({{.X = 0, .Y = 0, .Width = 1920, .Height = 1080}});
+
+    for (int i = 0; i < 3'000; i++) {
+        pointerState.Motion(i, 0.1, 0.3, 0.1, 0.3);
+    }
+
+    MOCO_CHECK(pointerState.GetX() > 299.99 && pointerState.GetX() < 300.01);
+    MOCO_CHECK(pointerState.GetY() > 899.99 && pointerState.GetY() < 900.01);
+
+    // Clamped to the layout
+    pointerState.Motion(3'000, 5'000, -5'000, 0, 0);
+    MOCO_CHECK(pointerState.GetX() < 1920 && pointerState.GetX() > 1919);
+    MOCO_CHECK(pointerState.GetY() == 0);
+}
+
+// A stop can't be merged into scroll of the same axis, nor can anything
+// follow a stop, so clients see the scroll before the stop
+MOCO_TEST(Pointer.ScrollStopGetsOwnFrame) {
+    PointerState pointerState;
+
+    MOCO_CHECK(pointerState.CanTakeScroll(FingerScroll(0, 2.5)));
+    pointerState.Scroll(FingerScroll(0, 2.5));
+    MOCO_CHECK(pointerState.CanTakeScroll(FingerScroll(1, 1.5)));
+    pointerState.Scroll(FingerScroll(1, 1.5));
+
+    MOCO_CHECK(!pointerState.CanTakeScroll(FingerScroll(2, 0)));
+    MOCO_CHECK(!pointerState.CanTakeScroll({.Source = LIBINPUT_POINTER_AXIS_SOURCE_WHEEL, .HasVertical = true, .Vertical = 1}));
+
+    PointerState::Frame scroll = pointerState.TakeFrame();
+    MOCO_CHECK(scroll.HasScroll);
+    MOCO_CHECK(scroll.Axes[LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL].Value == 4);
+    MOCO_CHECK(!scroll.Axes[LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL].Stop);
+    MOCO_CHECK(!scroll.Axes[LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL].Active);
+
+    MOCO_CHECK(pointerState.CanTakeScroll(FingerScroll(2, 0)));
+    pointerState.Scroll(FingerScroll(2, 0));
+    MOCO_CHECK(!pointerState.CanTakeScroll(FingerScroll(3, 1)));
+    MOCO_CHECK(!pointerState.CanTakeScroll(FingerScroll(3, 0)));
+
+    PointerState::Frame stop = pointerState.TakeFrame();
+    MOCO_CHECK(stop.Axes[LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL].Stop);
+    MOCO_CHECK(stop.Axes[LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL].Value == 0);
+    MOCO_CHECK(!pointerState.HasChanges());
+
+    // Clients get it as `wl_pointer.axis_stop`
+    ClientFrame_t clientStop = Pointer::ToClientFrame(stop, 0, 0);
+    MOCO_CHECK(clientStop.HasAxis && clientStop.AxisSource == pointer_axis_source::finger);
+    MOCO_CHECK(clientStop.Axes[static_cast<size_t>(pointer_axis::vertical_scroll)].Stop);
+}
+
+// Frames reach clients local to the focus, with the button state and
+// axes mapped onto `wl_pointer`'s, and no serial
+MOCO_TEST(Pointer.ClientFrame) {
+    PointerState pointerState;
+    pointerState.SetOutputLayout({{.X = 0, .Y = 0, .Width = 1024, .Height = 1024}});
+    pointerState.MotionAbsolute(1'000, 0.25, 0.125);
+    pointerState.Button(2'500, 0x110, LIBINPUT_BUTTON_STATE_PRESSED);
+
+    ClientFrame_t pressed = Pointer::ToClientFrame(pointerState.TakeFrame(), 100, 50);
+    MOCO_CHECK(pressed.Serial == 0);
+    MOCO_CHECK(pressed.Time == 2);
+    MOCO_CHECK(pressed.HasMotion);
+    MOCO_CHECK(pressed.X == 156 && pressed.Y == 78);
+    MOCO_CHECK(pressed.HasButton && pressed.Button == 0x110);
+    MOCO_CHECK(pressed.ButtonState == pointer_button_state::pressed);
+    MOCO_CHECK(!pressed.HasAxis);
+
+    pointerState.Button(3'000, 0x110, LIBINPUT_BUTTON_STATE_RELEASED);
+    pointerState.Scroll({
+        .TimeUsec = 3'000,
+        .Source = LIBINPUT_POINTER_AXIS_SOURCE_WHEEL,
+        .HasHorizontal = true,
+        .Horizontal = -15,
+        .HorizontalV120 = -120
+    });
+
+    ClientFrame_t released = Pointer::ToClientFrame(pointerState.TakeFrame(), 0, 0);
+    MOCO_CHECK(!released.HasMotion);
+    MOCO_CHECK(released.ButtonState == pointer_button_state::released);
+    MOCO_CHECK(released.HasAxis);
+    MOCO_CHECK(released.AxisSource == pointer_axis_source::wheel);
+
+    const moco::wayland::implementation::Pointer::Axis &horizontal = released.Axes[static_cast<size_t>(pointer_axis::horizontal_scroll)];
+    MOCO_CHECK(horizontal.Active && !horizontal.Stop);
+    MOCO_CHECK(horizontal.Value == -15 && horizontal.Value120 == -120);
+    MOCO_CHECK(!released.Axes[static_cast<size_t>(pointer_axis::vertical_scroll)].Active);
+}
@@ -0,0 +1,39 @@
+#include "Test.hpp"
+
+#include "SharedMemoryPool.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+using namespace moco::wayland::implementation;
+
+namespace {
+    constexpr int32_t s_max = std::numeric_limits<int32_t>::max();
+}
+
+// Buffers that fit get the bytes from their offset to their last row
+MOCO_TEST(SharedMemoryPool.BufferSize) {
+    MOCO_CHECK(SharedMemoryPool::GetBufferSize(0, 100, 50, 400, 4, 20'000) == std::optional<size_t>{20'000});
+    MOCO_CHECK(SharedMemoryPool::GetBufferSize(400, 10, 10, 64, 4, 1'040) == std::optional<size_t>{640});
+
+    // Rows may be padded, but not shorter than the pixels
+    MOCO_CHECK(SharedMemoryPool::GetBufferSize(0, 10, 10, 48, 4, 1'000) == std::optional<size_t>{480});
+    MOCO_CHECK(!SharedMemoryPool::GetBufferSize(0, 10, 10, 39, 4, 1'000).has_value());
+
+    // One byte past the pool
+    MOCO_CHECK(!SharedMemoryPool::GetBufferSize(1, 100, 50, 400, 4, 20'000).has_value());
+}
+
+// Negative and zero arguments are rejected, not wrapped around
+MOCO_TEST(SharedMemoryPool.RejectsMalformed) {
+    MOCO_CHECK(!SharedMemoryPool::GetBufferSize(400, 1, 100, -4, 4, 4'096).has_value());
+    MOCO_CHECK(!SharedMemoryPool::GetBufferSize(0, 1, 1, 0, 4, 4'096).has_value());
+    MOCO_CHECK(!SharedMemoryPool::GetBufferSize(-4, 1, 1, 4, 4, 4'096).has_value());
+    MOCO_CHECK(!SharedMemoryPool::GetBufferSize(0, 0, 1, 4, 4, 4'096).has_value());
+    MOCO_CHECK(!SharedMemoryPool::GetBufferSize(0, 1, -1, 4, 4, 4'096).has_value());
+
+    // The largest requests a client can make can't overflow either
+    MOCO_CHECK(!SharedMemoryPool::GetBufferSize(s_max, s_max, s_max, s_max, 4, std::numeric_limits<size_t>::max() - 1).has_value());
+    MOCO_CHECK(SharedMemoryPool::GetBufferSize(s_max, 1, s_max, s_max, 4, std::numeric_limits<size_t>::max()).has_value());
+}
@@ -0,0 +1,117 @@
+#include "Test.hpp"
+
+#include "SurfaceTransform.hpp"
+
+#include <wayland-server-protocol.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+using namespace moco::wayland::implementation;
+using namespace wayland::server;
+
+namespace {
+    /**
+     * @brief Maps a single surface pixel to its buffer pixel, unscaled
+     * @details Builds the buffer the way the protocol describes it, by
+     * mirroring the surface and then rotating it counter-clockwise a
+     * quarter turn at a time, so it shares no code with the matrices.
+     *
+     */
+    auto ReferencePixel(output_transform transform, int width, int height, int x, int y) -> std::pair<int, int> {
+        int value = static_cast<int>(transform);
+        if (value >= 4) {
+            x = width - 1 - x;
+        }
+
+        for (int turn = 0; turn < value % 4; turn++) {
+            int rotatedX = y;
+            int rotatedY = width - 1 - x;
+            x = rotatedX;
+            y = rotatedY;
+            std::swap(width, height);
+        }
+
+        return {x, y};
+    }
+
+    // Bounding box of every pixel of `box` mapped by the reference
+    auto ReferenceBox(output_transform transform, int scale, int width, int height, const pixman_box32_t &box) -> pixman_box32_t {
+        pixman_box32_t result{.x1 = INT32_MAX, .y1 = INT32_MAX, .x2 = INT32_MIN, .y2 = INT32_MIN};
+        for (int y = box.y1; y < box.y2; y++) {
+            for (int x = box.x1; x < box.x2; x++) {
+                auto [bufferX, bufferY] = ReferencePixel(transform, width, height, x, y);
+                result.x1 = std::min(result.x1, bufferX * scale);
+                result.y1 = std::min(result.y1, bufferY * scale);
+                result.x2 = std::max(result.x2, (bufferX + 1) * scale);
+                result.y2 = std::max(result.y2, (bufferY + 1) * scale);
+            }
+        }
+
+        return result;
+    }
+
+    auto operator==(const pixman_box32_t &a, const pixman_box32_t &b) -> bool {
+        return a.x1 == b.x1 && a.y1 == b.y1 && a.x2 == b.x2 && a.y2 == b.y2;
+    }
+}
+
+// Every rectangle of a few odd and even surface sizes, for every
+// transform and scale, matches the pixel by pixel reference
+MOCO_TEST(SurfaceTransform.MatchesReference) {
+    for (int transform = 0; transform < 8; transform++) {
+        for (int scale = 1; scale <= 3; scale++) {
+            for (int width : {1, 5, 8}) {
+                for (int height : {1, 3, 7}) {
+                    SurfaceTransform surfaceTransform(static_cast<output_transform>(transform), scale, width, height);
+
+                    for (int x1 = 0; x1 < width; x1++) {
+                        for (int y1 = 0; y1 < height; y1++) {
+                            for (int x2 = x1 + 1; x2 <= width; x2++) {
+                                for (int y2 = y1 + 1; y2 <= height; y2++) {
+                                    pixman_box32_t box{.x1 = x1, .y1 = y1, .x2 = x2, .y2 = y2};
+                                    pixman_box32_t expected = ReferenceBox(static_cast<output_transform>(transform), scale, width, height, box);
+                                    if (!MOCO_CHECK(surfaceTransform.Apply(box) == expected)) {
+                                        std::cerr << "transform=" << transform << " scale=" << scale
+                                                  << " size=" << width << "x" << height
+                                                  << " box=" << x1 << "," << y1 << "-" << x2 << "," << y2
+                                                  << std::endl;
+                                        return;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// The whole surface always maps to the whole buffer
+MOCO_TEST(SurfaceTransform.CoversBuffer) {
+    constexpr int width = 640;
+    constexpr int height = 360;
+    constexpr int scale = 2;
+
+    for (int transform = 0; transform < 8; transform++) {
+        bool rotated = transform % 2 == 1;
+        SurfaceTransform surfaceTransform(static_cast<output_transform>(transform), scale, width, height);
+
+        pixman_box32_t buffer{
+            .x1 = 0,
+            .y1 = 0,
+            .x2 = (rotated ? height : width) * scale,
+            .y2 = (rotated ? width : height) * scale
+        };
+        MOCO_CHECK(surfaceTransform.Apply({.x1 = 0, .y1 = 0, .x2 = width, .y2 = height}) == buffer);
+    }
+}
+
+// The table is usable at compile time
+static_assert([]() -> bool {
+    constexpr SurfaceTransform transform(output_transform::_90, 1, 4, 2);
+    constexpr pixman_box32_t box = transform.Apply({.x1 = 0, .y1 = 0, .x2 = 1, .y2 = 1});
+    return box.x1 == 0 && box.y1 == 3 && box.x2 == 1 && box.y2 == 4;
+}());
@@ -0,0 +1,150 @@
+#include "Test.hpp"
+
+#include "Touch.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+using namespace moco::backend;
+
+namespace {
+    using PointState = moco::wayland::implementation::Touch::PointState;
+    using ClientFrame_t = TouchClientState::ClientFrame_t;
+
+    // Touch device spanning a 1000x2000 output at (100, 50)
+    constexpr TouchClientState::OutputRect s_output{.X = 100, .Y = 50, .Width = 1000, .Height = 2000};
+
+    auto HasPoint(const ClientFrame_t &frame, size_t index, int32_t id, PointState state, double x, double y) -> bool {
+        if (index >= frame.PointCount) {
+            return false;
+        }
+
+        const moco::wayland::implementation::Touch::Point &point = frame.Points[index];
+        return point.Id == id && point.State == state && point.X == x && point.Y == y;
+    }
+}
+
+// Points are mapped onto the output and made local to the surface
+// they went down on, the frame's time is in milliseconds
+MOCO_TEST(Touch.ClientCoordinates) {
+    TouchState touchState;
+    TouchClientState clientState;
+    clientState.SetOutput(s_output);
+
+    std::pair<int32_t, int32_t> origin{10, 20};
+    clientState.SetSurfaceOrigin([&origin]() -> std::pair<int32_t, int32_t> {return origin;});
+
+    touchState.Down(0, 1'000, 0.5, 0.25);
+    std::optional<ClientFrame_t> down = clientState.TakeFrame(touchState.TakeFrame(3'500));
+    if (MOCO_CHECK(down.has_value())) {
+        MOCO_CHECK(down->PointCount == 1);
+        MOCO_CHECK(down->Serial == 0);
+        MOCO_CHECK(down->Time == 3);
+        MOCO_CHECK(HasPoint(*down, 0, 0, PointState::Down, 590, 530));
+    }
+
+    // A second finger lands on another surface, the first keeps its origin
+    origin = {200, 300};
+    touchState.Down(1, 2'000, 0.5, 0.25);
+    touchState.Motion(0, 2'000, 0.25, 0.5);
+    std::optional<ClientFrame_t> second = clientState.TakeFrame(touchState.TakeFrame(4'000));
+    if (MOCO_CHECK(second.has_value() && second->PointCount == 2)) {
+        MOCO_CHECK(HasPoint(*second, 0, 0, PointState::Motion, 340, 1030));
+        MOCO_CHECK(HasPoint(*second, 1, 1, PointState::Down, 400, 250));
+    }
+
+    touchState.Up(0, 3'000);
+    touchState.Up(1, 3'000);
+    std::optional<ClientFrame_t> up = clientState.TakeFrame(touchState.TakeFrame(5'000));
+    if (MOCO_CHECK(up.has_value() && up->PointCount == 2)) {
+        MOCO_CHECK(up->Points[0].Id == 0 && up->Points[0].State == PointState::Up);
+        MOCO_CHECK(up->Points[1].Id == 1 && up->Points[1].State == PointState::Up);
+    }
+
+    // Nothing changed, nothing goes out
+    MOCO_CHECK(!clientState.TakeFrame(touchState.TakeFrame(6'000)).has_value());
+}
+
+// A tap shorter than a frame still reaches clients as a down and an up
+MOCO_TEST(Touch.DownUpInOneFrame) {
+    TouchState touchState;
+    TouchClientState clientState;
+    clientState.SetOutput(s_output);
+
+    touchState.Down(3, 1'000, 0, 0);
+    touchState.Up(3, 2'000);
+
+    TouchState::Frame frame = touchState.TakeFrame(2'000);
+    MOCO_CHECK(frame.ActiveMask == 0);
+    MOCO_CHECK(frame.MotionMask == 0);
+
+    std::optional<ClientFrame_t> tap = clientState.TakeFrame(frame);
+    if (MOCO_CHECK(tap.has_value() && tap->PointCount == 2)) {
+        MOCO_CHECK(HasPoint(*tap, 0, 3, PointState::Down, 100, 50));
+        MOCO_CHECK(HasPoint(*tap, 1, 3, PointState::Up, 100, 50));
+    }
+
+    // The slot was released, a late motion isn't forwarded
+    touchState.Motion(3, 3'000, 0.5, 0.5);
+    MOCO_CHECK(!clientState.TakeFrame(touchState.TakeFrame(3'000)).has_value());
+}
+
+// Claiming cancels what clients hold and keeps the rest of the
+// sequence from them, until every finger is lifted
+MOCO_TEST(Touch.ClaimCancelsClients) {
+    TouchState touchState;
+    TouchClientState clientState;
+    clientState.SetOutput(s_output);
+
+    // Nothing down yet, there's nothing to cancel
+    MOCO_CHECK(!clientState.Claim());
+    MOCO_CHECK(clientState.IsClaimed());
+    MOCO_CHECK(!clientState.TakeFrame(touchState.TakeFrame(0)).has_value());
+    MOCO_CHECK(!clientState.IsClaimed());
+
+    touchState.Down(0, 1'000, 0.1, 0.1);
+    touchState.Down(1, 1'000, 0.2, 0.2);
+    MOCO_CHECK(clientState.TakeFrame(touchState.TakeFrame(1'000)).has_value());
+
+    MOCO_CHECK(clientState.Claim());
+    MOCO_CHECK(!clientState.Claim());
+
+    touchState.Motion(0, 2'000, 0.3, 0.3);
+    touchState.Down(2, 2'000, 0.4, 0.4);
+    MOCO_CHECK(!clientState.TakeFrame(touchState.TakeFrame(2'000)).has_value());
+
+    touchState.Up(0, 3'000);
+    touchState.Up(1, 3'000);
+    MOCO_CHECK(!clientState.TakeFrame(touchState.TakeFrame(3'000)).has_value());
+    MOCO_CHECK(clientState.IsClaimed());
+
+    touchState.Up(2, 4'000);
+    MOCO_CHECK(!clientState.TakeFrame(touchState.TakeFrame(4'000)).has_value());
+    MOCO_CHECK(!clientState.IsClaimed());
+
+    // The next sequence belongs to clients again
+    touchState.Down(0, 5'000, 0.5, 0.5);
+    std::optional<ClientFrame_t> next = clientState.TakeFrame(touchState.TakeFrame(5'000));
+    MOCO_CHECK(next.has_value() && next->PointCount == 1 && next->Points[0].State == PointState::Down);
+}
+
+// A cancelled sequence forgets the client's points and any claim
+MOCO_TEST(Touch.Cancel) {
+    TouchState touchState;
+    TouchClientState clientState;
+
+    touchState.Down(0, 1'000, 0.5, 0.5);
+    MOCO_CHECK(clientState.TakeFrame(touchState.TakeFrame(1'000)).has_value());
+
+    touchState.Cancel();
+    MOCO_CHECK(clientState.Cancel());
+    MOCO_CHECK(!clientState.Cancel());
+
+    MOCO_CHECK(!clientState.Claim());
+    MOCO_CHECK(!clientState.Cancel());
+    MOCO_CHECK(!clientState.IsClaimed());
+
+    touchState.Down(0, 2'000, 0.5, 0.5);
+    MOCO_CHECK(clientState.TakeFrame(touchState.TakeFrame(2'000)).has_value());
+}
@@ -0,0 +1,46 @@
+#include "Test.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+using namespace moco::test;
+
+// Runs the case named by the first argument, every case without one.
+// `--list` prints the registered names.
+auto main(int argc, char **argv) -> int {
+    std::string_view filter = argc > 1 ? argv[1] : "";
+
+    if (filter == "--list") {
+        for (const TestRegistry::TestCase &test : TestRegistry::GetTests()) {
+            std::cout << test.Name << std::endl;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    size_t run{0};
+    size_t failed{0};
+    for (const TestRegistry::TestCase &test : TestRegistry::GetTests()) {
+        if (!filter.empty() && test.Name != filter) {
+            continue;
+        }
+
+        TestRegistry::GetFailures() = 0;
+        test.Function();
+        run++;
+
+        if (TestRegistry::GetFailures() != 0) {
+            failed++;
+            std::cerr << "FAILED " << test.Name << " (" << TestRegistry::GetFailures() << " checks)" << std::endl;
+        } else {
+            std::cout << "PASSED " << test.Name << std::endl;
+        }
+    }
+
+    if (run == 0) {
+        std::cerr << "No test named " << filter << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}